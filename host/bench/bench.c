@@ -0,0 +1,317 @@
+/**
+ * @file bench.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#include "arch/smp.h"
+#include "bench.h"
+#include "global.h"
+#include "fs/vfs.h"
+#include "mm/pmm.h"
+#include "userspace/init.h"
+#include "userspace/loader.h"
+#include "userspace/process.h"
+#include "userspace/reaper.h"
+#include "userspace/spawn_stats.h"
+#include "userspace/template.h"
+#include "userspace/thread.h"
+
+#include <errno.h>
+#include <time.h>
+
+// Lifecycle benchmarks of the userspace module run against the stand-ins.
+// Each prints one line to stdout:
+//
+//   bench <name> <iterations> <total ns> <ns per iteration>
+//
+// then one line per syscall from syscalls.c, followed by the TSC counters of spawn_stats.h for the whole run:
+//
+//   spawn <step> <count> <cycles> <min> <max>
+//
+// and the PMM pages out before and after, once everything has been torn
+// down. The difference is what the stack and ELF caches keep, it must not
+// grow with the iterations:
+//
+//   pages <before> <after>
+
+#undef printf
+
+#define PAYLOAD_EXEC "/bench/payload_exec"
+#define PAYLOAD_PIE "/bench/payload_pie"
+
+struct bench {
+	const char *name;
+	int (*run)(void *arg);
+	void *arg;
+	// Once before timing, to fill the caches the benchmark means to hit
+	bool warm;
+	// Only this many iterations if not 0, for the ones that cannot be
+	// repeated and stay the same
+	int limit;
+};
+
+ARC_Process *host_process = NULL;
+ARC_Thread *host_thread = NULL;
+
+static int template_id = -1;
+// Kept alive until the end, its templates go with it
+static ARC_Process *template_owner = NULL;
+
+uint64_t now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Everything deferred is gone once a run has nothing left to do, with one
+// processor every grace period has passed by the next run
+void reap_all(void) {
+	while (reaper_run(SIZE_MAX) != 0);
+}
+
+static int delete_process(ARC_Process *process) {
+	if (process_delete(process) != 0) {
+		return -1;
+	}
+
+	reap_all();
+
+	return 0;
+}
+
+static int bench_process(void *arg) {
+	ARC_Process *process = process_create(arg != NULL, NULL);
+
+	if (process == NULL) {
+		return -1;
+	}
+
+	return delete_process(process);
+}
+
+static int bench_thread(void *arg) {
+	(void)arg;
+
+	ARC_Thread *thread = thread_create(host_process, (void *)0x1000, 0x10000);
+
+	if (thread == NULL) {
+		return -1;
+	}
+
+	return thread_delete(thread);
+}
+
+static int bench_thread_exit(void *arg) {
+	(void)arg;
+
+	ARC_Thread *thread = thread_create(host_process, (void *)0x1000, 0x10000);
+
+	if (thread == NULL) {
+		return -1;
+	}
+
+	// As if it had run and exited, then a joiner collected it
+	if (thread_exit(thread, 0) != 0) {
+		return -1;
+	}
+
+	reap_all();
+
+	return thread_join(host_process, thread->tid, NULL);
+}
+
+static int bench_from_file(void *arg) {
+	ARC_Process *process = process_create_from_file(true, (char *)arg);
+
+	if (process == NULL) {
+		return -1;
+	}
+
+	return delete_process(process);
+}
+
+static int bench_from_template(void *arg) {
+	(void)arg;
+
+	ARC_Process *process = process_create_from_template(template_owner, template_id);
+
+	if (process == NULL) {
+		return -1;
+	}
+
+	return delete_process(process);
+}
+
+static int add_payload(const char *path, const char *file) {
+	FILE *fp = fopen(file, "rb");
+
+	if (fp == NULL) {
+		fprintf(stderr, "Failed to open %s: %s\n", file, strerror(errno));
+		return -1;
+	}
+
+	fseek(fp, 0, SEEK_END);
+	long size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+
+	void *data = malloc(size);
+	int ret = -1;
+
+	if (data != NULL && fread(data, 1, size, fp) == (size_t)size) {
+		ret = host_vfs_add(path, data, size);
+	}
+
+	free(data);
+	fclose(fp);
+
+	return ret;
+}
+
+// The caller of the syscalls and the owner of captured templates, as the
+// scheduler would have it running on this processor
+static int setup_host_process(void) {
+	if ((host_process = process_create(true, NULL)) == NULL) {
+		return -1;
+	}
+
+	if ((host_thread = thread_create(host_process, (void *)0x1000, 0x10000)) == NULL) {
+		return -1;
+	}
+
+	smp_get_proc_desc()->thread = host_thread;
+	smp_get_proc_desc()->process = host_process;
+
+	return 0;
+}
+
+static int setup_template(void) {
+	ARC_Process *process = process_create_from_file(true, PAYLOAD_PIE);
+
+	if (process == NULL) {
+		return -1;
+	}
+
+	ARC_Thread *thread = process->threads->t;
+	ARC_Thread *saved = smp_get_proc_desc()->thread;
+
+	// Captured by the process itself
+	smp_get_proc_desc()->thread = thread;
+	template_id = template_capture(process);
+	smp_get_proc_desc()->thread = saved;
+	template_owner = process;
+
+	return template_id < 0 ? -1 : 0;
+}
+
+static void run_bench(struct bench *bench, int iterations) {
+	if (bench->limit != 0 && bench->limit < iterations) {
+		iterations = bench->limit;
+	}
+
+	if (bench->warm && bench->run(bench->arg) != 0) {
+		printf("bench %s failed\n", bench->name);
+		return;
+	}
+
+	uint64_t start = now_ns();
+
+	for (int i = 0; i < iterations; i++) {
+		if (bench->run(bench->arg) != 0) {
+			printf("bench %s failed\n", bench->name);
+			return;
+		}
+	}
+
+	uint64_t total = now_ns() - start;
+
+	printf("bench %s %d %lu %lu\n", bench->name, iterations, total, total / iterations);
+}
+
+int main(int argc, char **argv) {
+	int iterations = argc > 1 ? atoi(argv[1]) : 1000;
+
+	if (iterations <= 0) {
+		fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+		return 1;
+	}
+
+	if (init_userspace() != 0 || setup_host_process() != 0) {
+		fprintf(stderr, "Failed to initialize\n");
+		return 1;
+	}
+
+	if (add_payload(PAYLOAD_EXEC, "payload_exec") != 0 || add_payload(PAYLOAD_PIE, "payload_pie") != 0) {
+		fprintf(stderr, "Failed to add payloads, run from the build directory\n");
+		return 1;
+	}
+
+	if (setup_template() != 0) {
+		fprintf(stderr, "Failed to capture template\n");
+		return 1;
+	}
+
+	struct bench benches[] = {
+		{ "process_kernel", bench_process, NULL, false, 0 },
+		{ "process_user", bench_process, (void *)1, false, 0 },
+		{ "thread_delete", bench_thread, NULL, false, 0 },
+		{ "thread_exit_join", bench_thread_exit, NULL, false, 0 },
+		// The first load of each file fills the ELF cache, later ones
+		// hit it
+		{ "elf_exec_cold", bench_from_file, PAYLOAD_EXEC, false, 1 },
+		{ "elf_exec", bench_from_file, PAYLOAD_EXEC, true, 0 },
+		{ "elf_pie", bench_from_file, PAYLOAD_PIE, true, 0 },
+		{ "template", bench_from_template, NULL, true, 0 },
+	};
+
+	spawn_stats_reset();
+	size_t pages = host_pmm_pages();
+
+	for (size_t i = 0; i < sizeof(benches) / sizeof(*benches); i++) {
+		run_bench(&benches[i], iterations);
+	}
+
+	if (bench_syscalls(iterations) != 0) {
+		fprintf(stderr, "Failed to set up the syscall benchmarks\n");
+		return 1;
+	}
+
+	reap_all();
+	size_t pages_after = host_pmm_pages();
+
+	ARC_SpawnStats stats = { 0 };
+	spawn_stats_get(&stats);
+
+	for (int i = 0; i < ARC_SPAWN_STEPS; i++) {
+		ARC_SpawnStat *stat = &stats.steps[i];
+		printf(ARC_SPAWN_STATS_LINE, spawn_stats_name(i), stat->count, stat->cycles, stat->min, stat->max);
+	}
+
+	printf("pages %lu %lu\n", pages, pages_after);
+
+	template_destroy(template_owner, template_id);
+	delete_process(template_owner);
+
+	return 0;
+}
@@ -0,0 +1,47 @@
+/**
+ * @file bench.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#ifndef ARC_HOST_BENCH_H
+#define ARC_HOST_BENCH_H
+
+#include "userspace/process.h"
+#include "userspace/thread.h"
+
+#include <stdint.h>
+
+// The process and thread the benchmarks act as, the processor descriptor
+// points at host_thread outside of the benchmarks that switch it
+extern ARC_Process *host_process;
+extern ARC_Thread *host_thread;
+
+uint64_t now_ns(void);
+// Runs the reaper until nothing deferred is left
+void reap_all(void);
+
+// One line for every entry of Arc_SyscallTable, see syscalls.c
+int bench_syscalls(int iterations);
+
+#endif
@@ -0,0 +1,37 @@
+/**
+ * @file payload.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+// The program the benchmarks load, it is never run so only the shape of its
+// image matters: text, initialized data and bss
+
+static volatile char data[0x2000] = { 1 };
+static volatile char bss[0x4000];
+
+void _start(void) {
+	data[0] = bss[0];
+
+	for (;;) ;
+}
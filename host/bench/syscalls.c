@@ -0,0 +1,941 @@
+/**
+ * @file syscalls.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#include "abi-bits/seek-whence.h"
+#include "abi-bits/vm-flags.h"
+#include "arch/smp.h"
+#include "bench.h"
+#include "fs/vfs.h"
+#include "global.h"
+#include "mp/scheduler.h"
+#include "userspace/affinity.h"
+#include "userspace/epoll.h"
+#include "userspace/ipc.h"
+#include "userspace/reaper.h"
+#include "userspace/timer.h"
+
+#include <pthread.h>
+#include <setjmp.h>
+#include <unistd.h>
+
+// Every entry of Arc_SyscallTable, called through the table as the syscall
+// path would, with the processor descriptor pointing at host_thread and
+// ordinary host memory as user memory. One line each on stdout:
+//
+//   syscall <number> <name> <iterations> <total ns> <ns per call>
+//
+// or, if a call returned something other than expected:
+//
+//   syscall <number> <name> failed <iteration> <return value>
+//
+// Entries without a case below are reported as missing. Whatever a call
+// needs is set up before it and undone after it, neither of which is timed.
+//
+// Then again from 1, 2, 4 ... host threads at once, up to the number of
+// processors (at least 2, at most BENCH_MAX_THREADS). Each acts as a thread
+// of the same process on a processor of its own, with userspace of its own:
+//
+//   syscall <number> <name> threads <count> <iterations each> <total ns> <ns per call>
+//
+// the total summed over the threads. template_capture and template_destroy
+// need the process to have a single thread and are left out
+
+#undef printf
+
+#define SYS(index, ...) call(index, (uint64_t [6]){ __VA_ARGS__ })
+#define U(x) ((uint64_t)(uintptr_t)(x))
+
+#define BENCH_DATA "/bench/data"
+#define BENCH_COPY "/bench/copy"
+#define BENCH_PIPE "bench_pipe"
+#define BENCH_SHM "bench_shm"
+#define BENCH_IO_SIZE 0x1000
+#define BENCH_MAP_SIZE 0x10000
+#define BENCH_MAX_THREADS 8
+
+extern uintptr_t Arc_SyscallTable[];
+extern const size_t Arc_SyscallCount;
+
+struct syscall_case {
+	const char *name;
+	// Fills in the arguments of a call, untimed
+	int (*setup)(uint64_t *args);
+	// Undoes what the call did, untimed
+	void (*teardown)(uint64_t *args);
+	// What every call is expected to return
+	int expect;
+	// The handler never returns, see host_yield_escape
+	bool noreturn;
+	// Needs the process to have a single thread
+	bool single;
+};
+
+// Userspace as the handlers see it, one for every host thread
+static __thread struct {
+	int fd;
+	int copy_fd;
+	int pipe[2];
+	int futex;
+	int pi;
+	int handle;
+	int handles[2];
+	int id;
+	int code;
+	int count;
+	uint32_t last;
+	long secs;
+	long nanos;
+	long offset;
+	long off_in;
+	long off_out;
+	long result;
+	uint64_t cursor;
+	uint64_t dropped;
+	uint64_t mask;
+	uint64_t pid;
+	void *ptr;
+	ARC_TimeSpec zero;
+	ARC_EPollEvent event;
+	ARC_EPollEvent events[ARC_EPOLL_MAX_EVENTS];
+	uint64_t stats[512];
+	uint8_t buffer[BENCH_IO_SIZE];
+	int named[2];
+	char pipe_name[32];
+	char shm_name[32];
+} user;
+
+static int template_id = -1;
+static __thread ARC_Process *spawned = NULL;
+static __thread ARC_Thread *saved_thread = NULL;
+
+ARC_Process *__real_process_create(bool userspace, void *page_tables);
+
+// Linked in place of process_create, template_spawn only hands back a pid
+ARC_Process *__wrap_process_create(bool userspace, void *page_tables) {
+	spawned = __real_process_create(userspace, page_tables);
+
+	return spawned;
+}
+
+static int call(int index, uint64_t *args) {
+	int (*handler)(uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t) = (void *)Arc_SyscallTable[index];
+
+	return handler(args[0], args[1], args[2], args[3], args[4], args[5]);
+}
+
+static void set_args(uint64_t *args, uint64_t a, uint64_t b, uint64_t c, uint64_t d, uint64_t e, uint64_t f) {
+	args[0] = a;
+	args[1] = b;
+	args[2] = c;
+	args[3] = d;
+	args[4] = e;
+	args[5] = f;
+}
+
+static void *map_anonymous(size_t size) {
+	void *ptr = NULL;
+
+	if (SYS(10, 0, size, ((uint64_t)(PROT_READ | PROT_WRITE) << 32) | MAP_PRIVATE | MAP_ANONYMOUS, -1, 0, U(&ptr)) != 0) {
+		return NULL;
+	}
+
+	return ptr;
+}
+
+// Acting as a thread of its own, for the handlers that end the caller
+static void switch_thread(ARC_Thread *thread) {
+	saved_thread = smp_get_proc_desc()->thread;
+	smp_get_proc_desc()->thread = thread;
+}
+
+static void restore_thread(void) {
+	smp_get_proc_desc()->thread = saved_thread;
+}
+
+static int setup_tcb_set(uint64_t *args) {
+	set_args(args, U(user.stats), 0, 0, 0, 0, 0);
+	return 0;
+}
+
+static void teardown_tcb_set(uint64_t *args) {
+	(void)args;
+	SYS(0, 0);
+}
+
+// The value differs, so the wait returns at once
+static int setup_futex_wait(uint64_t *args) {
+	user.futex = 0;
+	set_args(args, U(&user.futex), 1, 0, 0, 0, 0);
+	return 0;
+}
+
+static int setup_futex_wake(uint64_t *args) {
+	set_args(args, U(&user.futex), 0, 0, 0, 0, 0);
+	return 0;
+}
+
+static int setup_clock_get(uint64_t *args) {
+	set_args(args, 0, U(&user.secs), U(&user.nanos), 0, 0, 0);
+	return 0;
+}
+
+static int setup_exit(uint64_t *args) {
+	ARC_Process *process = process_create(true, NULL);
+
+	if (process == NULL) {
+		return -1;
+	}
+
+	ARC_Thread *thread = thread_create(process, (void *)0x1000, 0x10000);
+
+	if (thread == NULL) {
+		process_delete(process);
+		reap_all();
+		return -1;
+	}
+
+	switch_thread(thread);
+	set_args(args, 0, 0, 0, 0, 0, 0);
+
+	return 0;
+}
+
+static void teardown_exit(uint64_t *args) {
+	(void)args;
+	restore_thread();
+	reap_all();
+}
+
+static int setup_seek(uint64_t *args) {
+	set_args(args, user.fd, 0, SEEK_SET, U(&user.offset), 0, 0);
+	return 0;
+}
+
+// Always at the start of the file, so it never grows
+static int setup_write(uint64_t *args) {
+	SYS(5, user.fd, 0, SEEK_SET, U(&user.offset));
+	set_args(args, user.fd, U(user.buffer), sizeof(user.buffer), U(&user.result), 0, 0);
+	return 0;
+}
+
+static int setup_read(uint64_t *args) {
+	SYS(5, user.fd, 0, SEEK_SET, U(&user.offset));
+	set_args(args, user.fd, U(user.buffer), sizeof(user.buffer), U(&user.result), 0, 0);
+	return 0;
+}
+
+static int setup_close(uint64_t *args) {
+	int fd = -1;
+
+	if (SYS(9, U(BENCH_DATA), 0, 0, U(&fd)) != 0 || fd < 0) {
+		return -1;
+	}
+
+	set_args(args, fd, 0, 0, 0, 0, 0);
+
+	return 0;
+}
+
+static int setup_open(uint64_t *args) {
+	set_args(args, U(BENCH_DATA), 0, 0, U(&user.handle), 0, 0);
+	return 0;
+}
+
+static void teardown_open(uint64_t *args) {
+	(void)args;
+	SYS(8, user.handle);
+}
+
+static int setup_vm_map(uint64_t *args) {
+	set_args(args, 0, BENCH_MAP_SIZE, ((uint64_t)(PROT_READ | PROT_WRITE) << 32) | MAP_PRIVATE | MAP_ANONYMOUS, -1, 0, U(&user.ptr));
+	return 0;
+}
+
+static void teardown_unmap(uint64_t *args) {
+	(void)args;
+	SYS(11, U(user.ptr), BENCH_MAP_SIZE);
+}
+
+static int setup_vm_unmap(uint64_t *args) {
+	void *ptr = map_anonymous(BENCH_MAP_SIZE);
+
+	if (ptr == NULL) {
+		return -1;
+	}
+
+	set_args(args, U(ptr), BENCH_MAP_SIZE, 0, 0, 0, 0);
+
+	return 0;
+}
+
+static int setup_libc_log(uint64_t *args) {
+	set_args(args, U("bench"), 0, 0, 0, 0, 0);
+	return 0;
+}
+
+static int setup_copy_file_range(uint64_t *args) {
+	user.off_in = 0;
+	user.off_out = 0;
+	set_args(args, user.fd, U(&user.off_in), user.copy_fd, U(&user.off_out), BENCH_IO_SIZE, U(&user.result));
+	return 0;
+}
+
+static int setup_log_read(uint64_t *args) {
+	user.cursor = 0;
+	set_args(args, U(&user.cursor), U(user.buffer), sizeof(user.buffer), U(&user.result), U(&user.dropped), 0);
+	return 0;
+}
+
+// Both for no time at all, so neither parks
+static int setup_sleep(uint64_t *args) {
+	user.secs = 0;
+	user.nanos = 0;
+	set_args(args, U(&user.secs), U(&user.nanos), 0, 0, 0, 0);
+	return 0;
+}
+
+static int setup_clock_nanosleep(uint64_t *args) {
+	set_args(args, 0, 0, U(&user.zero), U(&user.zero), 0, 0);
+	return 0;
+}
+
+static int setup_epoll_ctl(uint64_t *args) {
+	user.event = (ARC_EPollEvent){ .events = ARC_EPOLL_IN, .data = 1 };
+	set_args(args, ARC_EPOLL_CTL_ADD, user.fd, U(&user.event), 0, 0, 0);
+	return 0;
+}
+
+static void teardown_epoll_ctl(uint64_t *args) {
+	(void)args;
+	SYS(17, ARC_EPOLL_CTL_DEL, user.fd, 0);
+}
+
+// The copy file is registered throughout and always ready, so there is an
+// event without waiting
+static int setup_epoll_wait(uint64_t *args) {
+	set_args(args, U(user.events), ARC_EPOLL_MAX_EVENTS, 0, U(&user.count), 0, 0);
+	return 0;
+}
+
+static int setup_thread_exit(uint64_t *args) {
+	ARC_Thread *thread = thread_create(host_process, (void *)0x1000, 0x10000);
+
+	if (thread == NULL) {
+		return -1;
+	}
+
+	switch_thread(thread);
+	set_args(args, 0, 0, 0, 0, 0, 0);
+
+	return 0;
+}
+
+static void teardown_thread_exit(uint64_t *args) {
+	(void)args;
+
+	ARC_Thread *thread = smp_get_proc_desc()->thread;
+
+	restore_thread();
+	reap_all();
+	thread_join(host_process, thread->tid, NULL);
+}
+
+static int setup_thread_join(uint64_t *args) {
+	ARC_Thread *thread = thread_create(host_process, (void *)0x1000, 0x10000);
+
+	if (thread == NULL) {
+		return -1;
+	}
+
+	thread_exit(thread, 0);
+	reap_all();
+	set_args(args, thread->tid, U(&user.code), 0, 0, 0, 0);
+
+	return 0;
+}
+
+static int setup_stats(uint64_t *args) {
+	set_args(args, U(user.stats), 0, 0, 0, 0, 0);
+	return 0;
+}
+
+static int setup_vm_merge(uint64_t *args) {
+	if ((user.ptr = map_anonymous(BENCH_MAP_SIZE)) == NULL) {
+		return -1;
+	}
+
+	set_args(args, U(user.ptr), 0, 0, 0, 0, 0);
+
+	return 0;
+}
+
+// Keeps both limits as they are
+static int setup_mem_limit(uint64_t *args) {
+	set_args(args, 0, 0, 0, 0, 0, 0);
+	return 0;
+}
+
+static int setup_affinity_set(uint64_t *args) {
+	set_args(args, smp_get_proc_desc()->thread->tid, ARC_AFFINITY_ALL, 0, 0, 0, 0);
+	return 0;
+}
+
+static int setup_affinity_get(uint64_t *args) {
+	set_args(args, smp_get_proc_desc()->thread->tid, U(&user.mask), U(&user.last), 0, 0, 0);
+	return 0;
+}
+
+static int setup_futex_lock_pi(uint64_t *args) {
+	user.pi = 0;
+	set_args(args, U(&user.pi), 0, 0, 0, 0, 0);
+	return 0;
+}
+
+static void teardown_futex_unlock_pi(uint64_t *args) {
+	(void)args;
+	SYS(30, U(&user.pi));
+}
+
+static int setup_futex_unlock_pi(uint64_t *args) {
+	user.pi = 0;
+
+	if (SYS(29, U(&user.pi), 0) != 0) {
+		return -1;
+	}
+
+	set_args(args, U(&user.pi), 0, 0, 0, 0, 0);
+
+	return 0;
+}
+
+static int setup_pipe_create(uint64_t *args) {
+	set_args(args, 0, U(user.handles), 0, 0, 0, 0);
+	return 0;
+}
+
+static void teardown_pipe_create(uint64_t *args) {
+	(void)args;
+	SYS(34, user.handles[0]);
+	SYS(34, user.handles[1]);
+}
+
+static int setup_pipe_open(uint64_t *args) {
+	set_args(args, U(user.pipe_name), ARC_PIPE_READ, U(&user.handle), 0, 0, 0);
+	return 0;
+}
+
+static void teardown_pipe_open(uint64_t *args) {
+	(void)args;
+	SYS(34, user.handle);
+}
+
+static int setup_ipc_close(uint64_t *args) {
+	int handle = -1;
+
+	if (SYS(33, U(user.pipe_name), ARC_PIPE_READ, U(&handle)) != 0) {
+		return -1;
+	}
+
+	set_args(args, handle, 0, 0, 0, 0, 0);
+
+	return 0;
+}
+
+static int setup_pipe_write(uint64_t *args) {
+	set_args(args, user.pipe[1], U(user.buffer), sizeof(user.buffer), 0, U(&user.result), 0);
+	return 0;
+}
+
+static void teardown_pipe_write(uint64_t *args) {
+	(void)args;
+	SYS(36, user.pipe[0], U(user.buffer), sizeof(user.buffer), ARC_PIPE_NONBLOCK, U(&user.result));
+}
+
+static int setup_pipe_read(uint64_t *args) {
+	if (SYS(35, user.pipe[1], U(user.buffer), sizeof(user.buffer), 0, U(&user.result)) != 0) {
+		return -1;
+	}
+
+	set_args(args, user.pipe[0], U(user.buffer), sizeof(user.buffer), ARC_PIPE_NONBLOCK, U(&user.result), 0);
+
+	return 0;
+}
+
+// A whole buffer mapping given to the pipe, which the read maps in
+static int setup_pipe_read_map(uint64_t *args) {
+	void *ptr = NULL;
+
+	if (SYS(38, PAGE_SIZE, U(&ptr)) != 0
+	    || SYS(35, user.pipe[1], U(ptr), PAGE_SIZE, ARC_PIPE_GIFT, U(&user.result)) != 0) {
+		return -1;
+	}
+
+	set_args(args, user.pipe[0], ARC_PIPE_NONBLOCK, U(&user.ptr), U(&user.result), 0, 0);
+
+	return 0;
+}
+
+static void teardown_page_unmap(uint64_t *args) {
+	(void)args;
+	SYS(11, U(user.ptr), PAGE_SIZE);
+}
+
+static int setup_ipc_buffer_map(uint64_t *args) {
+	set_args(args, PAGE_SIZE, U(&user.ptr), 0, 0, 0, 0);
+	return 0;
+}
+
+static int setup_shm_map(uint64_t *args) {
+	set_args(args, U(user.shm_name), PAGE_SIZE, 1, U(&user.ptr), 0, 0);
+	return 0;
+}
+
+static void teardown_shm_map(uint64_t *args) {
+	teardown_page_unmap(args);
+	SYS(40, U(user.shm_name));
+}
+
+static int setup_ipc_unlink(uint64_t *args) {
+	void *ptr = NULL;
+
+	if (SYS(39, U(user.shm_name), PAGE_SIZE, 1, U(&ptr)) != 0) {
+		return -1;
+	}
+
+	SYS(11, U(ptr), PAGE_SIZE);
+	set_args(args, U(user.shm_name), 0, 0, 0, 0, 0);
+
+	return 0;
+}
+
+static int setup_template_capture(uint64_t *args) {
+	set_args(args, U(&user.id), 0, 0, 0, 0, 0);
+	return 0;
+}
+
+static void teardown_template_capture(uint64_t *args) {
+	(void)args;
+	SYS(43, user.id);
+}
+
+static int setup_template_spawn(uint64_t *args) {
+	set_args(args, template_id, U(&user.pid), 0, 0, 0, 0);
+	return 0;
+}
+
+static void teardown_template_spawn(uint64_t *args) {
+	(void)args;
+
+	process_delete(spawned);
+	reap_all();
+}
+
+static int setup_template_destroy(uint64_t *args) {
+	int id = -1;
+
+	if (SYS(41, U(&id)) != 0) {
+		return -1;
+	}
+
+	set_args(args, id, 0, 0, 0, 0, 0);
+
+	return 0;
+}
+
+static const struct syscall_case cases[] = {
+	[0] = { "tcb_set", setup_tcb_set, teardown_tcb_set, 0, false },
+	[1] = { "futex_wait", setup_futex_wait, NULL, -1, false },
+	[2] = { "futex_wake", setup_futex_wake, NULL, 0, false },
+	[3] = { "clock_get", setup_clock_get, NULL, 0, false },
+	[4] = { "exit", setup_exit, teardown_exit, 0, true },
+	[5] = { "seek", setup_seek, NULL, 0, false },
+	[6] = { "write", setup_write, NULL, 0, false },
+	[7] = { "read", setup_read, NULL, 0, false },
+	[8] = { "close", setup_close, NULL, 0, false },
+	[9] = { "open", setup_open, teardown_open, 0, false },
+	[10] = { "vm_map", setup_vm_map, teardown_unmap, 0, false },
+	[11] = { "vm_unmap", setup_vm_unmap, NULL, 0, false },
+	[12] = { "libc_log", setup_libc_log, NULL, 0, false },
+	[13] = { "copy_file_range", setup_copy_file_range, NULL, 0, false },
+	[14] = { "log_read", setup_log_read, NULL, 0, false },
+	[15] = { "sleep", setup_sleep, NULL, 0, false },
+	[16] = { "clock_nanosleep", setup_clock_nanosleep, NULL, 0, false },
+	[17] = { "epoll_ctl", setup_epoll_ctl, teardown_epoll_ctl, 0, false },
+	[18] = { "epoll_wait", setup_epoll_wait, NULL, 0, false },
+	[19] = { "thread_exit", setup_thread_exit, teardown_thread_exit, 0, true },
+	[20] = { "thread_join", setup_thread_join, NULL, 0, false },
+	[21] = { "swap_stats", setup_stats, NULL, 0, false },
+	[22] = { "vm_merge", setup_vm_merge, teardown_unmap, 0, false },
+	[23] = { "ksm_stats", setup_stats, NULL, 0, false },
+	[24] = { "mem_stats", setup_stats, NULL, 0, false },
+	[25] = { "mem_limit", setup_mem_limit, NULL, 0, false },
+	[26] = { "spawn_stats", setup_stats, NULL, 0, false },
+	[27] = { "affinity_set", setup_affinity_set, NULL, 0, false },
+	[28] = { "affinity_get", setup_affinity_get, NULL, 0, false },
+	[29] = { "futex_lock_pi", setup_futex_lock_pi, teardown_futex_unlock_pi, 0, false },
+	[30] = { "futex_unlock_pi", setup_futex_unlock_pi, NULL, 0, false },
+	[31] = { "futex_trylock_pi", setup_futex_lock_pi, teardown_futex_unlock_pi, 0, false },
+	[32] = { "pipe_create", setup_pipe_create, teardown_pipe_create, 0, false },
+	[33] = { "pipe_open", setup_pipe_open, teardown_pipe_open, 0, false },
+	[34] = { "ipc_close", setup_ipc_close, NULL, 0, false },
+	[35] = { "pipe_write", setup_pipe_write, teardown_pipe_write, 0, false },
+	[36] = { "pipe_read", setup_pipe_read, NULL, 0, false },
+	[37] = { "pipe_read_map", setup_pipe_read_map, teardown_page_unmap, 0, false },
+	[38] = { "ipc_buffer_map", setup_ipc_buffer_map, teardown_page_unmap, 0, false },
+	[39] = { "shm_map", setup_shm_map, teardown_shm_map, 0, false },
+	[40] = { "ipc_unlink", setup_ipc_unlink, NULL, 0, false },
+	[41] = { "template_capture", setup_template_capture, teardown_template_capture, 0, false, true },
+	[42] = { "template_spawn", setup_template_spawn, teardown_template_spawn, 0, false },
+	[43] = { "template_destroy", setup_template_destroy, NULL, 0, false, true },
+};
+
+static int run_call(int index, const struct syscall_case *c, uint64_t *args, uint64_t *ns) {
+	uint64_t start = now_ns();
+
+	if (!c->noreturn) {
+		int ret = call(index, args);
+		*ns += now_ns() - start;
+
+		return ret;
+	}
+
+	jmp_buf escape;
+
+	if (setjmp(escape) != 0) {
+		*ns += now_ns() - start;
+		host_yield_escape = NULL;
+
+		return 0;
+	}
+
+	host_yield_escape = &escape;
+	call(index, args);
+
+	// Came back after all
+	host_yield_escape = NULL;
+
+	return -1;
+}
+
+// Where a run of a case failed, if it did
+struct run {
+	uint64_t ns;
+	int iteration;
+	// What the call returned, unless the setup failed
+	int ret;
+	bool setup;
+};
+
+static const struct syscall_case *get_case(int index) {
+	const struct syscall_case *c = (size_t)index < sizeof(cases) / sizeof(*cases) ? &cases[index] : NULL;
+
+	return c == NULL || c->name == NULL ? NULL : c;
+}
+
+static int run_iterations(int index, int iterations, struct run *run) {
+	const struct syscall_case *c = get_case(index);
+
+	*run = (struct run){ .iteration = -1 };
+
+	for (int i = 0; i < iterations; i++) {
+		uint64_t args[6] = { 0 };
+
+		if (c->setup != NULL && c->setup(args) != 0) {
+			run->iteration = i;
+			run->setup = true;
+			return -1;
+		}
+
+		int ret = run_call(index, c, args, &run->ns);
+
+		if (c->teardown != NULL) {
+			c->teardown(args);
+		}
+
+		if (ret != c->expect) {
+			run->iteration = i;
+			run->ret = ret;
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static void print_failure(const char *prefix, const struct run *run) {
+	if (run->setup) {
+		printf("%s failed %d setup\n", prefix, run->iteration);
+	} else {
+		printf("%s failed %d %d\n", prefix, run->iteration, run->ret);
+	}
+}
+
+static void run_case(int index, int iterations) {
+	const struct syscall_case *c = get_case(index);
+
+	if (c == NULL) {
+		printf("syscall %d - missing\n", index);
+		return;
+	}
+
+	struct run run;
+	char prefix[64];
+
+	snprintf(prefix, sizeof(prefix), "syscall %d %s", index, c->name);
+
+	if (run_iterations(index, iterations, &run) != 0) {
+		print_failure(prefix, &run);
+		return;
+	}
+
+	printf("%s %d %lu %lu\n", prefix, iterations, run.ns, run.ns / iterations);
+}
+
+// Opens what the cases share, under names of the caller's own
+static int setup_user(int worker) {
+	snprintf(user.pipe_name, sizeof(user.pipe_name), "%s_%d", BENCH_PIPE, worker);
+	snprintf(user.shm_name, sizeof(user.shm_name), "%s_%d", BENCH_SHM, worker);
+
+	user.fd = -1;
+	user.copy_fd = -1;
+	user.pipe[0] = user.pipe[1] = -1;
+	user.named[0] = user.named[1] = -1;
+
+	if (SYS(9, U(BENCH_DATA), 0, 0, U(&user.fd)) != 0 || SYS(9, U(BENCH_COPY), 0, 0, U(&user.copy_fd)) != 0) {
+		return -1;
+	}
+
+	user.event = (ARC_EPollEvent){ .events = ARC_EPOLL_IN, .data = 0 };
+
+	if (SYS(17, ARC_EPOLL_CTL_ADD, user.copy_fd, U(&user.event)) != 0) {
+		return -1;
+	}
+
+	return SYS(32, 0, U(user.pipe)) != 0 || SYS(32, U(user.pipe_name), U(user.named)) != 0 ? -1 : 0;
+}
+
+static void teardown_user(void) {
+	SYS(40, U(user.pipe_name));
+	SYS(34, user.named[0]);
+	SYS(34, user.named[1]);
+	SYS(34, user.pipe[0]);
+	SYS(34, user.pipe[1]);
+	SYS(17, ARC_EPOLL_CTL_DEL, user.copy_fd, 0);
+	SYS(8, user.fd);
+	SYS(8, user.copy_fd);
+}
+
+struct worker {
+	pthread_t pthread;
+	ARC_Thread *thread;
+	int index;
+	int ret;
+	struct run run;
+};
+
+// The workers wait at start for a case and at done once they have run it
+static struct {
+	pthread_barrier_t start;
+	pthread_barrier_t done;
+	// The case, -1 once there are none left
+	int index;
+	int threads;
+	int iterations;
+	struct worker workers[BENCH_MAX_THREADS];
+} scaling;
+
+static void *run_worker(void *arg) {
+	struct worker *worker = (struct worker *)arg;
+
+	smp_get_proc_desc()->thread = worker->thread;
+	smp_get_proc_desc()->process = host_process;
+
+	worker->ret = setup_user(worker->index);
+	pthread_barrier_wait(&scaling.done);
+
+	while (true) {
+		// Waiting at the barrier is idling as far as the reaper can tell
+		reaper_idle();
+		pthread_barrier_wait(&scaling.start);
+
+		if (scaling.index < 0) {
+			break;
+		}
+
+		if (worker->index < scaling.threads) {
+			reaper_run(0);
+			worker->ret = run_iterations(scaling.index, scaling.iterations, &worker->run);
+		}
+
+		pthread_barrier_wait(&scaling.done);
+	}
+
+	reaper_run(0);
+	teardown_user();
+	pthread_barrier_wait(&scaling.done);
+
+	// Once every worker has reported after its teardown, all that any of
+	// them deferred has had its grace period
+	reaper_run(0);
+	pthread_barrier_wait(&scaling.done);
+	reap_all();
+	reaper_idle();
+
+	return NULL;
+}
+
+static void run_scaling(int index, int threads) {
+	const struct syscall_case *c = get_case(index);
+
+	if (c == NULL || c->single) {
+		return;
+	}
+
+	scaling.index = index;
+	scaling.threads = threads;
+	pthread_barrier_wait(&scaling.start);
+	pthread_barrier_wait(&scaling.done);
+
+	char prefix[80];
+	uint64_t ns = 0;
+
+	snprintf(prefix, sizeof(prefix), "syscall %d %s threads %d", index, c->name, threads);
+
+	for (int i = 0; i < threads; i++) {
+		struct worker *worker = &scaling.workers[i];
+
+		if (worker->ret != 0) {
+			print_failure(prefix, &worker->run);
+			return;
+		}
+
+		ns += worker->run.ns;
+	}
+
+	printf("%s %d %lu %lu\n", prefix, scaling.iterations, ns, ns / ((uint64_t)threads * scaling.iterations));
+}
+
+static int bench_scaling(int iterations) {
+	long processors = sysconf(_SC_NPROCESSORS_ONLN);
+	int max = 2;
+
+	while (max * 2 <= processors && max * 2 <= BENCH_MAX_THREADS) {
+		max *= 2;
+	}
+
+	int count = 0;
+
+	for (; count < max; count++) {
+		struct worker *worker = &scaling.workers[count];
+
+		*worker = (struct worker){ .index = count };
+
+		if ((worker->thread = thread_create(host_process, (void *)0x1000, 0x10000)) == NULL) {
+			break;
+		}
+	}
+
+	int ret = count == max ? 0 : -1;
+
+	scaling.iterations = iterations;
+	pthread_barrier_init(&scaling.start, NULL, count + 1);
+	pthread_barrier_init(&scaling.done, NULL, count + 1);
+
+	for (int i = 0; i < count; i++) {
+		if (pthread_create(&scaling.workers[i].pthread, NULL, run_worker, &scaling.workers[i]) != 0) {
+			// The barriers would never fill
+			fprintf(stderr, "Failed to start the syscall workers\n");
+			exit(1);
+		}
+	}
+
+	pthread_barrier_wait(&scaling.done);
+
+	for (int i = 0; i < count; i++) {
+		ret |= scaling.workers[i].ret;
+	}
+
+	// Only waits for the workers from here on
+	reaper_idle();
+
+	for (int threads = 1; ret == 0 && threads <= max; threads *= 2) {
+		for (size_t i = 0; i < Arc_SyscallCount; i++) {
+			run_scaling(i, threads);
+		}
+	}
+
+	scaling.index = -1;
+	pthread_barrier_wait(&scaling.start);
+	pthread_barrier_wait(&scaling.done);
+	pthread_barrier_wait(&scaling.done);
+
+	for (int i = 0; i < count; i++) {
+		pthread_join(scaling.workers[i].pthread, NULL);
+	}
+
+	pthread_barrier_destroy(&scaling.start);
+	pthread_barrier_destroy(&scaling.done);
+
+	for (int i = 0; i < count; i++) {
+		ARC_Thread *thread = scaling.workers[i].thread;
+
+		thread_exit(thread, 0);
+		reap_all();
+		thread_join(host_process, thread->tid, NULL);
+	}
+
+	return ret;
+}
+
+int bench_syscalls(int iterations) {
+	static uint8_t data[0x10000] = { 0 };
+
+	if (host_vfs_add(BENCH_DATA, data, sizeof(data)) != 0 || host_vfs_add(BENCH_COPY, NULL, 0) != 0
+	    || setup_user(0) != 0) {
+		return -1;
+	}
+
+	int id = -1;
+
+	if (SYS(41, U(&id)) != 0) {
+		return -1;
+	}
+
+	template_id = id;
+
+	for (size_t i = 0; i < Arc_SyscallCount; i++) {
+		run_case(i, iterations);
+	}
+
+	teardown_user();
+
+	// Before the template goes, template_spawn runs from the workers too
+	int ret = bench_scaling(iterations);
+
+	SYS(43, template_id);
+
+	return ret;
+}
@@ -0,0 +1,59 @@
+/**
+ * @file context.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#ifndef ARC_HOST_ARCH_CONTEXT_H
+#define ARC_HOST_ARCH_CONTEXT_H
+
+#include <stdint.h>
+
+#define ARC_CONTEXT_FLAG_FLOATS 0
+
+typedef struct ARC_ProcessorFeatures {
+	uint64_t flags;
+} ARC_ProcessorFeatures;
+
+typedef struct ARC_Context {
+	void *entry;
+	void *stack;
+	void *tables;
+	void *tcb;
+	int userspace;
+	// What the system call the state was saved in returns
+	uint64_t ret;
+} ARC_Context;
+
+ARC_Context *init_context(uint64_t flags, ARC_ProcessorFeatures *features);
+int uninit_context(ARC_Context *context);
+void context_setup_for_thread(ARC_Context *context, void *entry, void *stack, void *tables, int userspace);
+void context_set_tcb(ARC_Context *context, void *tcb);
+// Saves the state the current thread is to return to its caller with from the
+// system call it is in, with ret as the result of the call
+int context_save_syscall(ARC_Context *context, uint64_t ret);
+// Sets context up to resume where from was saved, in the address space of
+// tables
+void context_setup_from(ARC_Context *context, ARC_Context *from, void *tables, int userspace);
+
+#endif
@@ -0,0 +1,44 @@
+/**
+ * @file pager.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#ifndef ARC_HOST_ARCH_PAGER_H
+#define ARC_HOST_ARCH_PAGER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ARC_PAGER_RW 1
+#define ARC_PAGER_US 2
+#define ARC_PAGER_NX 3
+
+// Page tables only record what is mapped where, so that pager_unmap can hand
+// back the physical address
+void *pager_create_page_tables(void);
+int pager_map(void *tables, uintptr_t virt, uintptr_t phys, size_t size, uint32_t flags);
+int pager_unmap(void *tables, uintptr_t virt, size_t size, void **phys);
+int pager_clone(void *tables, void *from, uintptr_t virt, uintptr_t phys, size_t size);
+
+#endif
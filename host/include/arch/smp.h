@@ -0,0 +1,43 @@
+/**
+ * @file smp.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#ifndef ARC_HOST_ARCH_SMP_H
+#define ARC_HOST_ARCH_SMP_H
+
+struct ARC_Thread;
+struct ARC_Process;
+
+typedef struct ARC_ProcessorDescriptor {
+	struct ARC_Thread *thread;
+	struct ARC_Process *process;
+} ARC_ProcessorDescriptor;
+
+// Every host thread is a processor of its own, the benchmarks point it at
+// the thread they act as
+ARC_ProcessorDescriptor *smp_get_proc_desc(void);
+void smp_map_processor_structures(void *tables);
+
+#endif
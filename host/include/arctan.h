@@ -0,0 +1,71 @@
+/**
+ * @file arctan.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#ifndef ARC_HOST_ARCTAN_H
+#define ARC_HOST_ARCTAN_H
+
+// Stand-in for the kernel's own, enough for the userspace module to build and
+// run as a Linux program
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PAGE_SIZE 0x1000
+
+// Memory handed out by the stand-in PMM is ordinary heap memory, so the HHDM
+// is the identity
+#define ARC_HHDM_TO_PHYS(x) ((uintptr_t)(x))
+#define ARC_PHYS_TO_HHDM(x) ((uintptr_t)(x))
+
+#define ALIGN(v, a) (((v) + ((a) - 1)) & ~((a) - 1))
+#define STACK_START(base, size, align) (((uintptr_t)(base) + (size)) & ~((uintptr_t)(align) - 1))
+#define STATIC_ASSERT(cond, msg) _Static_assert(cond, msg)
+
+#define ARC_HANG abort()
+
+// Levels switched on by the host, INFO with DEBUG=1, see host/Makefile
+#ifndef ARC_HOST_DEBUG_INFO
+#define ARC_HOST_DEBUG_INFO 0
+#endif
+#define ARC_HOST_DEBUG_WARN 1
+#define ARC_HOST_DEBUG_ERR 1
+
+#define ARC_DEBUG(level, ...) \
+	do { if (ARC_HOST_DEBUG_##level) fprintf(stderr, __VA_ARGS__); } while (0)
+
+// Kernel output stays off stdout, which carries the benchmark results, and
+// is only wanted along with the INFO level
+#define printf(...) ARC_DEBUG(INFO, __VA_ARGS__)
+
+// Sections of the kernel image, only their addresses are used
+extern char __USERSPACE_START__, __USERSPACE_END__, __KERNEL_START__, __KERNEL_END__;
+extern uintptr_t Arc_KernelPageTables;
+
+#endif
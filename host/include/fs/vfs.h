@@ -0,0 +1,54 @@
+/**
+ * @file vfs.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#ifndef ARC_HOST_FS_VFS_H
+#define ARC_HOST_FS_VFS_H
+
+#include "drivers/resource.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Files live in memory, added by the benchmarks before anything opens them
+typedef struct ARC_VFSNode {
+	struct ARC_VFSNode *next;
+	char *path;
+	uint8_t *data;
+	size_t size;
+	size_t capacity;
+	uint64_t ref_count;
+} ARC_VFSNode;
+
+int vfs_open(char *path, int flags, uint32_t mode, ARC_File **file);
+int vfs_close(ARC_File *file);
+long vfs_read(void *buffer, size_t size, size_t count, ARC_File *file);
+long vfs_write(void *buffer, size_t size, size_t count, ARC_File *file);
+long vfs_seek(ARC_File *file, long offset, int whence);
+
+// Adds, or replaces, the file at path with a copy of size bytes of data
+int host_vfs_add(const char *path, const void *data, size_t size);
+
+#endif
@@ -0,0 +1,44 @@
+/**
+ * @file scheduler.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#ifndef ARC_HOST_MP_SCHEDULER_H
+#define ARC_HOST_MP_SCHEDULER_H
+
+#define ARC_THREAD_READY   0
+#define ARC_THREAD_RUNNING 1
+
+#include <setjmp.h>
+
+// Nothing else to run, so nothing that waits on another thread makes
+// progress
+void sched_yield_cpu(void);
+
+// Set by the benchmarks around handlers that never return, the yield that
+// would leave the thread for good jumps back to it instead, one per host
+// thread
+extern __thread jmp_buf *host_yield_escape;
+
+#endif
@@ -0,0 +1,42 @@
+/**
+ * @file loader_defs.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#ifndef ARC_HOST_USERSPACE_LOADER_DEFS_H
+#define ARC_HOST_USERSPACE_LOADER_DEFS_H
+
+// Stands in for the generated header, declaring the loaders built here
+
+#include "userspace/loader.h"
+
+#include <stddef.h>
+
+extern ARC_ProgramLoaderDef _ldrdefs_elf_ARC_LDRGRP_64BIT;
+extern ARC_ProgramLoaderDef _ldrdefs_elf_ARC_LDRGRP_32BIT;
+
+extern ARC_ProgramLoaderDef *arc_ldrs_64BIT[1];
+extern ARC_ProgramLoaderDef *arc_ldrs_32BIT[1];
+
+#endif
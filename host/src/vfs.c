@@ -0,0 +1,228 @@
+/**
+ * @file vfs.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#include "abi-bits/seek-whence.h"
+#include "fs/vfs.h"
+#include "global.h"
+#include "lib/spinlock.h"
+
+static ARC_Spinlock vfs_lock = { 0 };
+static ARC_VFSNode *nodes = NULL;
+
+static ARC_VFSNode *find_node(const char *path) {
+	for (ARC_VFSNode *node = nodes; node != NULL; node = node->next) {
+		if (strcmp(node->path, path) == 0) {
+			return node;
+		}
+	}
+
+	return NULL;
+}
+
+int host_vfs_add(const char *path, const void *data, size_t size) {
+	if (path == NULL || (data == NULL && size != 0)) {
+		return -1;
+	}
+
+	uint8_t *copy = (uint8_t *)malloc(size == 0 ? 1 : size);
+
+	if (copy == NULL) {
+		return -2;
+	}
+
+	memcpy(copy, data, size);
+
+	spinlock_lock(&vfs_lock);
+
+	ARC_VFSNode *node = find_node(path);
+
+	if (node == NULL) {
+		if ((node = (ARC_VFSNode *)calloc(1, sizeof(*node))) == NULL || (node->path = strdup(path)) == NULL) {
+			spinlock_unlock(&vfs_lock);
+			free(node);
+			free(copy);
+			return -2;
+		}
+
+		node->next = nodes;
+		nodes = node;
+	} else {
+		free(node->data);
+	}
+
+	node->data = copy;
+	node->size = size;
+	node->capacity = size;
+
+	spinlock_unlock(&vfs_lock);
+
+	return 0;
+}
+
+// Nodes are never freed, ref_count only counts who holds one
+int vfs_open(char *path, int flags, uint32_t mode, ARC_File **file) {
+	(void)mode;
+
+	if (path == NULL || file == NULL) {
+		return -1;
+	}
+
+	spinlock_lock(&vfs_lock);
+	ARC_VFSNode *node = find_node(path);
+	spinlock_unlock(&vfs_lock);
+
+	if (node == NULL) {
+		return -2;
+	}
+
+	ARC_File *ret = (ARC_File *)calloc(1, sizeof(*ret));
+
+	if (ret == NULL) {
+		return -3;
+	}
+
+	ret->node = node;
+	ret->flags = flags;
+	__atomic_add_fetch(&node->ref_count, 1, __ATOMIC_RELAXED);
+
+	*file = ret;
+
+	return 0;
+}
+
+int vfs_close(ARC_File *file) {
+	if (file == NULL) {
+		return -1;
+	}
+
+	__atomic_sub_fetch(&file->node->ref_count, 1, __ATOMIC_RELAXED);
+	free(file);
+
+	return 0;
+}
+
+long vfs_read(void *buffer, size_t size, size_t count, ARC_File *file) {
+	if (buffer == NULL || file == NULL) {
+		return -1;
+	}
+
+	ARC_VFSNode *node = file->node;
+	size_t want = size * count;
+
+	spinlock_lock(&vfs_lock);
+
+	if (file->offset < 0 || (size_t)file->offset >= node->size) {
+		spinlock_unlock(&vfs_lock);
+		return 0;
+	}
+
+	if (want > node->size - file->offset) {
+		want = node->size - file->offset;
+	}
+
+	// A write from another thread may move the data
+	memcpy(buffer, node->data + file->offset, want);
+	file->offset += want;
+	spinlock_unlock(&vfs_lock);
+
+	return want;
+}
+
+long vfs_write(void *buffer, size_t size, size_t count, ARC_File *file) {
+	if (buffer == NULL || file == NULL || file->offset < 0) {
+		return -1;
+	}
+
+	ARC_VFSNode *node = file->node;
+	size_t want = size * count;
+	size_t end = file->offset + want;
+
+	spinlock_lock(&vfs_lock);
+
+	if (end > node->capacity) {
+		size_t capacity = end < node->capacity * 2 ? node->capacity * 2 : end;
+		uint8_t *data = (uint8_t *)realloc(node->data, capacity);
+
+		if (data == NULL) {
+			spinlock_unlock(&vfs_lock);
+			return -2;
+		}
+
+		node->data = data;
+		node->capacity = capacity;
+	}
+
+	if ((size_t)file->offset > node->size) {
+		memset(node->data + node->size, 0, file->offset - node->size);
+	}
+
+	memcpy(node->data + file->offset, buffer, want);
+	file->offset = end;
+
+	if (end > node->size) {
+		node->size = end;
+	}
+
+	spinlock_unlock(&vfs_lock);
+
+	return want;
+}
+
+long vfs_seek(ARC_File *file, long offset, int whence) {
+	if (file == NULL) {
+		return -1;
+	}
+
+	long base = 0;
+
+	switch (whence) {
+	case SEEK_SET: {
+		break;
+	}
+
+	case SEEK_CUR: {
+		base = file->offset;
+		break;
+	}
+
+	case SEEK_END: {
+		base = file->node->size;
+		break;
+	}
+
+	default: {
+		return -1;
+	}
+	}
+
+	if (base + offset < 0) {
+		return -1;
+	}
+
+	file->offset = base + offset;
+
+	return file->offset;
+}
@@ -0,0 +1,156 @@
+;/**
+; * @file usercopy.asm
+; *
+; * @author awewsomegamer <awewsomegamer@gmail.com>
+; *
+; * @LICENSE
+; * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+; * Copyright (C) 2023-2026 awewsomegamer
+; *
+; * This file is part of Arctan-OS/Kuserspace
+; *
+; * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+; * modify it under the terms of the GNU General Public License
+; * as published by the Free Software Foundation; version 2
+; *
+; * This program is distributed in the hope that it will be useful,
+; * but WITHOUT ANY WARRANTY; without even the implied warranty of
+; * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+; * GNU General Public License for more details.
+; *
+; * You should have received a copy of the GNU General Public License
+; * along with this program; if not, write to the Free Software
+; * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+; *
+; * @DESCRIPTION
+; * Raw copy routines for moving data across the user/kernel boundary. Every
+; * instruction that touches user memory has an entry in Arc_UserCopyFixups,
+; * the page fault handler resumes at the paired address instead of faulting
+; * the kernel.
+;*/
+bits 64
+
+; Copies at or above this size go through rep movsb (ERMS), below it the
+; startup cost of the string instruction dominates
+%define REP_THRESHOLD 256
+
+section .text
+
+; size_t __arc_copy_user(void *dst, const void *src, size_t size)
+; Returns the number of bytes not copied
+global __arc_copy_user
+__arc_copy_user:
+        mov rcx, rdx
+        cmp rcx, REP_THRESHOLD
+        jae .rep
+
+.blocks:
+        cmp rcx, 32
+        jb .qwords
+.b_load0: mov rax, [rsi]
+.b_load1: mov r8, [rsi + 8]
+.b_load2: mov r9, [rsi + 16]
+.b_load3: mov r10, [rsi + 24]
+.b_store0: mov [rdi], rax
+.b_store1: mov [rdi + 8], r8
+.b_store2: mov [rdi + 16], r9
+.b_store3: mov [rdi + 24], r10
+        add rsi, 32
+        add rdi, 32
+        sub rcx, 32
+        jmp .blocks
+
+.qwords:
+        cmp rcx, 8
+        jb .bytes
+.q_load: mov rax, [rsi]
+.q_store: mov [rdi], rax
+        add rsi, 8
+        add rdi, 8
+        sub rcx, 8
+        jmp .qwords
+
+.bytes:
+        test rcx, rcx
+        jz .done
+.c_load: mov al, [rsi]
+.c_store: mov [rdi], al
+        inc rsi
+        inc rdi
+        dec rcx
+        jmp .bytes
+
+.rep:
+.r_movs: rep movsb
+
+.done:
+.fault:
+        mov rax, rcx
+        ret
+
+; long __arc_strncpy_user(char *dst, const char *src, size_t max)
+; Returns the length of the string without its terminator, max if no terminator
+; was found, -1 on fault
+global __arc_strncpy_user
+__arc_strncpy_user:
+        xor rax, rax
+
+.loop:
+        cmp rax, rdx
+        jae .done
+.s_load: mov cl, [rsi + rax]
+        mov [rdi + rax], cl
+        test cl, cl
+        jz .done
+        inc rax
+        jmp .loop
+
+.done:
+        ret
+
+.fault:
+        mov rax, -1
+        ret
+
+; int __arc_cmpxchg_user(int *ptr, int *expected, int desired)
+; Returns 0 if desired was stored, 1 if *ptr differed (its value is written to
+; *expected), -1 on fault
+global __arc_cmpxchg_user
+__arc_cmpxchg_user:
+        mov eax, [rsi]
+.x_cmpxchg: lock cmpxchg [rdi], edx
+        jne .differ
+        xor eax, eax
+        ret
+
+.differ:
+        mov [rsi], eax
+        mov eax, 1
+        ret
+
+.fault:
+        mov eax, -1
+        ret
+
+section .rodata
+
+; Pairs of faulting instruction, resume address
+global Arc_UserCopyFixups
+global Arc_UserCopyFixupsEnd
+Arc_UserCopyFixups:
+        dq __arc_copy_user.b_load0, __arc_copy_user.fault
+        dq __arc_copy_user.b_load1, __arc_copy_user.fault
+        dq __arc_copy_user.b_load2, __arc_copy_user.fault
+        dq __arc_copy_user.b_load3, __arc_copy_user.fault
+        dq __arc_copy_user.b_store0, __arc_copy_user.fault
+        dq __arc_copy_user.b_store1, __arc_copy_user.fault
+        dq __arc_copy_user.b_store2, __arc_copy_user.fault
+        dq __arc_copy_user.b_store3, __arc_copy_user.fault
+        dq __arc_copy_user.q_load, __arc_copy_user.fault
+        dq __arc_copy_user.q_store, __arc_copy_user.fault
+        dq __arc_copy_user.c_load, __arc_copy_user.fault
+        dq __arc_copy_user.c_store, __arc_copy_user.fault
+        dq __arc_copy_user.r_movs, __arc_copy_user.fault
+        dq __arc_strncpy_user.s_load, __arc_strncpy_user.fault
+        dq __arc_cmpxchg_user.x_cmpxchg, __arc_cmpxchg_user.fault
+Arc_UserCopyFixupsEnd:
@@ -0,0 +1,265 @@
+/**
+ * @file affinity.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#include "arch/smp.h"
+#include "global.h"
+#include "lib/spinlock.h"
+#include "userspace/affinity.h"
+#include "userspace/percpu.h"
+
+static struct {
+	// Threads counted on each processor
+	uint32_t load[ARC_USERSPACE_CPU_SLOTS];
+} cpus = { 0 };
+
+static uint32_t least_loaded(uint64_t mask) {
+	uint32_t self = percpu_slot();
+	uint64_t allowed = mask & percpu_online_mask();
+
+	if (mask == 0) {
+		// Nowhere to go, stay here
+		return self;
+	}
+
+	if (allowed == 0) {
+		// None of the allowed processors are up, stay close
+		return (mask & (1ULL << self)) ? self : (uint32_t)__builtin_ctzll(mask);
+	}
+
+	uint32_t best = ARC_AFFINITY_NONE;
+	uint32_t best_load = UINT32_MAX;
+
+	while (allowed != 0) {
+		uint32_t slot = __builtin_ctzll(allowed);
+		uint32_t load = __atomic_load_n(&cpus.load[slot], __ATOMIC_RELAXED);
+		allowed &= allowed - 1;
+
+		// Ties go to the current processor
+		if (load < best_load || (load == best_load && slot == self)) {
+			best = slot;
+			best_load = load;
+		}
+	}
+
+	return best;
+}
+
+// Moves the thread's count to slot
+static void retarget(ARC_Thread *thread, uint32_t slot) {
+	__atomic_add_fetch(&cpus.load[slot], 1, __ATOMIC_RELAXED);
+	uint32_t old = __atomic_exchange_n(&thread->cpu.target, slot, __ATOMIC_ACQ_REL);
+
+	if (old == ARC_AFFINITY_NONE) {
+		// Removed in the meantime, it stays that way
+		__atomic_store_n(&thread->cpu.target, ARC_AFFINITY_NONE, __ATOMIC_RELEASE);
+		__atomic_sub_fetch(&cpus.load[slot], 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	__atomic_sub_fetch(&cpus.load[old], 1, __ATOMIC_RELAXED);
+}
+
+uint32_t affinity_place(ARC_Thread *thread) {
+	if (thread == NULL || thread->cpu.mask == 0) {
+		return ARC_AFFINITY_NONE;
+	}
+
+	uint32_t slot = least_loaded(thread->cpu.mask);
+
+	__atomic_add_fetch(&cpus.load[slot], 1, __ATOMIC_RELAXED);
+	thread->cpu.target = slot;
+	thread->cpu.last = ARC_AFFINITY_NONE;
+
+	return slot;
+}
+
+uint32_t affinity_wake(ARC_Thread *thread) {
+	if (thread == NULL) {
+		return ARC_AFFINITY_NONE;
+	}
+
+	uint64_t mask = __atomic_load_n(&thread->cpu.mask, __ATOMIC_RELAXED);
+	uint32_t last = __atomic_load_n(&thread->cpu.last, __ATOMIC_RELAXED);
+	uint32_t target = __atomic_load_n(&thread->cpu.target, __ATOMIC_ACQUIRE);
+
+	if (target == ARC_AFFINITY_NONE) {
+		return ARC_AFFINITY_NONE;
+	}
+
+	uint32_t best = least_loaded(mask);
+
+	if (last != ARC_AFFINITY_NONE && (mask & (1ULL << last))) {
+		uint32_t last_load = __atomic_load_n(&cpus.load[last], __ATOMIC_RELAXED);
+		uint32_t best_load = __atomic_load_n(&cpus.load[best], __ATOMIC_RELAXED);
+
+		// Its caches and TLB may still be warm there
+		if (last_load <= best_load + ARC_AFFINITY_WARM_SLACK) {
+			best = last;
+		}
+	}
+
+	if (best != target) {
+		retarget(thread, best);
+	}
+
+	return best;
+}
+
+void affinity_remove(ARC_Thread *thread) {
+	if (thread == NULL) {
+		return;
+	}
+
+	uint32_t old = __atomic_exchange_n(&thread->cpu.target, ARC_AFFINITY_NONE, __ATOMIC_ACQ_REL);
+
+	if (old != ARC_AFFINITY_NONE) {
+		__atomic_sub_fetch(&cpus.load[old], 1, __ATOMIC_RELAXED);
+	}
+}
+
+void affinity_ran(ARC_Thread *thread) {
+	if (thread != NULL) {
+		__atomic_store_n(&thread->cpu.last, percpu_slot(), __ATOMIC_RELAXED);
+	}
+}
+
+bool affinity_allowed(ARC_Thread *thread, uint32_t slot) {
+	return thread != NULL && slot < ARC_USERSPACE_CPU_SLOTS && (__atomic_load_n(&thread->cpu.mask, __ATOMIC_RELAXED) & (1ULL << slot));
+}
+
+// Called with the process lock held
+static ARC_Thread *find_thread(ARC_Process *process, uint64_t tid) {
+	if (tid == 0) {
+		ARC_Thread *self = smp_get_proc_desc()->thread;
+		return self != NULL && self->parent == process ? self : NULL;
+	}
+
+	for (ARC_ThreadElement *elem = process->threads; elem != NULL; elem = elem->next) {
+		if (elem->t->tid == tid) {
+			return elem->t;
+		}
+	}
+
+	return NULL;
+}
+
+int affinity_set(ARC_Process *process, uint64_t tid, uint64_t mask) {
+	if (process == NULL || (mask & percpu_online_mask()) == 0) {
+		return -1;
+	}
+
+	spinlock_lock(&process->lock);
+
+	ARC_Thread *thread = find_thread(process, tid);
+
+	if (thread == NULL) {
+		spinlock_unlock(&process->lock);
+		return -2;
+	}
+
+	__atomic_store_n(&thread->cpu.mask, mask, __ATOMIC_RELAXED);
+
+	uint32_t target = __atomic_load_n(&thread->cpu.target, __ATOMIC_ACQUIRE);
+
+	if (target != ARC_AFFINITY_NONE && (mask & (1ULL << target)) == 0) {
+		// Takes effect the next time the scheduler looks at the target
+		retarget(thread, least_loaded(mask));
+	}
+
+	spinlock_unlock(&process->lock);
+
+	return 0;
+}
+
+int affinity_get(ARC_Process *process, uint64_t tid, uint64_t *mask, uint32_t *last) {
+	if (process == NULL || mask == NULL || last == NULL) {
+		return -1;
+	}
+
+	spinlock_lock(&process->lock);
+
+	ARC_Thread *thread = find_thread(process, tid);
+
+	if (thread != NULL) {
+		*mask = __atomic_load_n(&thread->cpu.mask, __ATOMIC_RELAXED);
+		*last = __atomic_load_n(&thread->cpu.last, __ATOMIC_RELAXED);
+	}
+
+	spinlock_unlock(&process->lock);
+
+	return thread == NULL ? -2 : 0;
+}
+
+int affinity_set_default(ARC_Process *process, uint64_t mask) {
+	if (process == NULL || (mask & percpu_online_mask()) == 0) {
+		return -1;
+	}
+
+	__atomic_store_n(&process->affinity, mask, __ATOMIC_RELAXED);
+
+	return 0;
+}
+
+uint64_t affinity_slots_from_cpus(uint64_t mask) {
+	if (mask == ARC_AFFINITY_ALL) {
+		return ARC_AFFINITY_ALL;
+	}
+
+	uint64_t slots = 0;
+	uint64_t online = percpu_online_mask();
+
+	while (online != 0) {
+		uint32_t slot = __builtin_ctzll(online);
+		int64_t id = percpu_cpu_id(slot);
+		online &= online - 1;
+
+		if (id >= 0 && id < 64 && (mask & (1ULL << id))) {
+			slots |= 1ULL << slot;
+		}
+	}
+
+	return slots;
+}
+
+uint64_t affinity_cpus_from_slots(uint64_t mask) {
+	if (mask == ARC_AFFINITY_ALL) {
+		return ARC_AFFINITY_ALL;
+	}
+
+	uint64_t cpus = 0;
+
+	while (mask != 0) {
+		uint32_t slot = __builtin_ctzll(mask);
+		int64_t id = percpu_cpu_id(slot);
+		mask &= mask - 1;
+
+		if (id >= 0 && id < 64) {
+			cpus |= 1ULL << id;
+		}
+	}
+
+	return cpus;
+}
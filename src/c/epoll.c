@@ -0,0 +1,332 @@
+/**
+ * @file epoll.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#include "arch/smp.h"
+#include "global.h"
+#include "lib/util.h"
+#include "mm/allocator.h"
+#include "userspace/epoll.h"
+#include "userspace/process.h"
+#include "userspace/thread.h"
+#include "userspace/timer.h"
+#include "userspace/usercopy.h"
+
+struct epoll_sleeper {
+	struct epoll_sleeper *next;
+	ARC_Thread *thread;
+};
+
+static ARC_EPoll *get_epoll(ARC_Process *process) {
+	if (process->epoll != NULL) {
+		return process->epoll;
+	}
+
+	ARC_EPoll *epoll = (ARC_EPoll *)alloc(sizeof(*epoll));
+
+	if (epoll == NULL) {
+		ARC_DEBUG(ERR, "Failed to allocate epoll instance\n");
+		return NULL;
+	}
+
+	memset(epoll, 0, sizeof(*epoll));
+	init_static_spinlock(&epoll->lock);
+
+	ARC_EPoll *expected = NULL;
+	if (!__atomic_compare_exchange_n(&process->epoll, &expected, epoll, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		// Another thread got there first
+		free(epoll);
+		return expected;
+	}
+
+	return epoll;
+}
+
+// Called with the lock held
+static void epoll_queue(ARC_EPoll *epoll, struct ARC_EPollItem *item) {
+	if (item->queued) {
+		return;
+	}
+
+	item->queued = true;
+	item->next_ready = NULL;
+
+	if (epoll->ready_tail != NULL) {
+		epoll->ready_tail->next_ready = item;
+	} else {
+		epoll->ready_head = item;
+	}
+
+	epoll->ready_tail = item;
+}
+
+// Called with the lock held
+static void epoll_wake(ARC_EPoll *epoll) {
+	struct epoll_sleeper *sleeper = epoll->sleepers;
+	epoll->sleepers = NULL;
+
+	while (sleeper != NULL) {
+		struct epoll_sleeper *next = sleeper->next;
+		thread_unpark(sleeper->thread);
+		sleeper = next;
+	}
+}
+
+int epoll_ctl(ARC_Process *process, int op, int fd, ARC_EPollEvent *event) {
+	if (process == NULL || fd < 0 || fd >= ARC_EPOLL_ITEMS) {
+		return -1;
+	}
+
+	bool pipe = fd >= ARC_EPOLL_PIPE_BASE;
+
+	ARC_EPoll *epoll = get_epoll(process);
+
+	if (epoll == NULL) {
+		return -2;
+	}
+
+	struct ARC_EPollItem *item = &epoll->items[fd];
+
+	spinlock_lock(&epoll->lock);
+
+	switch (op) {
+	case ARC_EPOLL_CTL_ADD: {
+		if (item->registered || event == NULL || (!pipe && process->file_table[fd] == NULL)) {
+			goto fail;
+		}
+
+		item->interest = event->events | ARC_EPOLL_ERR | ARC_EPOLL_HUP;
+		item->data = event->data;
+		item->registered = true;
+
+		if (pipe) {
+			// The pipe reports its current state through epoll_notify
+			// once it is watched, which must be done without the lock
+			item->ready = 0;
+			spinlock_unlock(&epoll->lock);
+
+			if (ipc_watch(process, fd - ARC_EPOLL_PIPE_BASE) != 0) {
+				spinlock_lock(&epoll->lock);
+				item->registered = false;
+				goto fail;
+			}
+
+			return 0;
+		}
+
+		item->ready = ARC_EPOLL_IN | ARC_EPOLL_OUT;
+
+		break;
+	}
+
+	case ARC_EPOLL_CTL_MOD: {
+		if (!item->registered || event == NULL) {
+			goto fail;
+		}
+
+		item->interest = event->events | ARC_EPOLL_ERR | ARC_EPOLL_HUP;
+		item->data = event->data;
+
+		break;
+	}
+
+	case ARC_EPOLL_CTL_DEL: {
+		if (!item->registered) {
+			goto fail;
+		}
+
+		// Left on the ready list, it is skipped once it is popped
+		item->registered = false;
+		spinlock_unlock(&epoll->lock);
+
+		if (pipe) {
+			ipc_unwatch(process, fd - ARC_EPOLL_PIPE_BASE);
+		}
+
+		return 0;
+	}
+
+	default: {
+		goto fail;
+	}
+	}
+
+	if (item->ready & item->interest) {
+		epoll_queue(epoll, item);
+		epoll_wake(epoll);
+	}
+
+	spinlock_unlock(&epoll->lock);
+
+	return 0;
+
+	fail:;
+	spinlock_unlock(&epoll->lock);
+
+	return -1;
+}
+
+int epoll_notify(ARC_Process *process, int fd, uint32_t events) {
+	if (process == NULL || process->epoll == NULL || fd < 0 || fd >= ARC_EPOLL_ITEMS) {
+		return -1;
+	}
+
+	ARC_EPoll *epoll = process->epoll;
+	struct ARC_EPollItem *item = &epoll->items[fd];
+
+	spinlock_lock(&epoll->lock);
+
+	uint32_t rising = events & ~item->ready;
+	item->ready = events;
+
+	if (item->registered && (item->interest & events)) {
+		// Edge triggered items only care about new conditions
+		if (!(item->interest & ARC_EPOLL_ET) || (item->interest & rising)) {
+			epoll_queue(epoll, item);
+			epoll_wake(epoll);
+		}
+	}
+
+	spinlock_unlock(&epoll->lock);
+
+	return 0;
+}
+
+static void epoll_timeout(ARC_Timer *timer) {
+	thread_unpark((ARC_Thread *)timer->arg);
+}
+
+int epoll_wait(ARC_Process *process, ARC_EPollEvent *events, int max, long timeout_ms) {
+	if (process == NULL || max <= 0 || !user_access_ok(events, sizeof(*events) * max)) {
+		return -1;
+	}
+
+	// 0 for no deadline
+	uint64_t deadline = timeout_ms > 0 ? timer_now() + (uint64_t)timeout_ms * 1000000 : 0;
+
+	ARC_EPoll *epoll = get_epoll(process);
+
+	if (epoll == NULL) {
+		return -2;
+	}
+
+	if (max > ARC_EPOLL_MAX_EVENTS) {
+		max = ARC_EPOLL_MAX_EVENTS;
+	}
+
+	ARC_Thread *thread = smp_get_proc_desc()->thread;
+	ARC_EPollEvent out[ARC_EPOLL_MAX_EVENTS];
+	int count = 0;
+
+	spinlock_lock(&epoll->lock);
+
+	while (1) {
+		// Take at most the items that are on the list now, level
+		// triggered items are put back at the tail
+		struct ARC_EPollItem *last = epoll->ready_tail;
+
+		while (count < max && epoll->ready_head != NULL) {
+			struct ARC_EPollItem *item = epoll->ready_head;
+			epoll->ready_head = item->next_ready;
+
+			if (epoll->ready_head == NULL) {
+				epoll->ready_tail = NULL;
+			}
+
+			item->queued = false;
+			uint32_t hit = item->ready & item->interest;
+
+			if (item->registered && hit != 0) {
+				out[count].events = hit & ~(ARC_EPOLL_ET | ARC_EPOLL_ONESHOT);
+				out[count].data = item->data;
+				count++;
+
+				if (item->interest & ARC_EPOLL_ONESHOT) {
+					item->interest = 0;
+				} else if (!(item->interest & ARC_EPOLL_ET)) {
+					epoll_queue(epoll, item);
+				}
+			}
+
+			if (item == last) {
+				break;
+			}
+		}
+
+		if (count > 0 || timeout_ms == 0 || (deadline != 0 && deadline <= timer_now())) {
+			break;
+		}
+
+		struct epoll_sleeper sleeper = { .next = epoll->sleepers, .thread = thread };
+		epoll->sleepers = &sleeper;
+		thread_prepare_park(thread);
+
+		spinlock_unlock(&epoll->lock);
+
+		ARC_Timer timer = { .callback = epoll_timeout, .arg = thread };
+		if (deadline != 0) {
+			timer_arm(&timer, deadline);
+		}
+
+		int stopped = thread_park(thread);
+
+		if (deadline != 0) {
+			timer_cancel(&timer);
+		}
+
+		spinlock_lock(&epoll->lock);
+
+		// On timeout the sleeper is still listed
+		for (struct epoll_sleeper **s = &epoll->sleepers; *s != NULL; s = &(*s)->next) {
+			if (*s == &sleeper) {
+				*s = sleeper.next;
+				break;
+			}
+		}
+
+		if (stopped != 0) {
+			break;
+		}
+	}
+
+	spinlock_unlock(&epoll->lock);
+
+	if (count > 0 && copy_to_user(events, out, sizeof(*out) * count) != 0) {
+		return -1;
+	}
+
+	return count;
+}
+
+int uninit_epoll(ARC_Process *process) {
+	if (process == NULL || process->epoll == NULL) {
+		return -1;
+	}
+
+	free(process->epoll);
+	process->epoll = NULL;
+
+	return 0;
+}
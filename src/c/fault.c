@@ -0,0 +1,83 @@
+/**
+ * @file fault.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#include "arch/smp.h"
+#include "global.h"
+#include "userspace/fault.h"
+#include "userspace/ksm.h"
+#include "userspace/process.h"
+#include "userspace/thread.h"
+#include "userspace/usercopy.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+int userspace_page_fault(uintptr_t address, uint64_t error, uintptr_t *ip) {
+	if (ip == NULL) {
+		return -1;
+	}
+
+	ARC_Thread *thread = smp_get_proc_desc()->thread;
+	// A user copy under a spinlock, the caller faults the page in itself
+	bool atomic = thread != NULL && (error & ARC_FAULT_USER) == 0 && __atomic_load_n(&thread->nofault, __ATOMIC_RELAXED) != 0;
+
+	if (thread != NULL && address < ARC_USER_ADDRESS_LIMIT && !atomic) {
+		ARC_Process *process = thread->parent;
+		int swapped = process_swap_fault(process, (void *)address);
+
+		if (swapped == 0) {
+			return 0;
+		}
+
+		if (swapped == -3) {
+			// Handing back zeroes in place of the lost data would
+			// only hide the corruption
+			ARC_DEBUG(ERR, "Killing process %lu, its swapped out data is corrupt\n", process->pid);
+			process_delete(process);
+			thread_halt(thread);
+
+			return -2;
+		}
+
+		if ((error & (ARC_FAULT_PRESENT | ARC_FAULT_WRITE)) == (ARC_FAULT_PRESENT | ARC_FAULT_WRITE)
+		    && ksm_cow_fault(process, (void *)address) == 0) {
+			return 0;
+		}
+	}
+
+	// The kernel touched a bad user address inside one of the copy
+	// routines, let it report the fault instead of taking the kernel down
+	if ((error & ARC_FAULT_USER) == 0) {
+		uintptr_t resume = usercopy_fixup(*ip);
+
+		if (resume != 0) {
+			*ip = resume;
+			return 0;
+		}
+	}
+
+	return -1;
+}
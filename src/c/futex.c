@@ -0,0 +1,668 @@
+/**
+ * @file futex.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#include "arch/smp.h"
+#include "global.h"
+#include "lib/spinlock.h"
+#include "lib/util.h"
+#include "mm/allocator.h"
+#include "userspace/futex.h"
+#include "userspace/process.h"
+#include "userspace/thread.h"
+#include "userspace/timer.h"
+#include "userspace/usercopy.h"
+
+struct futex_waiter {
+	struct futex_waiter *next;
+	struct futex_waiter **pprev;
+	ARC_Process *process;
+	int *address;
+	ARC_Thread *thread;
+	ARC_Timer timer;
+};
+
+struct futex_bucket {
+	ARC_Spinlock lock;
+	struct futex_waiter *head;
+};
+
+// PI futex state lives in its own table, a single lock covers all of it since
+// boosting walks across the chain of owners
+#define FUTEX_PI_BUCKETS 64
+
+struct futex_pi_state;
+
+struct futex_pi_waiter {
+	struct futex_pi_waiter *next;
+	struct futex_pi_state *state;
+	ARC_Thread *thread;
+	int priority;
+	// Set by the unlocker once the lock is handed over
+	int acquired;
+	ARC_Timer timer;
+};
+
+struct futex_pi_state {
+	struct futex_pi_state *next;
+	// In the owner's list of held states
+	struct futex_pi_state *held_next;
+	ARC_Process *process;
+	int *address;
+	ARC_Thread *owner;
+	// Most urgent first
+	struct futex_pi_waiter *waiters;
+};
+
+static struct futex_bucket buckets[ARC_FUTEX_BUCKETS] = { 0 };
+static struct futex_pi_state *pi_states[FUTEX_PI_BUCKETS] = { 0 };
+static ARC_Spinlock pi_lock = { 0 };
+
+int init_futexes(void) {
+	for (int i = 0; i < ARC_FUTEX_BUCKETS; i++) {
+		init_static_spinlock(&buckets[i].lock);
+	}
+
+	init_static_spinlock(&pi_lock);
+
+	return 0;
+}
+
+static uint64_t futex_key(ARC_Process *process, int *address) {
+	uint64_t key = ((uintptr_t)address >> 2) ^ (uintptr_t)process;
+	key ^= key >> 17;
+	key *= 0x9E3779B97F4A7C15ULL;
+
+	return key >> 32;
+}
+
+static struct futex_bucket *get_bucket(ARC_Process *process, int *address) {
+	return &buckets[futex_key(process, address) % ARC_FUTEX_BUCKETS];
+}
+
+static void bucket_remove(struct futex_waiter *waiter) {
+	*waiter->pprev = waiter->next;
+
+	if (waiter->next != NULL) {
+		waiter->next->pprev = waiter->pprev;
+	}
+
+	waiter->next = NULL;
+	waiter->pprev = NULL;
+}
+
+static void futex_timeout(ARC_Timer *timer) {
+	// The waiter takes itself off the bucket once it runs, taking the
+	// bucket lock in interrupt context could deadlock
+	thread_unpark(((struct futex_waiter *)timer->arg)->thread);
+}
+
+int futex_wait(int *address, int expected, uint64_t deadline) {
+	ARC_Thread *thread = smp_get_proc_desc()->thread;
+	struct futex_waiter waiter = {
+	        .process = thread->parent,
+	        .address = address,
+	        .thread = thread,
+	        .timer = { .callback = futex_timeout, .arg = &waiter },
+	};
+	struct futex_bucket *bucket = get_bucket(waiter.process, address);
+
+	int value = 0;
+
+	retry:;
+	spinlock_lock(&bucket->lock);
+
+	int err = copy_from_user_atomic(&value, address, sizeof(value));
+
+	if (err == -2) {
+		// Faulted, bring the word in without the bucket locked
+		spinlock_unlock(&bucket->lock);
+
+		if (copy_from_user(&value, address, sizeof(value)) != 0) {
+			return -1;
+		}
+
+		goto retry;
+	}
+
+	if (err != 0 || value != expected) {
+		spinlock_unlock(&bucket->lock);
+		return -1;
+	}
+
+	waiter.next = bucket->head;
+	waiter.pprev = &bucket->head;
+	if (bucket->head != NULL) {
+		bucket->head->pprev = &waiter.next;
+	}
+	bucket->head = &waiter;
+
+	thread_prepare_park(thread);
+	spinlock_unlock(&bucket->lock);
+
+	if (deadline != 0) {
+		timer_arm(&waiter.timer, deadline);
+	}
+
+	thread_park(thread);
+
+	if (deadline != 0) {
+		timer_cancel(&waiter.timer);
+	}
+
+	int ret = 0;
+
+	spinlock_lock(&bucket->lock);
+	if (waiter.pprev != NULL) {
+		// Still queued, so nobody woke us
+		bucket_remove(&waiter);
+		ret = -2;
+	}
+	spinlock_unlock(&bucket->lock);
+
+	return ret;
+}
+
+int futex_wake(int *address, int count) {
+	ARC_Process *process = smp_get_proc_desc()->thread->parent;
+	struct futex_bucket *bucket = get_bucket(process, address);
+	int woken = 0;
+
+	spinlock_lock(&bucket->lock);
+
+	struct futex_waiter *waiter = bucket->head;
+	while (waiter != NULL && woken < count) {
+		struct futex_waiter *next = waiter->next;
+
+		if (waiter->process == process && waiter->address == address) {
+			bucket_remove(waiter);
+			thread_unpark(waiter->thread);
+			woken++;
+		}
+
+		waiter = next;
+	}
+
+	spinlock_unlock(&bucket->lock);
+
+	return woken;
+}
+
+static int pi_tid(ARC_Thread *thread) {
+	return (int)(thread->tid & ARC_FUTEX_TID_MASK);
+}
+
+static struct futex_pi_state **pi_slot(ARC_Process *process, int *address) {
+	return &pi_states[futex_key(process, address) % FUTEX_PI_BUCKETS];
+}
+
+static struct futex_pi_state *pi_find(ARC_Process *process, int *address) {
+	for (struct futex_pi_state *state = *pi_slot(process, address); state != NULL; state = state->next) {
+		if (state->process == process && state->address == address) {
+			return state;
+		}
+	}
+
+	return NULL;
+}
+
+static void pi_held_remove(struct futex_pi_state *state) {
+	struct futex_pi_state **link = &state->owner->pi.held;
+
+	while (*link != NULL && *link != state) {
+		link = &(*link)->held_next;
+	}
+
+	if (*link != NULL) {
+		*link = state->held_next;
+	}
+
+	state->held_next = NULL;
+}
+
+static void pi_held_add(struct futex_pi_state *state, ARC_Thread *owner) {
+	state->owner = owner;
+	state->held_next = owner->pi.held;
+	owner->pi.held = state;
+}
+
+static void pi_free(struct futex_pi_state *state) {
+	struct futex_pi_state **link = pi_slot(state->process, state->address);
+
+	while (*link != state) {
+		link = &(*link)->next;
+	}
+
+	*link = state->next;
+	pi_held_remove(state);
+	free(state);
+}
+
+static void pi_enqueue(struct futex_pi_waiter *waiter) {
+	struct futex_pi_waiter **link = &waiter->state->waiters;
+
+	// Behind those of equal priority, so they are served in order
+	while (*link != NULL && (*link)->priority >= waiter->priority) {
+		link = &(*link)->next;
+	}
+
+	waiter->next = *link;
+	*link = waiter;
+}
+
+static void pi_dequeue(struct futex_pi_waiter *waiter) {
+	struct futex_pi_waiter **link = &waiter->state->waiters;
+
+	while (*link != NULL && *link != waiter) {
+		link = &(*link)->next;
+	}
+
+	if (*link != NULL) {
+		*link = waiter->next;
+	}
+
+	waiter->next = NULL;
+}
+
+// Recomputes the boost of owner from the waiters on what it holds, and
+// carries any change along while owners are themselves blocked
+static void pi_propagate(ARC_Thread *owner) {
+	for (int depth = 0; owner != NULL && depth < ARC_FUTEX_PI_DEPTH; depth++) {
+		int boost = -1;
+
+		for (struct futex_pi_state *state = owner->pi.held; state != NULL; state = state->held_next) {
+			if (state->waiters != NULL && state->waiters->priority > boost) {
+				boost = state->waiters->priority;
+			}
+		}
+
+		if (boost == owner->pi.boost) {
+			return;
+		}
+
+		__atomic_store_n(&owner->pi.boost, boost, __ATOMIC_RELAXED);
+
+		struct futex_pi_waiter *waiter = owner->pi.waiter;
+
+		if (waiter == NULL) {
+			return;
+		}
+
+		// Requeue at the new priority, the next owner may inherit it
+		pi_dequeue(waiter);
+		waiter->priority = thread_priority(owner);
+		pi_enqueue(waiter);
+
+		owner = waiter->state->owner;
+	}
+}
+
+// The owner must be a live thread of the caller's process
+static ARC_Thread *pi_lookup_owner(ARC_Process *process, int tid) {
+	ARC_Thread *owner = NULL;
+
+	spinlock_lock(&process->lock);
+	for (ARC_ThreadElement *elem = process->threads; elem != NULL; elem = elem->next) {
+		if (pi_tid(elem->t) == tid && !elem->t->pi.gone) {
+			owner = elem->t;
+			break;
+		}
+	}
+	spinlock_unlock(&process->lock);
+
+	return owner;
+}
+
+// Replaces the word while tid still owns it, only the flag bits may change
+// under the kernel. Called with pi_lock held, so -2 if the word has to be
+// faulted in first
+static int pi_set_word(int *address, int tid, int desired) {
+	int expected = tid | ARC_FUTEX_WAITERS;
+
+	while (1) {
+		int ret = cmpxchg_user_atomic(address, &expected, desired);
+
+		if (ret != 1) {
+			return ret == 0 ? 0 : (ret == -2 ? -2 : -1);
+		}
+
+		if ((expected & ARC_FUTEX_TID_MASK) != tid) {
+			return -1;
+		}
+	}
+}
+
+// Gives state to its most urgent waiter. flags are or'd into the new word, the
+// word is left alone unless write is set. Nothing changes if -2 is returned,
+// see pi_set_word
+static int pi_handover(struct futex_pi_state *state, bool write, int flags) {
+	struct futex_pi_waiter *waiter = state->waiters;
+	ARC_Thread *owner = state->owner;
+	ARC_Thread *next = waiter->thread;
+	int ret = 0;
+
+	int desired = pi_tid(next) | flags | (waiter->next != NULL ? ARC_FUTEX_WAITERS : 0);
+
+	if (write && (ret = pi_set_word(state->address, pi_tid(owner), desired)) == -2) {
+		return -2;
+	}
+
+	state->waiters = waiter->next;
+	waiter->next = NULL;
+
+	pi_held_remove(state);
+
+	if (state->waiters != NULL) {
+		pi_held_add(state, next);
+	} else {
+		pi_free(state);
+	}
+
+	next->pi.waiter = NULL;
+	__atomic_store_n(&waiter->acquired, 1, __ATOMIC_RELAXED);
+
+	pi_propagate(next);
+	thread_unpark(next);
+
+	return ret;
+}
+
+static void futex_pi_timeout(ARC_Timer *timer) {
+	// As with futex_timeout, the waiter cleans up after itself
+	thread_unpark(((struct futex_pi_waiter *)timer->arg)->thread);
+}
+
+int futex_lock_pi(int *address, uint64_t deadline) {
+	ARC_Thread *self = smp_get_proc_desc()->thread;
+	ARC_Process *process = self->parent;
+	int tid = pi_tid(self);
+
+	retry:;
+
+	int expected = 0;
+
+	// Uncontended, userspace would normally not have come here for this
+	int ret = cmpxchg_user(address, &expected, tid);
+
+	if (ret != 1) {
+		return ret == 0 ? 0 : -1;
+	}
+
+	spinlock_lock(&pi_lock);
+
+	struct futex_pi_state *state = pi_find(process, address);
+
+	// Either take the lock, or mark the word so its owner's unlock enters
+	// the kernel
+	while (1) {
+		int owner_tid = expected & ARC_FUTEX_TID_MASK;
+		int desired = 0;
+
+		if (owner_tid == 0) {
+			desired = tid | (state != NULL ? ARC_FUTEX_WAITERS : 0);
+		} else if (owner_tid == tid) {
+			spinlock_unlock(&pi_lock);
+			return -3;
+		} else if (expected & ARC_FUTEX_WAITERS) {
+			break;
+		} else {
+			desired = expected | ARC_FUTEX_WAITERS;
+		}
+
+		if ((ret = cmpxchg_user_atomic(address, &expected, desired)) < 0) {
+			spinlock_unlock(&pi_lock);
+
+			// Swapped out or shared since, which cannot be dealt
+			// with under the lock
+			if (ret == -2 && fault_in_user(address) == 0) {
+				goto retry;
+			}
+
+			return -1;
+		}
+
+		if (ret == 1) {
+			continue;
+		}
+
+		if (owner_tid == 0) {
+			// Freed in the meantime, queued waiters now wait on us
+			if (state != NULL) {
+				pi_held_remove(state);
+				pi_held_add(state, self);
+				pi_propagate(self);
+			}
+
+			spinlock_unlock(&pi_lock);
+			return 0;
+		}
+
+		expected = desired;
+		break;
+	}
+
+	if (state == NULL) {
+		ARC_Thread *owner = pi_lookup_owner(process, expected & ARC_FUTEX_TID_MASK);
+
+		if (owner == NULL || (state = (struct futex_pi_state *)alloc(sizeof(*state))) == NULL) {
+			spinlock_unlock(&pi_lock);
+			ARC_DEBUG(ERR, "Failed to lock PI futex %p, no owner %d or out of memory\n", address,
+				  expected & ARC_FUTEX_TID_MASK);
+			return -1;
+		}
+
+		memset(state, 0, sizeof(*state));
+		state->process = process;
+		state->address = address;
+
+		struct futex_pi_state **slot = pi_slot(process, address);
+		state->next = *slot;
+		*slot = state;
+
+		pi_held_add(state, owner);
+	}
+
+	// Waiting on a chain that leads back to us would never end
+	ARC_Thread *owner = state->owner;
+	for (int depth = 0; owner != NULL && depth < ARC_FUTEX_PI_DEPTH; depth++) {
+		if (owner == self) {
+			if (state->waiters == NULL) {
+				pi_free(state);
+			}
+
+			spinlock_unlock(&pi_lock);
+			return -3;
+		}
+
+		owner = owner->pi.waiter != NULL ? owner->pi.waiter->state->owner : NULL;
+	}
+
+	struct futex_pi_waiter waiter = {
+	        .state = state,
+	        .thread = self,
+	        .priority = thread_priority(self),
+	        .timer = { .callback = futex_pi_timeout, .arg = &waiter },
+	};
+
+	pi_enqueue(&waiter);
+	self->pi.waiter = &waiter;
+	pi_propagate(state->owner);
+
+	if (deadline != 0) {
+		timer_arm(&waiter.timer, deadline);
+	}
+
+	ret = 0;
+
+	while (1) {
+		thread_prepare_park(self);
+		spinlock_unlock(&pi_lock);
+
+		int stopped = thread_park(self);
+
+		spinlock_lock(&pi_lock);
+
+		if (waiter.acquired) {
+			break;
+		}
+
+		if (stopped != 0 || (deadline != 0 && timer_now() >= deadline)) {
+			// The state stays while others wait, the owner may
+			// have less to inherit now
+			owner = state->owner;
+			pi_dequeue(&waiter);
+			self->pi.waiter = NULL;
+
+			if (state->waiters == NULL) {
+				pi_free(state);
+			}
+
+			pi_propagate(owner);
+			ret = stopped != 0 ? -1 : -2;
+			break;
+		}
+	}
+
+	spinlock_unlock(&pi_lock);
+
+	if (deadline != 0) {
+		timer_cancel(&waiter.timer);
+	}
+
+	return ret;
+}
+
+int futex_trylock_pi(int *address) {
+	int expected = 0;
+	int ret = cmpxchg_user(address, &expected, pi_tid(smp_get_proc_desc()->thread));
+
+	if (ret < 0) {
+		return -1;
+	}
+
+	return ret == 0 ? 0 : -2;
+}
+
+int futex_unlock_pi(int *address) {
+	ARC_Thread *self = smp_get_proc_desc()->thread;
+	ARC_Process *process = self->parent;
+	int tid = pi_tid(self);
+	int expected = tid;
+
+	int ret = cmpxchg_user(address, &expected, 0);
+
+	if (ret != 1) {
+		return ret == 0 ? 0 : -1;
+	}
+
+	if ((expected & ARC_FUTEX_TID_MASK) != tid) {
+		return -1;
+	}
+
+	while (1) {
+		spinlock_lock(&pi_lock);
+
+		struct futex_pi_state *state = pi_find(process, address);
+
+		if (state != NULL && state->owner == self) {
+			ret = pi_handover(state, true, 0);
+		} else {
+			// The waiters timed out, leaving the bit behind
+			ret = pi_set_word(address, tid, 0);
+		}
+
+		if (ret != -2) {
+			break;
+		}
+
+		spinlock_unlock(&pi_lock);
+
+		if (fault_in_user(address) != 0) {
+			return -1;
+		}
+	}
+
+	pi_propagate(self);
+	spinlock_unlock(&pi_lock);
+
+	return ret;
+}
+
+int futex_pi_exit(ARC_Thread *thread) {
+	if (thread == NULL) {
+		return -1;
+	}
+
+	ARC_Thread *current = smp_get_proc_desc()->thread;
+	// Only the words of the running process are reachable, threads deleted
+	// from elsewhere belong to a process that is going away
+	bool write = current != NULL && current->parent == thread->parent;
+
+	spinlock_lock(&pi_lock);
+
+	thread->pi.gone = 1;
+
+	while (thread->pi.held != NULL) {
+		int *address = thread->pi.held->address;
+
+		if (pi_handover(thread->pi.held, write, ARC_FUTEX_OWNER_DIED) != -2) {
+			continue;
+		}
+
+		spinlock_unlock(&pi_lock);
+		int faulted = fault_in_user(address);
+		spinlock_lock(&pi_lock);
+
+		if (faulted != 0 && thread->pi.held != NULL && thread->pi.held->address == address) {
+			// The word is gone, the waiter gets the lock regardless
+			pi_handover(thread->pi.held, false, ARC_FUTEX_OWNER_DIED);
+		}
+	}
+
+	struct futex_pi_waiter *waiter = thread->pi.waiter;
+
+	if (waiter != NULL) {
+		// Deleted while blocked, its waiter is on the stack going away
+		ARC_Thread *owner = waiter->state->owner;
+		pi_dequeue(waiter);
+		thread->pi.waiter = NULL;
+
+		if (waiter->state->waiters == NULL) {
+			pi_free(waiter->state);
+		}
+
+		pi_propagate(owner);
+	}
+
+	thread->pi.boost = -1;
+	spinlock_unlock(&pi_lock);
+
+	if (waiter != NULL) {
+		// Would otherwise fire into the stack once it is freed
+		timer_cancel(&waiter->timer);
+	}
+
+	return 0;
+}
@@ -0,0 +1,69 @@
+/**
+ * @file affinity.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#ifndef ARC_USERSPACE_AFFINITY_H
+#define ARC_USERSPACE_AFFINITY_H
+
+#include "userspace/process.h"
+#include "userspace/thread.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Masks are over percpu_slot() numbers, userspace names processors by their
+// APIC ids instead, see affinity_slots_from_cpus
+#define ARC_AFFINITY_ALL UINT64_MAX
+#define ARC_AFFINITY_NONE UINT32_MAX
+// How much busier than the least loaded allowed processor the one a thread
+// last ran on may be and still be picked when it wakes up
+#define ARC_AFFINITY_WARM_SLACK 2
+
+// NOTE: The scheduler runs a thread on thread->cpu.target, thread_switched
+//       calls affinity_ran each time it switches to one
+
+// Counts a new thread on the least loaded processor its mask allows
+uint32_t affinity_place(ARC_Thread *thread);
+// Picks where a waking thread runs, the processor it last ran on if that is
+// still allowed and not much busier than the rest
+uint32_t affinity_wake(ARC_Thread *thread);
+// Stops counting the thread, for when it exits
+void affinity_remove(ARC_Thread *thread);
+void affinity_ran(ARC_Thread *thread);
+bool affinity_allowed(ARC_Thread *thread, uint32_t slot);
+// A tid of 0 means the calling thread. Masks without an online processor
+// are refused
+int affinity_set(ARC_Process *process, uint64_t tid, uint64_t mask);
+int affinity_get(ARC_Process *process, uint64_t tid, uint64_t *mask, uint32_t *last);
+// Mask threads created from now on start with
+int affinity_set_default(ARC_Process *process, uint64_t mask);
+
+// Between masks of APIC ids and of slots, bit n of the former standing for
+// the processor with id n. Ids of 64 and up cannot be named, processors not
+// yet online are left out unless the mask is ARC_AFFINITY_ALL
+uint64_t affinity_slots_from_cpus(uint64_t mask);
+uint64_t affinity_cpus_from_slots(uint64_t mask);
+
+#endif
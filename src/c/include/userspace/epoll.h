@@ -0,0 +1,98 @@
+/**
+ * @file epoll.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#ifndef ARC_USERSPACE_EPOLL_H
+#define ARC_USERSPACE_EPOLL_H
+
+#include "config.h"
+#include "lib/spinlock.h"
+#include "userspace/ipc.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define ARC_EPOLL_IN      0x001
+#define ARC_EPOLL_OUT     0x004
+#define ARC_EPOLL_ERR     0x008
+#define ARC_EPOLL_HUP     0x010
+#define ARC_EPOLL_ONESHOT (1U << 30)
+#define ARC_EPOLL_ET      (1U << 31)
+
+#define ARC_EPOLL_CTL_ADD 1
+#define ARC_EPOLL_CTL_DEL 2
+#define ARC_EPOLL_CTL_MOD 3
+
+// Most events returned by a single wait
+#define ARC_EPOLL_MAX_EVENTS 64
+
+// Pipe handles are registered as ARC_EPOLL_PIPE_BASE + handle, below it are
+// file descriptors
+#define ARC_EPOLL_PIPE_BASE ARC_PROCESS_FILE_LIMIT
+#define ARC_EPOLL_ITEMS (ARC_EPOLL_PIPE_BASE + ARC_IPC_HANDLE_LIMIT)
+
+struct ARC_Process;
+
+typedef struct ARC_EPollEvent {
+	uint32_t events;
+	uint64_t data;
+} __attribute__((packed)) ARC_EPollEvent;
+
+struct ARC_EPollItem {
+	struct ARC_EPollItem *next_ready;
+	uint64_t data;
+	uint32_t interest;
+	uint32_t ready;
+	bool registered;
+	bool queued;
+};
+
+typedef struct ARC_EPoll {
+	ARC_Spinlock lock;
+	// Indexed by file descriptor, then pipe handle
+	struct ARC_EPollItem items[ARC_EPOLL_ITEMS];
+	struct ARC_EPollItem *ready_head;
+	struct ARC_EPollItem *ready_tail;
+	struct epoll_sleeper *sleepers;
+} ARC_EPoll;
+
+// Pipes report their readiness through epoll_notify. NOTE: The VFS has no
+// readiness callbacks, so file descriptors are always ready for reading and
+// writing, as regular files are
+int epoll_ctl(struct ARC_Process *process, int op, int fd, ARC_EPollEvent *event);
+
+// Wait until at least one registered descriptor is ready or timeout_ms
+// milliseconds pass, -1 waits forever and 0 does not wait at all. Ready events
+// are written to the userspace array events, returns how many or -1
+int epoll_wait(struct ARC_Process *process, ARC_EPollEvent *events, int max, long timeout_ms);
+
+// Called by whatever backs fd when its readiness changes, events is the full
+// set of conditions that currently hold. Callers may hold their own locks, as
+// long as epoll_ctl is never called with them held
+int epoll_notify(struct ARC_Process *process, int fd, uint32_t events);
+
+int uninit_epoll(struct ARC_Process *process);
+
+#endif
@@ -0,0 +1,44 @@
+/**
+ * @file fault.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#ifndef ARC_USERSPACE_FAULT_H
+#define ARC_USERSPACE_FAULT_H
+
+#include <stdint.h>
+
+// Bits of the error code the processor pushes for a page fault
+#define ARC_FAULT_PRESENT 1
+#define ARC_FAULT_WRITE   2
+#define ARC_FAULT_USER    4
+
+// To be called by the page fault handler before it gives up on a fault.
+// Returns 0 if the fault was resolved, *ip is updated if execution is to
+// resume elsewhere, -1 if it is not one userspace knows how to handle and -2
+// if the faulting process was killed, the current thread is halted then and
+// the handler is to yield instead of resuming it
+int userspace_page_fault(uintptr_t address, uint64_t error, uintptr_t *ip);
+
+#endif
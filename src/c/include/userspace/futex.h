@@ -0,0 +1,71 @@
+/**
+ * @file futex.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#ifndef ARC_USERSPACE_FUTEX_H
+#define ARC_USERSPACE_FUTEX_H
+
+#include <stdint.h>
+
+#define ARC_FUTEX_BUCKETS 256
+
+// PI futex words hold the owner's TID, 0 when unlocked. The kernel sets
+// WAITERS once a thread blocks, so that the owner's unlock is not done in
+// userspace. OWNER_DIED is set when the lock is handed over by an exiting
+// owner, the state it protects may be inconsistent
+#define ARC_FUTEX_WAITERS INT32_MIN
+#define ARC_FUTEX_OWNER_DIED 0x40000000
+#define ARC_FUTEX_TID_MASK 0x3FFFFFFF
+// Owners blocked on further PI futexes pass on the boost this many times
+#define ARC_FUTEX_PI_DEPTH 8
+
+// Sets up the bucket locks, called by init_userspace
+int init_futexes(void);
+
+// Block while *address == expected, until woken or the monotonic time
+// deadline passes (0 waits forever). Returns 0 when woken, -1 if the value
+// did not match or the address is bad, -2 on timeout
+int futex_wait(int *address, int expected, uint64_t deadline);
+
+// Returns the number of threads woken
+int futex_wake(int *address, int count);
+
+struct ARC_Thread;
+
+// Acquire the PI futex at address, blocking until the owner hands it over or
+// the deadline passes (0 waits forever). While blocked, the owner runs at no
+// less than the caller's priority. Returns 0 once acquired, -1 if the address
+// or the owner in the word is bad, -2 on timeout and -3 if acquiring it would
+// deadlock
+int futex_lock_pi(int *address, uint64_t deadline);
+// Returns 0 if acquired, -1 if the address is bad, -2 if it is held
+int futex_trylock_pi(int *address);
+// Hands the lock to the most urgent waiter and drops any priority inherited
+// through it. Returns 0, or -1 if the address is bad or not owned by the caller
+int futex_unlock_pi(int *address);
+// Called as the thread exits or is deleted, hands its PI futexes on
+int futex_pi_exit(struct ARC_Thread *thread);
+
+#endif
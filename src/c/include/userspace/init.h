@@ -0,0 +1,44 @@
+/**
+ * @file init.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#ifndef ARC_USERSPACE_INIT_H
+#define ARC_USERSPACE_INIT_H
+
+// To be called once by the kernel on the bootstrap processor, after the
+// scheduler and the VFS are up and before the first user process is created.
+// Other processors call percpu_register as they come up.
+//
+// Past that the kernel drives userspace through:
+//   timer_tick            periodic timer interrupt, timer.h
+//   thread_runnable       scheduler, before picking a thread, thread.h
+//   thread_switched       scheduler, after each switch, thread.h
+//   reaper_run            scheduler, after thread_switched, reaper.h
+//   reaper_idle           scheduler, before halting an idle processor
+//   userspace_page_fault  page fault handler, fault.h
+//   ksm_run               periodically, outside of interrupts, ksm.h
+int init_userspace(void);
+
+#endif
@@ -0,0 +1,118 @@
+/**
+ * @file ipc.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#ifndef ARC_USERSPACE_IPC_H
+#define ARC_USERSPACE_IPC_H
+
+#include "lib/spinlock.h"
+#include "userspace/process.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Pipe ends held by a single process
+#define ARC_IPC_HANDLE_LIMIT 64
+#define ARC_IPC_NAME_LIMIT 64
+
+// Bytes queued in a pipe before writers block
+#define ARC_PIPE_CAPACITY 0x100000
+// Writes from a buffer mapping of at least this many bytes pass the pages
+// rather than copying them
+#define ARC_PIPE_SHARE_MIN PAGE_SIZE
+// Most pages allocated at once to hold copied data
+#define ARC_PIPE_CHUNK_PAGES 16
+
+#define ARC_PIPE_READ  0
+#define ARC_PIPE_WRITE 1
+
+// Give the pages of the written buffer mapping to the pipe, the mapping is
+// removed from the writer. Without it the pages are shared, the writer must
+// not modify them until they are read
+#define ARC_PIPE_GIFT     (1 << 0)
+#define ARC_PIPE_NONBLOCK (1 << 1)
+
+// Reference counted pages backing shared memory objects, buffer mappings and
+// data queued in pipes
+typedef struct ARC_IPCBuffer {
+	uint32_t refs;
+	size_t count;
+	void *pages[];
+} ARC_IPCBuffer;
+
+typedef struct ARC_IPCTable {
+	ARC_Spinlock lock;
+	struct {
+		struct ARC_Pipe *pipe;
+		int end;
+	} handles[ARC_IPC_HANDLE_LIMIT];
+} ARC_IPCTable;
+
+// Sets up the lock of the name table, called by init_userspace
+int init_ipc(void);
+
+// Creates a pipe and stores its read and write handles. If name is not NULL
+// other processes can open it by that name until it is unlinked
+int pipe_create(ARC_Process *process, const char *name, int handles[2]);
+// Returns a handle for the given end of the named pipe, or negative
+int pipe_open(ARC_Process *process, const char *name, int end);
+int ipc_close(ARC_Process *process, int handle);
+
+// Has the pipe end behind handle report its readiness to the process's epoll
+// instance, as item ARC_EPOLL_PIPE_BASE + handle, starting with its current
+// state. Closing the handle stops it as well
+int ipc_watch(ARC_Process *process, int handle);
+int ipc_unwatch(ARC_Process *process, int handle);
+
+// Both return the number of bytes moved, 0 from a read meaning every writer
+// is gone. -1 is returned for bad arguments, -2 if the pipe would block and
+// ARC_PIPE_NONBLOCK is set, -3 on a write with no readers left
+long pipe_write(ARC_Process *process, int handle, const void *buffer, size_t size, int flags);
+long pipe_read(ARC_Process *process, int handle, void *buffer, size_t size, int flags);
+// Maps the next queued buffer into process instead of copying it, it is
+// writable if nobody else holds its pages. Returns the number of bytes in it
+// with *address set, or -4 if the next data is not a whole buffer, in which
+// case pipe_read is to be used
+long pipe_read_map(ARC_Process *process, int handle, void **address, int flags);
+
+// Maps a new zeroed buffer of size bytes, whose pages can be passed to pipes
+void *ipc_buffer_map(ARC_Process *process, size_t size);
+// Maps the named shared memory object, creating it with size bytes if it does
+// not exist and create is set
+void *shm_map(ARC_Process *process, const char *name, size_t size, bool create);
+// Removes the name of a pipe or shared memory object, it stays alive for as
+// long as it is open or mapped
+int ipc_unlink(const char *name);
+
+// Unmaps a region backed by an ARC_IPCBuffer, the region must already be off
+// the process's list. process is NULL for a region not mapped anywhere
+int ipc_release_region(ARC_Process *process, ARC_ProcessRegion *region);
+// Another reference to the pages of a buffer mapping, returns buffer
+ARC_IPCBuffer *ipc_buffer_ref(ARC_IPCBuffer *buffer);
+
+int uninit_ipc(ARC_Process *process);
+
+#endif
@@ -0,0 +1,95 @@
+/**
+ * @file ksm.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#ifndef ARC_USERSPACE_KSM_H
+#define ARC_USERSPACE_KSM_H
+
+#include "userspace/process.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ARC_KSM_BUCKETS 1024
+// Most pages looked at per ksm_run, and how often it does anything
+#define ARC_KSM_PAGES_PER_RUN 256
+#define ARC_KSM_INTERVAL_NS 20000000
+
+typedef struct ARC_KSMPage {
+	struct ARC_KSMPage *next;
+	void *page;
+	uint64_t hash;
+	// Number of mappings, the page is read-only everywhere once shared
+	uint32_t refs;
+	uint32_t stable;
+	// Merges waiting on this page to be compared
+	uint32_t pending;
+	// Where a not yet shared candidate came from
+	ARC_Process *owner;
+	ARC_ProcessRegion *region;
+	size_t index;
+} ARC_KSMPage;
+
+typedef struct ARC_KSMStats {
+	uint64_t pages_scanned;
+	// Mappings currently backed by another mapping's page
+	uint64_t pages_sharing;
+	uint64_t pages_unshared;
+	uint64_t full_scans;
+} ARC_KSMStats;
+
+// Sets up the lock of the merge state, called by init_userspace
+int init_ksm(void);
+
+// Opt the region containing address in to merging, its backing memory is split
+// into individual pages
+int ksm_enable_region(ARC_Process *process, void *address);
+
+// Unmaps and drops every page of a region that was opted in, the region must
+// already be off the process's list. process is NULL for a region that is not
+// mapped anywhere
+int ksm_release_region(ARC_Process *process, ARC_ProcessRegion *region);
+
+// Opts the region containing address in and shares every one of its pages
+// right away, mapping them read-only, so that a later write copies the page
+int ksm_share_region(ARC_Process *process, void *address);
+// Takes a reference to every page of a shared region, filling in the pages of
+// copy, which may then be mapped elsewhere
+int ksm_ref_region(ARC_ProcessRegion *copy, ARC_ProcessRegion *region);
+
+// Called by the page fault handler for a write to a read-only page, returns 0
+// if the fault was for a merged page, or one write protected for the scanner,
+// and is now resolved
+int ksm_cow_fault(ARC_Process *process, void *address);
+
+// To be called periodically, scans at most ARC_KSM_PAGES_PER_RUN pages every
+// ARC_KSM_INTERVAL_NS. A page that looks like another is write protected and
+// only compared and merged by a later run, once every processor has gone
+// through a quiescent point and no stale writable TLB entry is left
+size_t ksm_run(void);
+
+void ksm_get_stats(ARC_KSMStats *stats);
+
+#endif
@@ -27,7 +27,9 @@
 #ifndef ARC_USERSPACE_LOADER_H
 #define ARC_USERSPACE_LOADER_H
 
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include "drivers/resource.h"
 
 #define ARC_REGISTER_LOADER(group, name)         \
@@ -35,6 +37,9 @@
 
 #define ARC_SHARE_LOADER_INDICES(...) ;
 
+// Enough for an ELF header and, usually, the program headers after it
+#define ARC_LOADER_PROBE_SIZE 1024
+
 enum ARC_LOADER_GROUP {
         ARC_LDRGRP_64BIT = 0,
         ARC_LDRGRP_32BIT,
@@ -42,12 +47,42 @@ enum ARC_LOADER_GROUP {
 
 ARC_SHARE_LOADER_INDICES(ARC_LDRGRP_64BIT, ARC_LDRGRP_32BIT)
 
+// Initial image of each thread's static TLS block, the bytes past file_size
+// up to mem_size are zero
+typedef struct ARC_ProgramTLS {
+        void *image;
+        size_t file_size;
+        size_t mem_size;
+        size_t align;
+} ARC_ProgramTLS;
+
 typedef struct ARC_ProgramMeta {
         void *entry;
         size_t size;
         void *loader_data;
         const struct ARC_ProgramLoaderDef *loader;
         void *page_table;
+        // Bytes from the start of the file read by init_program_loader_probe,
+        // a loader's init may take ownership of them by setting header to NULL
+        void *header;
+        size_t header_size;
+        // Set before loading, whether the image is mapped for userspace
+        bool userspace;
+        // Set by the loader if the program cannot use addresses at or above
+        // it, 0 if it can use all of them
+        uintptr_t address_limit;
+        // NULL if the program has no TLS
+        ARC_ProgramTLS *tls;
+        // For the auxiliary vector conv_prepare_entry_stack builds, entry is
+        // where the program itself starts even if an interpreter runs first
+        // (meta->entry), base is the interpreter's, 0 without one
+        struct {
+                uintptr_t phdr;
+                size_t phent;
+                size_t phnum;
+                uintptr_t entry;
+                uintptr_t base;
+        } aux;
 } ARC_ProgramMeta;
         
 typedef struct ARC_ProgramLoaderDef {
@@ -55,11 +90,23 @@ typedef struct ARC_ProgramLoaderDef {
         int (*unload)(ARC_ProgramMeta *, void *virt, size_t);
         int (*uninit)(ARC_ProgramMeta *);
         int (*init)  (ARC_ProgramMeta *, ARC_File *);
+        // Returns 0 if the loader can take a file starting with the given
+        // bytes, at most ARC_LOADER_PROBE_SIZE of them
+        int (*probe) (void *header, size_t size);
+        // Sets up copy, already a copy of the meta itself, as an image of
+        // its own with the same contents. NULL if the loader cannot do this
+        int (*clone) (ARC_ProgramMeta *, ARC_ProgramMeta *copy);
 } ARC_ProgramLoaderDef;
 
 int program_loader_load(ARC_ProgramMeta *, void *, size_t);
 int program_loader_unload(ARC_ProgramMeta *, void *, size_t);
 int uninit_program_loader(ARC_ProgramMeta *);
 ARC_ProgramMeta *init_program_loader(int group, int index, ARC_File *, void *page_table);
+// Reads the start of the file once and initializes the first registered
+// loader, of any group, whose probe accepts it
+ARC_ProgramMeta *init_program_loader_probe(ARC_File *, void *page_table);
+// A copy of the loaded image mapped into page_table, or into nothing if it is
+// NULL, for process templates
+ARC_ProgramMeta *program_loader_clone(ARC_ProgramMeta *, void *page_table);
 
 #endif
@@ -27,6 +27,9 @@
 #ifndef ARC_USERSPACE_ELF_H
 #define ARC_USERSPACE_ELF_H
 
+#include "userspace/loader.h"
+
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -52,6 +55,8 @@
 #define ELF_CLASS_32       1
 #define ELF_CLASS_64       2
 
+#define EM_X86_64          62
+
 #define ELF_EI_DATA        5
 #define ELF_EI_VERSION     6
 
@@ -64,6 +69,11 @@
 #define ELF_EI_PAD         9
 #define ELF_EI_NIDENT      16
 
+#define ET_NONE         0
+#define ET_REL          1
+#define ET_EXEC         2
+#define ET_DYN          3
+
 #define PT_NULL 	0 
 #define PT_LOAD 	1 
 #define PT_DYNAMIC 	2
@@ -83,13 +93,71 @@
 #define PF_MASKOS 	0x00FF0000
 #define PF_MASKPROC 	0xFF000000
 
+#define DT_NULL         0
+#define DT_PLTRELSZ     2
+#define DT_SYMTAB       6
+#define DT_RELA         7
+#define DT_RELASZ       8
+#define DT_RELAENT      9
+#define DT_SYMENT       11
+#define DT_REL          17
+#define DT_RELSZ        18
+#define DT_RELENT       19
+#define DT_PLTREL       20
+#define DT_JMPREL       23
+
+#define R_X86_64_NONE      0
+#define R_X86_64_64        1
+#define R_X86_64_GLOB_DAT  6
+#define R_X86_64_JUMP_SLOT 7
+#define R_X86_64_RELATIVE  8
+#define R_X86_64_32        10
+
+#define ELF64_R_SYM(i)  ((i) >> 32)
+#define ELF64_R_TYPE(i) ((i) & 0xFFFFFFFF)
+#define ELF64_ST_BIND(i) ((i) >> 4)
+
+#define ELF32_R_SYM(i)  ((i) >> 8)
+#define ELF32_R_TYPE(i) ((i) & 0xFF)
+#define ELF32_ST_BIND(i) ((i) >> 4)
+
+#define SHN_UNDEF       0
+#define STB_WEAK        2
+
+// Where position independent images go when the loader picks
+#define ARC_ELF_DYN_BASE 0x40000000
+#define ARC_ELF_INTERP_BASE 0x20000000000
+// For images limited to 32-bit addresses
+#define ARC_ELF_INTERP_BASE_32 0xC0000000
+// Cache base for plain file contents, as mapped by vm_map
+#define ARC_ELF_CACHE_FILE UINTPTR_MAX
+// Allocator arena of processes limited to 32-bit addresses, segments of such
+// images must stay clear of it
+#define ARC_ELF_LOW_ARENA 0x80000000
+#define ARC_ELF_LOW_ARENA_SIZE 0x1000000
+
+// Auxiliary vector entries
+#define AT_NULL  0
+#define AT_PHDR  3
+#define AT_PHENT 4
+#define AT_PHNUM 5
+#define AT_PAGESZ 6
+#define AT_BASE  7
+#define AT_ENTRY 9
+
+typedef uint32_t Elf32_Addr;
+typedef uint32_t Elf32_Off;
+typedef uint16_t Elf32_Half;
+typedef uint32_t Elf32_Word;
+typedef int32_t Elf32_Sword;
+
 typedef uint64_t Elf64_Addr;
 typedef uint64_t Elf64_Off;
 typedef uint16_t Elf64_Half;
 typedef uint32_t Elf64_Word;
-typedef uint32_t Elf64_Sword;
+typedef int32_t Elf64_Sword;
 typedef uint64_t Elf64_Xword;
-typedef uint64_t Elf64_Sxword;
+typedef int64_t Elf64_Sxword;
 
 struct Elf64_Ehdr {
 	unsigned char e_ident[16]; /* ELF identification */
@@ -152,6 +220,81 @@ struct Elf64_Phdr {
 	Elf64_Xword p_align; /* Alignment of segment */
 }__attribute__((packed));
 
+struct Elf64_Dyn {
+	Elf64_Sxword d_tag;
+	union {
+		Elf64_Xword d_val;
+		Elf64_Addr d_ptr;
+	} d_un;
+}__attribute__((packed));
+
+struct Elf32_Ehdr {
+	unsigned char e_ident[16];
+	Elf32_Half e_type;
+	Elf32_Half e_machine;
+	Elf32_Word e_version;
+	Elf32_Addr e_entry;
+	Elf32_Off e_phoff;
+	Elf32_Off e_shoff;
+	Elf32_Word e_flags;
+	Elf32_Half e_ehsize;
+	Elf32_Half e_phentsize;
+	Elf32_Half e_phnum;
+	Elf32_Half e_shentsize;
+	Elf32_Half e_shnum;
+	Elf32_Half e_shstrndx;
+}__attribute__((packed));
+
+struct Elf32_Phdr {
+	Elf32_Word p_type;
+	Elf32_Off p_offset;
+	Elf32_Addr p_vaddr;
+	Elf32_Addr p_paddr;
+	Elf32_Word p_filesz;
+	Elf32_Word p_memsz;
+	Elf32_Word p_flags;
+	Elf32_Word p_align;
+}__attribute__((packed));
+
+struct Elf32_Sym {
+	Elf32_Word st_name;
+	Elf32_Addr st_value;
+	Elf32_Word st_size;
+	unsigned char st_info;
+	unsigned char st_other;
+	Elf32_Half st_shndx;
+}__attribute__((packed));
+
+struct Elf32_Rel {
+	Elf32_Addr r_offset;
+	Elf32_Word r_info;
+}__attribute__((packed));
+
+struct Elf32_Rela {
+	Elf32_Addr r_offset;
+	Elf32_Word r_info;
+	Elf32_Sword r_addend;
+}__attribute__((packed));
+
+struct Elf32_Dyn {
+	Elf32_Sword d_tag;
+	union {
+		Elf32_Word d_val;
+		Elf32_Addr d_ptr;
+	} d_un;
+}__attribute__((packed));
+
+// A PT_LOAD segment once in memory, page aligned
+struct ARC_ELFSegment {
+        uintptr_t virt;
+        void *phys; // HHDM address
+        size_t size;
+        uint64_t offset; // In the file
+        uint32_t flags;
+        // Came from the cache, so it is already relocated and read-only
+        bool shared;
+};
+
 struct ARC_ELFMeta {
         struct Elf64_Ehdr *header;
         struct {
@@ -159,6 +302,52 @@ struct ARC_ELFMeta {
                 uint32_t count;
                 uint32_t size;
         } phdrs;
+        // Template from PT_TLS, image is NULL if there is none
+        ARC_ProgramTLS tls;
+        // Added to every address in the file, 0 unless ET_DYN
+        uintptr_t base;
+        void *node;
+        ARC_File *file;
+        struct ARC_ELFSegment *segments;
+        uint32_t segment_count;
+        // Off for the interpreter and for programs that have one, as the
+        // interpreter does it
+        bool relocate;
+        // From PT_INTERP, loaded into the same address space
+        ARC_ProgramMeta *interp;
+        // Applies the relocations PT_DYNAMIC lists, as each class lays
+        // them out differently
+        int (*relocate_image)(struct ARC_ELFMeta *elf_meta, struct Elf64_Phdr *dynamic);
 };
 
+// Shared by the loaders of both classes, which fill in header (widened to
+// the 64-bit layout) and phdrs before calling elf_init_image
+int elf_init_image(ARC_ProgramMeta *meta, struct ARC_ELFMeta *elf_meta, ARC_File *file);
+int elf_load(ARC_ProgramMeta *meta, void *virt, size_t size);
+int elf_unload(ARC_ProgramMeta *meta, void *virt, size_t size);
+int elf_uninit(ARC_ProgramMeta *meta);
+// Fills in copy with its own segments, sharing those from the cache and
+// copying the rest, mapped into copy->page_table unless it is NULL
+int elf_clone(ARC_ProgramMeta *meta, ARC_ProgramMeta *copy);
+// HHDM address of size bytes at the relocated address virt, NULL if that is
+// not all within one loaded segment
+void *elf_segment_target(struct ARC_ELFMeta *elf_meta, uintptr_t virt, size_t size, bool *shared);
+
+// Sets up the lock of the page cache, called by init_userspace
+int init_elf_cache(void);
+// Pages of read-only segments, already relocated for base, kept so later
+// loads of the same file at the same base can map them instead. All return
+// HHDM addresses and hold a reference for the caller
+void *elf_cache_get(void *node, uintptr_t base, uint64_t offset, size_t size);
+// Returns -1 if the pages could not be added, the caller keeps them then
+int elf_cache_put(void *node, uintptr_t base, uint64_t offset, size_t size, void *phys);
+// Returns -1 if phys is not from the cache, in which case the caller frees it
+int elf_cache_release(void *phys);
+// Another reference to pages the caller already holds one to, returns -1 if
+// phys is not from the cache
+int elf_cache_ref(void *phys);
+// To be called whenever node is written to, its pages are no longer handed out
+// and go away once the last mapping of them does
+void elf_cache_invalidate(void *node);
+
 #endif
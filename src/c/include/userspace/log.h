@@ -0,0 +1,58 @@
+/**
+ * @file log.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#ifndef ARC_USERSPACE_LOG_H
+#define ARC_USERSPACE_LOG_H
+
+#include "userspace/process.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ARC_LOG_RECORD_SIZE 128
+#define ARC_LOG_RING_RECORDS 256
+#define ARC_LOG_HISTORY_SIZE 0x10000
+
+// Queue text for the terminal without blocking, returns -1 if some of it was
+// dropped because the ring was full
+int log_write(const char *data, size_t size);
+
+// Move everything queued so far to the terminal and the history, returns the
+// number of records moved. There must only be one caller at a time
+size_t log_drain(void);
+
+// Copy history from *cursor onwards, *cursor is advanced past what was
+// copied. Returns the number of bytes copied, or -1 if buffer or cursor is
+// not a userspace address
+long log_read_user(uint64_t *cursor, void *buffer, size_t count);
+
+uint64_t log_get_dropped(void);
+
+// Creates the kernel process that drains the rings, done by init_userspace.
+// The consumer parks while the rings are empty and log_write wakes it
+ARC_Process *init_log_consumer(void);
+
+#endif
@@ -0,0 +1,49 @@
+/**
+ * @file percpu.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#ifndef ARC_USERSPACE_PERCPU_H
+#define ARC_USERSPACE_PERCPU_H
+
+#include <stdint.h>
+
+#define ARC_USERSPACE_CPU_SLOTS 64
+
+// Dense number of the calling processor, handed out the first time the
+// processor asks (percpu_register does it up front). Structures indexed by
+// this must still tolerate two processors sharing a slot on machines with
+// more than ARC_USERSPACE_CPU_SLOTS
+uint32_t percpu_slot(void);
+
+// To be called by each processor as it comes up, returns its slot
+uint32_t percpu_register(void);
+
+// APIC id of the processor that holds slot, -1 if none does
+int64_t percpu_cpu_id(uint32_t slot);
+
+// Bit n is set once a processor holds slot n
+uint64_t percpu_online_mask(void);
+
+#endif
@@ -30,8 +30,10 @@
 #include "arch/x86-64/config.h"
 #include "arctan.h"
 #include "config.h"
+#include "lib/spinlock.h"
 #include "mm/vmm.h"
 #include "userspace/thread.h"
+#include "userspace/zswap.h"
 #include "util.h"
 
 #include <stdbool.h>
@@ -42,17 +44,84 @@ typedef struct ARC_ThreadElement {
 	ARC_Thread *t;
 } ARC_ThreadElement;
 
+typedef struct ARC_ProcessRegion {
+	struct ARC_ProcessRegion *next;
+	void *virt;
+	void *phys; // HHDM address of the backing memory
+	size_t size;
+	uint32_t flags;
+	bool file;
+	// Read-only pages owned by the ELF page cache, shared with other processes
+	bool cached;
+	// One slot per page while swapped out, phys is NULL then
+	ARC_SwapSlot *swap;
+	// Set while process_swap_out compresses it, it is unmapped then
+	bool swapping;
+	// Backing for each page once opted in to merging, phys is NULL then
+	void **pages;
+	struct ARC_KSMPage **shared;
+	// Set for pages shared through IPC, see ipc.h, phys is only the first
+	struct ARC_IPCBuffer *ipc;
+	// Set for a writable MAP_SHARED mapping, the first length bytes are
+	// written back to the file at offset when it goes away
+	struct ARC_File *backing;
+	long offset;
+	size_t length;
+} ARC_ProcessRegion;
+
+enum {
+	ARC_PROCESS_MEM_RSS = 0,
+	ARC_PROCESS_MEM_PAGE_TABLES,
+	ARC_PROCESS_MEM_KSTACKS,
+	ARC_PROCESS_MEM_FILES,
+	ARC_PROCESS_MEM_TYPES,
+};
+
+// All in bytes, a limit of 0 means there is none
+typedef struct ARC_ProcessMemory {
+	// Mapped files are also counted as resident
+	uint64_t counters[ARC_PROCESS_MEM_TYPES];
+	// What the limits are checked against, everything but mapped files
+	uint64_t total;
+	uint64_t soft_limit;
+	uint64_t hard_limit;
+} ARC_ProcessMemory;
+
 typedef struct ARC_Process {
 	ARC_VMMMeta *allocator;
+	struct ARC_ProgramMeta *program;
+	ARC_ProcessRegion *regions;
+	ARC_Spinlock lock;
 	ARC_ThreadElement *threads;
 	struct {
 		void *user;
 		void *kernel;
 	} page_tables;
 	struct ARC_File *file_table[ARC_PROCESS_FILE_LIMIT];
+	// How each file was opened, path is NULL if not through open
+	struct {
+		char *path;
+		int flags;
+		unsigned int mode;
+	} file_origin[ARC_PROCESS_FILE_LIMIT];
+	struct ARC_EPoll *epoll;
+	struct ARC_IPCTable *ipc;
 	uint64_t pid;
 	int priority;
 	bool userspace;
+	// Once set, the scheduler must no longer pick threads of this process
+	uint32_t dead;
+	struct {
+		struct ARC_Process *next;
+		uint64_t epoch;
+		uint32_t stage;
+	} reap;
+	ARC_SwapStats swap;
+	// Regions process_swap_out is working on without the lock held
+	uint32_t swapping;
+	ARC_ProcessMemory memory;
+	// Affinity mask new threads start with
+	uint64_t affinity;
 } ARC_Process;
 STATIC_ASSERT(sizeof(ARC_Process) >= PAGE_SIZE, "Kernel heap may leak into userspace, increase ARC_PROCESS_FILE_LIMIT");
 
@@ -62,7 +131,41 @@ int process_associate_thread(ARC_Process *process, ARC_Thread *thread);
 int process_disassociate_thread(ARC_Process *process, ARC_Thread *thread);
 int process_fork(ARC_Process *process);
 int process_delete(ARC_Process *process);
+// Frees what is left of a deleted process, returns 1 once it is gone, 0 if the
+// budget (in pages) ran out first
+int process_reclaim(ARC_Process *process, size_t *budget);
+int process_add_region(ARC_Process *process, void *virt, void *phys, size_t size, uint32_t flags, bool file, bool cached);
+// Tracks a writable MAP_SHARED mapping, backing is a file of its own that is
+// closed once the contents have been written back
+int process_add_file_region(ARC_Process *process, void *virt, void *phys, size_t size, uint32_t flags, struct ARC_File *backing, long offset, size_t length);
+// Writes the contents of a region added by process_add_file_region back to
+// its file, does nothing for any other region
+void process_write_back_region(ARC_ProcessRegion *region);
+// Tracks a mapping of every page of buffer at virt, see ipc.h
+int process_add_ipc_region(ARC_Process *process, void *virt, struct ARC_IPCBuffer *buffer, uint32_t flags);
+ARC_ProcessRegion *process_remove_region(ARC_Process *process, void *virt);
+// Takes references to whatever backs region, shared (see ksm_share_region),
+// cached or IPC memory only, and maps it at the same address in process
+// unless that is NULL. Pages shared through ksm are copied on write
+ARC_ProcessRegion *process_share_region(ARC_Process *process, ARC_ProcessRegion *region);
+// Unmaps region from process, if not NULL, and drops its memory. It must
+// already be off the process's list
+void process_release_region(ARC_Process *process, ARC_ProcessRegion *region);
+// Returns -1 if the charge would take the process over its hard limit, in
+// which case nothing is charged
+int process_charge(ARC_Process *process, int type, size_t size);
+void process_uncharge(ARC_Process *process, int type, size_t size);
+// Charges for a mapping of size bytes, including the page tables it needs
+int process_charge_mapping(ARC_Process *process, size_t size, bool file);
+void process_uncharge_mapping(ARC_Process *process, size_t size, bool file);
+int process_set_limits(ARC_Process *process, uint64_t soft, uint64_t hard);
 int process_swap_out(ARC_Process *process);
+// Returns -3 if some of the compressed data was corrupt, those regions stay
+// swapped out
 int process_swap_in(ARC_Process *process);
+// Brings back the swapped out region containing address. Returns 0 if it did,
+// 1 if the region was not swapped out, -2 if there is no region and -3 if its
+// data was corrupt, after which the process is not to run again
+int process_swap_fault(ARC_Process *process, void *address);
 
 #endif
@@ -0,0 +1,64 @@
+/**
+ * @file reaper.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#ifndef ARC_USERSPACE_REAPER_H
+#define ARC_USERSPACE_REAPER_H
+
+#include "userspace/process.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Most pages a single call to reaper_run gives back
+#define ARC_REAPER_BATCH 64
+
+// Sets up the shards, called by init_userspace
+int init_reaper(void);
+
+// Objects retired at the returned epoch may be freed once reaper_grace_passed
+// says so, by then every registered processor has gone through a quiescent
+// point
+uint64_t reaper_retire(void);
+bool reaper_grace_passed(uint64_t epoch);
+
+// Hands a dead process to the current processor's reaper
+int reaper_defer_process(ARC_Process *process);
+
+// Hands an exited thread to the current processor's reaper
+int reaper_defer_thread(ARC_Thread *thread);
+
+// To be called by the scheduler on each processor whenever it switches
+// threads. Marks a quiescent point and reclaims up to budget pages of dead
+// processes and exited threads, returns the number of pages reclaimed
+size_t reaper_run(size_t budget);
+
+// To be called by the scheduler when the processor has nothing to run, before
+// it halts. The processor counts as quiescent until its next reaper_run, so
+// an idle processor does not hold up the grace period
+void reaper_idle(void);
+
+#endif
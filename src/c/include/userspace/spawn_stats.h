@@ -0,0 +1,78 @@
+/**
+ * @file spawn_stats.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#ifndef ARC_USERSPACE_SPAWN_STATS_H
+#define ARC_USERSPACE_SPAWN_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Steps of creating and tearing down processes and threads, timed in TSC
+// cycles as they happen. The benchmarks in host/ are the reference, these
+// show where the time goes on real hardware
+enum {
+	ARC_SPAWN_PROCESS_CREATE = 0,
+	ARC_SPAWN_LOADER_INIT,
+	ARC_SPAWN_LOADER_LOAD,
+	ARC_SPAWN_THREAD_CREATE,
+	ARC_SPAWN_ENTRY_STACK,
+	// All of process_create_from_file, including the steps above
+	ARC_SPAWN_FROM_FILE,
+	// Per call, a process usually takes several to reclaim
+	ARC_SPAWN_PROCESS_RECLAIM,
+	ARC_SPAWN_THREAD_RECLAIM,
+	// All of process_create_from_template
+	ARC_SPAWN_FROM_TEMPLATE,
+	ARC_SPAWN_STEPS,
+};
+
+typedef struct ARC_SpawnStat {
+	uint64_t count;
+	uint64_t cycles;
+	uint64_t min;
+	uint64_t max;
+} ARC_SpawnStat;
+
+typedef struct ARC_SpawnStats {
+	ARC_SpawnStat steps[ARC_SPAWN_STEPS];
+} ARC_SpawnStats;
+
+static inline uint64_t spawn_stats_start(void) {
+	return __builtin_ia32_rdtsc();
+}
+
+// One step, from the name of the step on
+#define ARC_SPAWN_STATS_LINE "spawn %s %lu %lu %lu %lu\n"
+
+void spawn_stats_record(int step, uint64_t start);
+void spawn_stats_get(ARC_SpawnStats *out);
+void spawn_stats_reset(void);
+// NULL if there is no such step
+const char *spawn_stats_name(int step);
+// One ARC_SPAWN_STATS_LINE per step
+void spawn_stats_dump(void);
+
+#endif
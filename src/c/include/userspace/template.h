@@ -0,0 +1,101 @@
+/**
+ * @file template.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#ifndef ARC_USERSPACE_TEMPLATE_H
+#define ARC_USERSPACE_TEMPLATE_H
+
+#include "arch/context.h"
+#include "userspace/process.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ARC_TEMPLATE_LIMIT 16
+// Instances allocate from this much address space, right above everything
+// they inherit
+#define ARC_TEMPLATE_ARENA_SIZE (0x1000 * 4096)
+
+// An immutable image of a process. Its memory is shared copy-on-write with
+// the process it was captured from and with every instance
+typedef struct ARC_ProcessTemplate {
+	// One for the table, one for each instance being created
+	uint32_t refs;
+	// PID of the capturing process, the only one that may use the template
+	uint64_t owner;
+	bool userspace;
+	int priority;
+	uint64_t affinity;
+	uint64_t soft_limit;
+	uint64_t hard_limit;
+	// Neither is mapped anywhere, instances map copies
+	struct ARC_ProgramMeta *program;
+	ARC_ProcessRegion *regions;
+	// Base of the allocator of each instance
+	uintptr_t arena;
+	// The main thread of an instance returns from the capturing thread's
+	// template_capture call, on a copy of its user stack at the same address
+	struct {
+		ARC_ProcessorFeatures features;
+		ARC_Context *context;
+		void *stack_virt;
+		// HHDM address of the copy, TLS area included
+		void *stack;
+		size_t stack_size;
+		void *tcb;
+		int priority;
+		uint64_t mask;
+	} thread;
+	// Files are opened again by each instance, at the same offset
+	struct {
+		char *path;
+		int flags;
+		unsigned int mode;
+		long offset;
+	} files[ARC_PROCESS_FILE_LIMIT];
+} ARC_ProcessTemplate;
+
+// Sets up the lock of the template table, called by init_userspace
+int init_templates(void);
+
+// Captures process, which must be the caller's and have no other thread. The
+// main thread of each instance carries on from this call, with the same result
+// but with the memory the call writes to as it was before. Returns the ID of
+// the template, or negative
+int template_capture(ARC_Process *process);
+// Drops the template, which process must have captured. Instances already
+// created are not affected
+int template_destroy(ARC_Process *process, int id);
+// Drops every template process captured, once it is gone
+void template_release_owner(ARC_Process *process);
+
+// Creates a process in the state of the template, which caller must have
+// captured, in time proportional to its page tables rather than its memory.
+// As with process_create_from_file, the main thread is left ready for the
+// scheduler
+ARC_Process *process_create_from_template(ARC_Process *caller, int id);
+
+#endif
@@ -31,15 +31,23 @@
 #include "lib/spinlock.h"
 #include "mp/profiling.h"
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 
+// Space reserved for the TCB above each thread's TLS block
+#define ARC_THREAD_TCB_SIZE 0x100
+
+struct ARC_ProgramMeta;
+
 typedef struct ARC_Thread {
 	struct ARC_Process *parent;
 	struct {
 		void *phys;
 		void *virt;
 		size_t size;
+		// Set if virt was not handed out by the process's allocator
+		bool fixed;
 	} ustack;
         struct {
                 void *hhdm;
@@ -52,9 +60,115 @@ typedef struct ARC_Thread {
 	uint32_t state;
 	int priority; // If -1, use process's priority, otherwise, use this one
 	ARC_Context *context;
+	// Last thread pointer given to the context
+	void *tcb;
+	// Nonzero while user copies must not resolve faults, see
+	// cmpxchg_user_atomic
+	uint32_t nofault;
+	struct {
+		// Processors (by percpu_slot) the thread may run on
+		uint64_t mask;
+		// Where it ran last and where it is to run next, see affinity.h
+		uint32_t last;
+		uint32_t target;
+		// Set from when a processor switches to the thread until one
+		// switches away from it, see thread_switched
+		uint32_t running;
+		// Set the first time it is switched to
+		uint32_t started;
+	} cpu;
+	struct {
+		// Set from thread_prepare_park until thread_unpark
+		uint32_t parked;
+		// Set while the thread is inside thread_park
+		uint32_t blocked;
+	} wait;
+	struct {
+		// Inherited from waiters on PI futexes this thread owns, -1
+		// if none, see futex.h
+		int boost;
+		// Set while the thread waits to acquire a PI futex
+		struct futex_pi_waiter *waiter;
+		// PI futexes owned by the thread which have waiters
+		struct futex_pi_state *held;
+		// Set once the thread may no longer become an owner
+		uint32_t gone;
+	} pi;
+	struct {
+		// Set when the process dies, the thread is woken from any
+		// wait and halts the next time it leaves userspace
+		uint32_t stopped;
+		// Once set, the thread is never to run again
+		uint32_t halted;
+		// Once set, the scheduler must no longer pick this thread
+		uint32_t exited;
+		int code;
+		struct ARC_Thread *joiner;
+		// One for the running thread, one for whoever joins it
+		uint32_t refs;
+		struct ARC_Thread *next;
+		uint64_t epoch;
+	} exit;
 } ARC_Thread;
 
+// Sets up the caches of freed thread resources, called by init_userspace
+int init_thread_caches(void);
+
 ARC_Thread *thread_create(struct ARC_Process *process, void *entry, size_t stack_size);
+// Creates a thread that resumes where context was saved, on a user stack of
+// size bytes (TLS area included) mapped at virt and holding a copy of stack.
+// virt must be free in the process and outside of its allocator
+ARC_Thread *thread_create_from(struct ARC_Process *process, ARC_Context *context, void *virt, const void *stack, size_t size, void *tcb);
 int thread_delete(ARC_Thread *thread);
 
+// Ends the given (current) thread, its stacks are reclaimed by the reaper
+int thread_exit(ARC_Thread *thread, int code);
+// Waits for the thread with the given ID in process to exit
+int thread_join(struct ARC_Process *process, uint64_t tid, int *code);
+// Called by the reaper once no processor can be on the thread's kernel stack
+int thread_reclaim(ARC_Thread *thread);
+// Drops the reference held for joining, without waiting
+int thread_release(ARC_Thread *thread);
+
+// Bytes of stack the thread was created with, without its TLS area
+size_t thread_stack_size(ARC_Thread *thread);
+// The x32 counterpart of conv_prepare_entry_stack, argc, the argv and envp
+// pointers and the auxiliary vector are all 32-bit words
+int thread_prepare_entry_stack_32(ARC_Thread *thread, struct ARC_ProgramMeta *meta, char **envp, int envc, char **argv, int argc);
+// HHDM address of the thread's static TLS block, whose size is stored in size,
+// NULL if the program has none
+void *thread_tls_block(ARC_Thread *thread, size_t *size);
+
+// Effective priority, the thread's own (or its process's) raised by any
+// priority inherited through PI futexes. Larger values are more urgent, the
+// scheduler is to pick by this rather than the priority field
+int thread_priority(ARC_Thread *thread);
+
+// A thread about to block calls thread_prepare_park before making itself
+// visible to whoever wakes it, and then thread_park, so a wake up in between
+// is not lost. thread_park returns -1 without blocking once the thread has
+// been stopped, waits that loop around it are to give up then
+int thread_prepare_park(ARC_Thread *thread);
+int thread_park(ARC_Thread *thread);
+int thread_unpark(ARC_Thread *thread);
+
+// The scheduler must not pick threads this returns false for, it is how a
+// thread in thread_park blocks until it is unparked and how exited threads
+// are kept off the processors
+bool thread_runnable(ARC_Thread *thread);
+
+// To be called by the scheduler on each switch, once prev's context has been
+// saved. prev or next is NULL if the processor was or is going to be idle,
+// user is set if prev was interrupted while running userspace code
+void thread_switched(ARC_Thread *prev, ARC_Thread *next, bool user);
+
+// Used by process_delete. Wakes the thread so that it backs out of whatever it
+// waits on, it is halted once it is next switched away from in userspace
+int thread_stop(ARC_Thread *thread);
+// Called by a thread on itself from a point where it holds nothing, after
+// which it is never picked again
+int thread_halt(ARC_Thread *thread);
+// True once the thread can no longer run, so it may be freed
+bool thread_gone(ARC_Thread *thread);
+
 #endif
@@ -0,0 +1,85 @@
+/**
+ * @file timer.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#ifndef ARC_USERSPACE_TIMER_H
+#define ARC_USERSPACE_TIMER_H
+
+#include <stdint.h>
+
+#define ARC_TIMER_TICK_NS 1000000
+#define ARC_TIMER_LEVELS 4
+#define ARC_TIMER_SLOT_BITS 6
+#define ARC_TIMER_SLOTS (1 << ARC_TIMER_SLOT_BITS)
+
+typedef struct ARC_TimeSpec {
+	int64_t sec;
+	int64_t nsec;
+} ARC_TimeSpec;
+
+typedef struct ARC_Timer {
+	struct ARC_Timer *next;
+	// Pointer that points at this timer
+	struct ARC_Timer **pprev;
+	// Absolute tick at which the callback runs
+	uint64_t expires;
+	void (*callback)(struct ARC_Timer *);
+	void *arg;
+	// Wheel the timer is queued on, NULL when not armed
+	struct timer_wheel *wheel;
+	// Set while the callback runs
+	uint32_t firing;
+} ARC_Timer;
+
+// Sets up the wheel of every processor, called by init_userspace before any
+// timer is armed or timer_tick runs
+int init_timers(void);
+
+// Arm the timer to fire at the monotonic time deadline (in nanoseconds) on the
+// wheel of the current processor
+int timer_arm(ARC_Timer *timer, uint64_t deadline);
+
+// Returns 0 if the timer was disarmed before it fired, -1 otherwise. Once this
+// returns the callback is not running, so the timer may be reused or freed
+int timer_cancel(ARC_Timer *timer);
+
+// To be called by the kernel from the periodic timer interrupt of each
+// processor, at least every ARC_TIMER_TICK_NS, with the current monotonic time
+// in nanoseconds. This is the only clock userspace has, timer_now stays put
+// and nothing armed fires unless it is called. Fires every timer on that
+// processor's wheel that is due
+void timer_tick(uint64_t now);
+
+// Last monotonic time seen by timer_tick, in nanoseconds
+uint64_t timer_now(void);
+
+// Park the current thread until the monotonic time deadline
+int timer_sleep_until(uint64_t deadline);
+
+static inline uint64_t timespec_to_ns(const ARC_TimeSpec *ts) {
+	return (uint64_t)ts->sec * 1000000000 + (uint64_t)ts->nsec;
+}
+
+#endif
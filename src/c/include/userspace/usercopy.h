@@ -0,0 +1,67 @@
+/**
+ * @file usercopy.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#ifndef ARC_USERSPACE_USERCOPY_H
+#define ARC_USERSPACE_USERCOPY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// First non-canonical address, everything below it belongs to userspace
+#define ARC_USER_ADDRESS_LIMIT 0x0000800000000000
+
+bool user_access_ok(const void *ptr, size_t size);
+
+// All of these return 0 on success, -1 if the range is not in userspace and
+// -2 if a fault occurred part way through
+int copy_from_user(void *dst, const void *src, size_t size);
+int copy_to_user(void *dst, const void *src, size_t size);
+// copy_from_user for callers holding a spinlock, see cmpxchg_user_atomic. A
+// plain copy_from_user after dropping the locks brings the memory in
+int copy_from_user_atomic(void *dst, const void *src, size_t size);
+
+// Returns the length of the string, the destination is always terminated.
+// -3 is returned if the string does not fit into max bytes
+long strncpy_from_user(char *dst, const char *src, size_t max);
+
+// Atomically replaces *ptr with desired if it holds *expected. Returns 0 if it
+// did, 1 if not (*expected is updated with the current value), -1 if ptr is
+// not in userspace or misaligned and -2 on fault
+int cmpxchg_user(int *ptr, int *expected, int desired);
+// The same, for callers holding a spinlock. A fault is not resolved, as
+// doing so may sleep or take the locks of the process, and -2 is returned
+// instead. The caller drops its locks, calls fault_in_user and tries again
+int cmpxchg_user_atomic(int *ptr, int *expected, int desired);
+// Brings the word at ptr in and makes it writable, for instance swapping it
+// back in or breaking a shared page. Returns 0, or -1 if ptr is no good
+int fault_in_user(int *ptr);
+
+// Called through userspace_page_fault, returns the address to resume at if
+// ip is within a user copy, otherwise 0
+uintptr_t usercopy_fixup(uintptr_t ip);
+
+#endif
@@ -0,0 +1,83 @@
+/**
+ * @file zswap.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#ifndef ARC_USERSPACE_ZSWAP_H
+#define ARC_USERSPACE_ZSWAP_H
+
+#include "arch/x86-64/config.h"
+#include "arctan.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Granularity of the compressed pool
+#define ARC_ZPOOL_CLASS_SHIFT 6
+#define ARC_ZPOOL_CLASS_SIZE (1 << ARC_ZPOOL_CLASS_SHIFT)
+
+typedef struct ARC_SwapSlot {
+	void *data;
+	// 0 for a page of zeroes, PAGE_SIZE for a page stored as is
+	uint32_t size;
+} ARC_SwapSlot;
+
+typedef struct ARC_SwapStats {
+	uint64_t pages_out;
+	uint64_t pages_in;
+	uint64_t zero_pages;
+	// Bytes of memory the swapped out pages took up and now take up
+	uint64_t original_bytes;
+	uint64_t stored_bytes;
+} ARC_SwapStats;
+
+// Returns the size of the compressed data, or 0 if it did not fit in max
+size_t lz_compress(const uint8_t *src, size_t size, uint8_t *dst, size_t max, uint16_t *table);
+// Returns the size of the decompressed data, or 0 if the input is corrupt
+size_t lz_decompress(const uint8_t *src, size_t size, uint8_t *dst, size_t max);
+
+// Size of the table lz_compress needs, in entries
+#define ARC_LZ_TABLE_SIZE 4096
+
+// Working memory for zswap_store, too large for the kernel stack
+typedef struct ARC_ZSwapScratch {
+	uint16_t table[ARC_LZ_TABLE_SIZE];
+	uint8_t buffer[PAGE_SIZE - ARC_ZPOOL_CLASS_SIZE];
+} ARC_ZSwapScratch;
+
+// Sets up the size classes, called by init_userspace
+int init_zpool(void);
+
+// Pages go back to the PMM as soon as the last object in them is freed
+void *zpool_alloc(size_t size);
+void zpool_free(void *ptr, size_t size);
+
+// Compress the page into the pool, returns 0 on success
+int zswap_store(const void *page, ARC_SwapSlot *slot, ARC_ZSwapScratch *scratch);
+// Decompress the slot into page, returns 0 on success and -2 if the data is
+// corrupt. The slot is left as it is, zswap_drop frees it
+int zswap_load(ARC_SwapSlot *slot, void *page);
+void zswap_drop(ARC_SwapSlot *slot);
+
+#endif
@@ -0,0 +1,59 @@
+/**
+ * @file init.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#include "global.h"
+#include "userspace/futex.h"
+#include "userspace/init.h"
+#include "userspace/ipc.h"
+#include "userspace/ksm.h"
+#include "userspace/loaders/elf.h"
+#include "userspace/log.h"
+#include "userspace/percpu.h"
+#include "userspace/reaper.h"
+#include "userspace/template.h"
+#include "userspace/thread.h"
+#include "userspace/timer.h"
+#include "userspace/zswap.h"
+
+int init_userspace(void) {
+	percpu_register();
+	init_timers();
+	init_reaper();
+	init_zpool();
+	init_futexes();
+	init_thread_caches();
+	init_ksm();
+	init_elf_cache();
+	init_ipc();
+	init_templates();
+
+	if (init_log_consumer() == NULL) {
+		ARC_DEBUG(ERR, "Failed to start log consumer\n");
+		return -1;
+	}
+
+	return 0;
+}
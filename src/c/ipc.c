@@ -0,0 +1,1109 @@
+/**
+ * @file ipc.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#include "arch/pager.h"
+#include "arch/smp.h"
+#include "global.h"
+#include "lib/spinlock.h"
+#include "lib/util.h"
+#include "mm/allocator.h"
+#include "mm/pmm.h"
+#include "mm/vmm.h"
+#include "userspace/epoll.h"
+#include "userspace/ipc.h"
+#include "userspace/thread.h"
+#include "userspace/usercopy.h"
+
+struct ipc_segment {
+	struct ipc_segment *next;
+	ARC_IPCBuffer *buffer;
+	size_t offset;
+	size_t size;
+	// Allocated by the pipe to hold copied data, later writes may append
+	bool owned;
+};
+
+struct ipc_sleeper {
+	struct ipc_sleeper *next;
+	ARC_Thread *thread;
+};
+
+// An epoll instance interested in one end of the pipe
+struct ipc_watcher {
+	struct ipc_watcher *next;
+	ARC_Process *process;
+	int handle;
+	int end;
+};
+
+typedef struct ARC_Pipe {
+	ARC_Spinlock lock;
+	struct ipc_segment *head;
+	struct ipc_segment *tail;
+	size_t queued;
+	uint32_t ends[2];
+	struct ipc_sleeper *sleepers;
+	struct ipc_watcher *watchers;
+	// One for the name, one for each open end and one for each call using
+	// the pipe through a handle
+	uint32_t refs;
+} ARC_Pipe;
+
+struct ipc_name {
+	struct ipc_name *next;
+	char name[ARC_IPC_NAME_LIMIT];
+	// Exactly one is set
+	ARC_Pipe *pipe;
+	ARC_IPCBuffer *shm;
+};
+
+static struct {
+	ARC_Spinlock lock;
+	struct ipc_name *head;
+} names = { 0 };
+
+static size_t size_min(size_t a, size_t b) {
+	return a < b ? a : b;
+}
+
+int init_ipc(void) {
+	init_static_spinlock(&names.lock);
+
+	return 0;
+}
+
+static struct ipc_name *names_find(const char *name) {
+	for (struct ipc_name *entry = names.head; entry != NULL; entry = entry->next) {
+		if (strncmp(entry->name, name, ARC_IPC_NAME_LIMIT) == 0) {
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+static ARC_IPCBuffer *buffer_alloc(size_t count) {
+	ARC_IPCBuffer *buffer = (ARC_IPCBuffer *)alloc(sizeof(*buffer) + count * sizeof(void *));
+
+	if (buffer == NULL) {
+		return NULL;
+	}
+
+	buffer->refs = 1;
+	buffer->count = count;
+
+	for (size_t i = 0; i < count; i++) {
+		if ((buffer->pages[i] = pmm_alloc(PAGE_SIZE)) == NULL) {
+			while (i-- > 0) {
+				pmm_free(buffer->pages[i]);
+			}
+
+			free(buffer);
+
+			return NULL;
+		}
+
+		// May end up mapped into userspace
+		memset(buffer->pages[i], 0, PAGE_SIZE);
+	}
+
+	return buffer;
+}
+
+static void buffer_get(ARC_IPCBuffer *buffer) {
+	__atomic_add_fetch(&buffer->refs, 1, __ATOMIC_RELAXED);
+}
+
+ARC_IPCBuffer *ipc_buffer_ref(ARC_IPCBuffer *buffer) {
+	buffer_get(buffer);
+
+	return buffer;
+}
+
+static void buffer_put(ARC_IPCBuffer *buffer) {
+	if (__atomic_sub_fetch(&buffer->refs, 1, __ATOMIC_ACQ_REL) != 0) {
+		return;
+	}
+
+	for (size_t i = 0; i < buffer->count; i++) {
+		pmm_free(buffer->pages[i]);
+	}
+
+	free(buffer);
+}
+
+// Walks size bytes of the buffer from offset, a page at a time. Returns -1 if
+// a user copy failed
+static int buffer_copy(ARC_IPCBuffer *buffer, size_t offset, uint8_t *user, size_t size, bool to_user) {
+	while (size > 0) {
+		size_t in_page = offset & (PAGE_SIZE - 1);
+		size_t part = PAGE_SIZE - in_page < size ? PAGE_SIZE - in_page : size;
+		uint8_t *page = (uint8_t *)buffer->pages[offset / PAGE_SIZE] + in_page;
+
+		int ret = to_user ? copy_to_user(user, page, part) : copy_from_user(page, user, part);
+
+		if (ret != 0) {
+			return -1;
+		}
+
+		offset += part;
+		user += part;
+		size -= part;
+	}
+
+	return 0;
+}
+
+// Copies size bytes from the start of src into dst at offset, both are kernel
+// pages so it is safe under a spinlock
+static void buffer_append(ARC_IPCBuffer *dst, size_t offset, ARC_IPCBuffer *src, size_t size) {
+	size_t done = 0;
+
+	while (done < size) {
+		size_t to = (offset + done) & (PAGE_SIZE - 1);
+		size_t from = done & (PAGE_SIZE - 1);
+		size_t part = size_min(size_min(PAGE_SIZE - to, PAGE_SIZE - from), size - done);
+
+		memcpy((uint8_t *)dst->pages[(offset + done) / PAGE_SIZE] + to, (uint8_t *)src->pages[done / PAGE_SIZE] + from, part);
+
+		done += part;
+	}
+}
+
+// Maps buffer into process, the mapping takes over the caller's reference
+static void *buffer_map(ARC_Process *process, ARC_IPCBuffer *buffer, bool writable) {
+	size_t size = buffer->count * PAGE_SIZE;
+
+	if (process_charge_mapping(process, size, false) != 0) {
+		return NULL;
+	}
+
+	void *virt = vmm_alloc(process->allocator, size);
+
+	if (virt == NULL) {
+		process_uncharge_mapping(process, size, false);
+		return NULL;
+	}
+
+	uint32_t flags = (1 << ARC_PAGER_NX) | (writable << ARC_PAGER_RW) | (process->userspace << ARC_PAGER_US);
+
+	for (size_t i = 0; i < buffer->count; i++) {
+		uintptr_t page_virt = (uintptr_t)virt + i * PAGE_SIZE;
+		uintptr_t phys = ARC_HHDM_TO_PHYS(buffer->pages[i]);
+
+		if (pager_map(process->page_tables.user, page_virt, phys, PAGE_SIZE, flags) != 0) {
+			ARC_DEBUG(ERR, "Failed to map IPC buffer page\n");
+			pager_unmap(process->page_tables.user, (uintptr_t)virt, i * PAGE_SIZE, NULL);
+			pager_unmap(process->page_tables.kernel, (uintptr_t)virt, i * PAGE_SIZE, NULL);
+			vmm_free(process->allocator, virt);
+			process_uncharge_mapping(process, size, false);
+
+			return NULL;
+		}
+
+		// NOTE: As in vm_map, the page fault handler takes care of
+		//       this one failing
+		pager_map(process->page_tables.kernel, page_virt, phys, PAGE_SIZE, flags);
+	}
+
+	if (process_add_ipc_region(process, virt, buffer, flags) != 0) {
+		ARC_DEBUG(ERR, "Failed to track IPC mapping, it will outlive the process\n");
+	}
+
+	return virt;
+}
+
+int ipc_release_region(ARC_Process *process, ARC_ProcessRegion *region) {
+	if (region == NULL || region->ipc == NULL) {
+		return -1;
+	}
+
+	// The pages are not contiguous, but the range is
+	if (process != NULL && process->page_tables.user != NULL) {
+		pager_unmap(process->page_tables.user, (uintptr_t)region->virt, region->size, NULL);
+	}
+
+	if (process != NULL) {
+		pager_unmap(process->page_tables.kernel, (uintptr_t)region->virt, region->size, NULL);
+	}
+
+	buffer_put(region->ipc);
+	region->ipc = NULL;
+	region->phys = NULL;
+
+	return 0;
+}
+
+static ARC_IPCTable *get_table(ARC_Process *process) {
+	if (process->ipc != NULL) {
+		return process->ipc;
+	}
+
+	ARC_IPCTable *table = (ARC_IPCTable *)alloc(sizeof(*table));
+
+	if (table == NULL) {
+		ARC_DEBUG(ERR, "Failed to allocate IPC handle table\n");
+		return NULL;
+	}
+
+	memset(table, 0, sizeof(*table));
+	init_static_spinlock(&table->lock);
+
+	ARC_IPCTable *expected = NULL;
+	if (!__atomic_compare_exchange_n(&process->ipc, &expected, table, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		// Another thread got there first
+		free(table);
+		return expected;
+	}
+
+	return table;
+}
+
+static int add_handle(ARC_Process *process, ARC_Pipe *pipe, int end) {
+	ARC_IPCTable *table = get_table(process);
+
+	if (table == NULL) {
+		return -2;
+	}
+
+	spinlock_lock(&table->lock);
+
+	for (int i = 0; i < ARC_IPC_HANDLE_LIMIT; i++) {
+		if (table->handles[i].pipe == NULL) {
+			table->handles[i].pipe = pipe;
+			table->handles[i].end = end;
+			spinlock_unlock(&table->lock);
+
+			return i;
+		}
+	}
+
+	spinlock_unlock(&table->lock);
+
+	return -3;
+}
+
+// Called with the pipe's lock held
+static uint32_t pipe_events(ARC_Pipe *pipe, int end) {
+	if (end == ARC_PIPE_READ) {
+		return (pipe->queued > 0 ? ARC_EPOLL_IN : 0) | (pipe->ends[ARC_PIPE_WRITE] == 0 ? ARC_EPOLL_HUP : 0);
+	}
+
+	return (pipe->queued < ARC_PIPE_CAPACITY ? ARC_EPOLL_OUT : 0) | (pipe->ends[ARC_PIPE_READ] == 0 ? ARC_EPOLL_ERR : 0);
+}
+
+// Called with the pipe's lock held, whenever its state changes
+static void pipe_wake(ARC_Pipe *pipe) {
+	struct ipc_sleeper *sleeper = pipe->sleepers;
+	pipe->sleepers = NULL;
+
+	while (sleeper != NULL) {
+		struct ipc_sleeper *next = sleeper->next;
+		thread_unpark(sleeper->thread);
+		sleeper = next;
+	}
+
+	for (struct ipc_watcher *watcher = pipe->watchers; watcher != NULL; watcher = watcher->next) {
+		epoll_notify(watcher->process, ARC_EPOLL_PIPE_BASE + watcher->handle, pipe_events(pipe, watcher->end));
+	}
+}
+
+// Called with the pipe's lock held
+static void pipe_unwatch(ARC_Pipe *pipe, ARC_Process *process, int handle) {
+	struct ipc_watcher **link = &pipe->watchers;
+
+	while (*link != NULL) {
+		struct ipc_watcher *watcher = *link;
+
+		if (watcher->process == process && watcher->handle == handle) {
+			*link = watcher->next;
+			free(watcher);
+			continue;
+		}
+
+		link = &watcher->next;
+	}
+}
+
+// Called with the pipe's lock held, returns with it held again. Returns -1 if
+// the thread was stopped, in which case the caller is to give up
+static int pipe_sleep(ARC_Pipe *pipe) {
+	ARC_Thread *thread = smp_get_proc_desc()->thread;
+	struct ipc_sleeper sleeper = { .next = pipe->sleepers, .thread = thread };
+
+	pipe->sleepers = &sleeper;
+	thread_prepare_park(thread);
+	spinlock_unlock(&pipe->lock);
+
+	int ret = thread_park(thread);
+
+	spinlock_lock(&pipe->lock);
+
+	// Still listed if woken by anything other than pipe_wake
+	for (struct ipc_sleeper **link = &pipe->sleepers; *link != NULL; link = &(*link)->next) {
+		if (*link == &sleeper) {
+			*link = sleeper.next;
+			break;
+		}
+	}
+
+	return ret;
+}
+
+static void pipe_put(ARC_Pipe *pipe) {
+	if (__atomic_sub_fetch(&pipe->refs, 1, __ATOMIC_ACQ_REL) != 0) {
+		return;
+	}
+
+	struct ipc_segment *segment = pipe->head;
+
+	while (segment != NULL) {
+		struct ipc_segment *next = segment->next;
+		buffer_put(segment->buffer);
+		free(segment);
+		segment = next;
+	}
+
+	free(pipe);
+}
+
+// Returns the pipe behind handle with a reference the caller drops with
+// pipe_put, so a concurrent ipc_close cannot free it
+static ARC_Pipe *get_pipe(ARC_Process *process, int handle, int end) {
+	ARC_IPCTable *table = process->ipc;
+
+	if (table == NULL || handle < 0 || handle >= ARC_IPC_HANDLE_LIMIT) {
+		return NULL;
+	}
+
+	spinlock_lock(&table->lock);
+	ARC_Pipe *pipe = table->handles[handle].end == end ? table->handles[handle].pipe : NULL;
+
+	if (pipe != NULL) {
+		__atomic_add_fetch(&pipe->refs, 1, __ATOMIC_RELAXED);
+	}
+
+	spinlock_unlock(&table->lock);
+
+	return pipe;
+}
+
+// Called with the pipe's lock held
+static void pipe_enqueue(ARC_Pipe *pipe, struct ipc_segment *segment) {
+	segment->next = NULL;
+
+	if (pipe->tail != NULL) {
+		pipe->tail->next = segment;
+	} else {
+		pipe->head = segment;
+	}
+
+	pipe->tail = segment;
+	pipe->queued += segment->size;
+}
+
+// Called with the pipe's lock held
+static struct ipc_segment *pipe_dequeue(ARC_Pipe *pipe) {
+	struct ipc_segment *segment = pipe->head;
+
+	pipe->head = segment->next;
+	if (pipe->head == NULL) {
+		pipe->tail = NULL;
+	}
+
+	pipe->queued -= segment->size;
+
+	return segment;
+}
+
+// Called with the pipe's lock held, puts back what is left of a segment taken
+// off by pipe_dequeue
+static void pipe_requeue(ARC_Pipe *pipe, struct ipc_segment *segment) {
+	segment->next = pipe->head;
+	pipe->head = segment;
+
+	if (pipe->tail == NULL) {
+		pipe->tail = segment;
+	}
+
+	pipe->queued += segment->size;
+}
+
+int pipe_create(ARC_Process *process, const char *name, int handles[2]) {
+	if (process == NULL || handles == NULL) {
+		return -1;
+	}
+
+	ARC_Pipe *pipe = (ARC_Pipe *)alloc(sizeof(*pipe));
+
+	if (pipe == NULL) {
+		ARC_DEBUG(ERR, "Failed to allocate pipe\n");
+		return -2;
+	}
+
+	memset(pipe, 0, sizeof(*pipe));
+	init_static_spinlock(&pipe->lock);
+	pipe->ends[ARC_PIPE_READ] = 1;
+	pipe->ends[ARC_PIPE_WRITE] = 1;
+	pipe->refs = 2;
+
+	if (name != NULL) {
+		struct ipc_name *entry = (struct ipc_name *)alloc(sizeof(*entry));
+
+		if (entry == NULL) {
+			free(pipe);
+			return -2;
+		}
+
+		memset(entry, 0, sizeof(*entry));
+		strncpy(entry->name, name, ARC_IPC_NAME_LIMIT - 1);
+		entry->pipe = pipe;
+
+		spinlock_lock(&names.lock);
+
+		if (names_find(entry->name) != NULL) {
+			spinlock_unlock(&names.lock);
+			free(entry);
+			free(pipe);
+
+			return -4;
+		}
+
+		pipe->refs++;
+		entry->next = names.head;
+		names.head = entry;
+
+		spinlock_unlock(&names.lock);
+	}
+
+	handles[ARC_PIPE_READ] = add_handle(process, pipe, ARC_PIPE_READ);
+	handles[ARC_PIPE_WRITE] = add_handle(process, pipe, ARC_PIPE_WRITE);
+
+	if (handles[ARC_PIPE_READ] < 0 || handles[ARC_PIPE_WRITE] < 0) {
+		if (name != NULL) {
+			ipc_unlink(name);
+		}
+
+		if (handles[ARC_PIPE_READ] >= 0) {
+			ipc_close(process, handles[ARC_PIPE_READ]);
+		} else {
+			pipe_put(pipe);
+		}
+
+		if (handles[ARC_PIPE_WRITE] >= 0) {
+			ipc_close(process, handles[ARC_PIPE_WRITE]);
+		} else {
+			pipe_put(pipe);
+		}
+
+		return -3;
+	}
+
+	return 0;
+}
+
+int pipe_open(ARC_Process *process, const char *name, int end) {
+	if (process == NULL || name == NULL || (end != ARC_PIPE_READ && end != ARC_PIPE_WRITE)) {
+		return -1;
+	}
+
+	spinlock_lock(&names.lock);
+
+	struct ipc_name *entry = names_find(name);
+
+	if (entry == NULL || entry->pipe == NULL) {
+		spinlock_unlock(&names.lock);
+		return -1;
+	}
+
+	ARC_Pipe *pipe = entry->pipe;
+	__atomic_add_fetch(&pipe->refs, 1, __ATOMIC_RELAXED);
+
+	spinlock_unlock(&names.lock);
+
+	spinlock_lock(&pipe->lock);
+	pipe->ends[end]++;
+	spinlock_unlock(&pipe->lock);
+
+	int handle = add_handle(process, pipe, end);
+
+	if (handle < 0) {
+		spinlock_lock(&pipe->lock);
+		pipe->ends[end]--;
+		pipe_wake(pipe);
+		spinlock_unlock(&pipe->lock);
+		pipe_put(pipe);
+	}
+
+	return handle;
+}
+
+int ipc_close(ARC_Process *process, int handle) {
+	ARC_IPCTable *table = process != NULL ? process->ipc : NULL;
+
+	if (table == NULL || handle < 0 || handle >= ARC_IPC_HANDLE_LIMIT) {
+		return -1;
+	}
+
+	spinlock_lock(&table->lock);
+	ARC_Pipe *pipe = table->handles[handle].pipe;
+	int end = table->handles[handle].end;
+	table->handles[handle].pipe = NULL;
+	spinlock_unlock(&table->lock);
+
+	if (pipe == NULL) {
+		return -1;
+	}
+
+	spinlock_lock(&pipe->lock);
+	pipe_unwatch(pipe, process, handle);
+	pipe->ends[end]--;
+	// Readers see the end of the data, writers that nobody is left
+	pipe_wake(pipe);
+	spinlock_unlock(&pipe->lock);
+
+	pipe_put(pipe);
+
+	if (process->epoll != NULL) {
+		epoll_ctl(process, ARC_EPOLL_CTL_DEL, ARC_EPOLL_PIPE_BASE + handle, NULL);
+	}
+
+	return 0;
+}
+
+int ipc_watch(ARC_Process *process, int handle) {
+	ARC_IPCTable *table = process != NULL ? process->ipc : NULL;
+
+	if (table == NULL || handle < 0 || handle >= ARC_IPC_HANDLE_LIMIT) {
+		return -1;
+	}
+
+	struct ipc_watcher *watcher = (struct ipc_watcher *)alloc(sizeof(*watcher));
+
+	if (watcher == NULL) {
+		return -2;
+	}
+
+	watcher->process = process;
+	watcher->handle = handle;
+
+	spinlock_lock(&table->lock);
+	ARC_Pipe *pipe = table->handles[handle].pipe;
+	watcher->end = table->handles[handle].end;
+
+	if (pipe == NULL) {
+		spinlock_unlock(&table->lock);
+		free(watcher);
+		return -1;
+	}
+
+	// Held until the table lets go of the handle, which removes the
+	// watcher under the pipe's lock first
+	spinlock_lock(&pipe->lock);
+	spinlock_unlock(&table->lock);
+
+	watcher->next = pipe->watchers;
+	pipe->watchers = watcher;
+	epoll_notify(process, ARC_EPOLL_PIPE_BASE + handle, pipe_events(pipe, watcher->end));
+
+	spinlock_unlock(&pipe->lock);
+
+	return 0;
+}
+
+int ipc_unwatch(ARC_Process *process, int handle) {
+	ARC_IPCTable *table = process != NULL ? process->ipc : NULL;
+
+	if (table == NULL || handle < 0 || handle >= ARC_IPC_HANDLE_LIMIT) {
+		return -1;
+	}
+
+	spinlock_lock(&table->lock);
+	ARC_Pipe *pipe = table->handles[handle].pipe;
+
+	if (pipe == NULL) {
+		// Closed, which took the watcher with it
+		spinlock_unlock(&table->lock);
+		return -1;
+	}
+
+	spinlock_lock(&pipe->lock);
+	spinlock_unlock(&table->lock);
+
+	pipe_unwatch(pipe, process, handle);
+
+	spinlock_unlock(&pipe->lock);
+
+	return 0;
+}
+
+// Looks for a buffer mapping of process holding [address, address + size),
+// taking a reference to it. gift is cleared unless the whole mapping is
+// covered
+static ARC_IPCBuffer *find_buffer(ARC_Process *process, const void *address, size_t size, bool *gift, size_t *offset) {
+	ARC_IPCBuffer *buffer = NULL;
+	uintptr_t base = (uintptr_t)address;
+
+	spinlock_lock(&process->lock);
+
+	for (ARC_ProcessRegion *region = process->regions; region != NULL; region = region->next) {
+		uintptr_t virt = (uintptr_t)region->virt;
+
+		if (region->ipc == NULL || base < virt || base + size > virt + region->size) {
+			continue;
+		}
+
+		buffer = region->ipc;
+		buffer_get(buffer);
+		*offset = base - virt;
+
+		// Anything less leaves part of the mapping for the writer
+		*gift = *gift && base == virt && size > region->size - PAGE_SIZE;
+
+		break;
+	}
+
+	spinlock_unlock(&process->lock);
+
+	return buffer;
+}
+
+// Removes the writer's mapping of buffer at address once its pages are queued
+static void drop_gift(ARC_Process *process, const void *address, ARC_IPCBuffer *buffer) {
+	ARC_ProcessRegion *region = process_remove_region(process, (void *)address);
+
+	if (region != NULL && region->ipc == buffer) {
+		vmm_free(process->allocator, region->virt);
+		ipc_release_region(process, region);
+		process_uncharge_mapping(process, region->size, false);
+		free(region);
+	} else if (region != NULL) {
+		// NOTE: Should not happen, nothing else replaces a
+		//       region at the same address
+		ARC_DEBUG(ERR, "Region changed under a gift, leaking it\n");
+	}
+}
+
+// Called with the pipe's lock held, returns 1 once there is room, or as
+// pipe_write does if the write is to stop
+static long pipe_wait_room(ARC_Pipe *pipe, int flags) {
+	while (pipe->ends[ARC_PIPE_READ] > 0) {
+		if (pipe->queued < ARC_PIPE_CAPACITY) {
+			return 1;
+		}
+
+		if (flags & ARC_PIPE_NONBLOCK) {
+			return -2;
+		}
+
+		if (pipe_sleep(pipe) != 0) {
+			return -1;
+		}
+	}
+
+	return -3;
+}
+
+// Queues the pages of a buffer mapping as they are, even past the capacity
+static long pipe_write_shared(ARC_Process *process, ARC_Pipe *pipe, const void *buffer, size_t size, int flags) {
+	bool gift = flags & ARC_PIPE_GIFT;
+	size_t offset = 0;
+	ARC_IPCBuffer *pages = find_buffer(process, buffer, size, &gift, &offset);
+
+	if (pages == NULL) {
+		return 0;
+	}
+
+	struct ipc_segment *segment = (struct ipc_segment *)alloc(sizeof(*segment));
+
+	if (segment == NULL) {
+		buffer_put(pages);
+		return -1;
+	}
+
+	segment->buffer = pages;
+	segment->offset = offset;
+	segment->size = size;
+	segment->owned = false;
+
+	spinlock_lock(&pipe->lock);
+
+	long ret = pipe_wait_room(pipe, flags);
+
+	if (ret > 0) {
+		pipe_enqueue(pipe, segment);
+		pipe_wake(pipe);
+		ret = size;
+	}
+
+	spinlock_unlock(&pipe->lock);
+
+	if (ret < 0) {
+		// The writer keeps its mapping
+		buffer_put(pages);
+		free(segment);
+	} else if (gift) {
+		drop_gift(process, buffer, pages);
+	}
+
+	return ret;
+}
+
+long pipe_write(ARC_Process *process, int handle, const void *buffer, size_t size, int flags) {
+	ARC_Pipe *pipe = process != NULL ? get_pipe(process, handle, ARC_PIPE_WRITE) : NULL;
+
+	if (pipe == NULL || !user_access_ok(buffer, size)) {
+		if (pipe != NULL) {
+			pipe_put(pipe);
+		}
+
+		return -1;
+	}
+
+	long written = 0;
+
+	if (size >= ARC_PIPE_SHARE_MIN) {
+		written = pipe_write_shared(process, pipe, buffer, size, flags);
+	}
+
+	while (written >= 0 && written < (long)size) {
+		// Copied in before taking the lock, user memory may fault
+		size_t part = size_min(size - written, ARC_PIPE_CHUNK_PAGES * PAGE_SIZE);
+		struct ipc_segment *chunk = (struct ipc_segment *)alloc(sizeof(*chunk));
+		ARC_IPCBuffer *pages = chunk != NULL ? buffer_alloc(ALIGN(part, PAGE_SIZE) / PAGE_SIZE) : NULL;
+
+		if (pages == NULL || buffer_copy(pages, 0, (uint8_t *)buffer + written, part, false) != 0) {
+			if (pages != NULL) {
+				buffer_put(pages);
+			}
+
+			free(chunk);
+			written = written > 0 ? written : -1;
+			break;
+		}
+
+		chunk->buffer = pages;
+		chunk->offset = 0;
+		chunk->size = part;
+		chunk->owned = true;
+
+		spinlock_lock(&pipe->lock);
+
+		long ret = pipe_wait_room(pipe, flags);
+		struct ipc_segment *tail = pipe->tail;
+
+		if (ret < 0) {
+			written = written > 0 ? written : ret;
+		} else if (tail != NULL && tail->owned && tail->offset + tail->size + part <= tail->buffer->count * PAGE_SIZE) {
+			// Folded into the last chunk to keep small writes from
+			// holding a page each
+			buffer_append(tail->buffer, tail->offset + tail->size, pages, part);
+			tail->size += part;
+			pipe->queued += part;
+			written += part;
+		} else {
+			pipe_enqueue(pipe, chunk);
+			chunk = NULL;
+			written += part;
+		}
+
+		if (ret > 0) {
+			pipe_wake(pipe);
+		}
+
+		spinlock_unlock(&pipe->lock);
+
+		if (chunk != NULL) {
+			buffer_put(pages);
+			free(chunk);
+		}
+
+		if (ret < 0) {
+			break;
+		}
+	}
+
+	pipe_put(pipe);
+
+	return written;
+}
+
+// Called with the pipe's lock held, returns 1 once there is data, 0 if there
+// never will be, or negative
+static long pipe_wait_data(ARC_Pipe *pipe, int flags) {
+	while (pipe->queued == 0) {
+		if (pipe->ends[ARC_PIPE_WRITE] == 0) {
+			return 0;
+		}
+
+		if (flags & ARC_PIPE_NONBLOCK) {
+			return -2;
+		}
+
+		if (pipe_sleep(pipe) != 0) {
+			return -1;
+		}
+	}
+
+	return 1;
+}
+
+long pipe_read(ARC_Process *process, int handle, void *buffer, size_t size, int flags) {
+	ARC_Pipe *pipe = process != NULL ? get_pipe(process, handle, ARC_PIPE_READ) : NULL;
+
+	if (pipe == NULL || !user_access_ok(buffer, size)) {
+		if (pipe != NULL) {
+			pipe_put(pipe);
+		}
+
+		return -1;
+	}
+
+	if (size == 0) {
+		pipe_put(pipe);
+		return 0;
+	}
+
+	spinlock_lock(&pipe->lock);
+
+	long read = pipe_wait_data(pipe, flags);
+
+	if (read <= 0) {
+		spinlock_unlock(&pipe->lock);
+		pipe_put(pipe);
+
+		return read;
+	}
+
+	read = 0;
+
+	while (pipe->head != NULL && read < (long)size) {
+		// Taken off the queue so that the copy can run unlocked, which
+		// also keeps writers from appending to it meanwhile
+		struct ipc_segment *segment = pipe_dequeue(pipe);
+		pipe_wake(pipe);
+		spinlock_unlock(&pipe->lock);
+
+		size_t part = size_min(segment->size, size - read);
+		int ret = buffer_copy(segment->buffer, segment->offset, (uint8_t *)buffer + read, part, true);
+
+		if (ret == 0) {
+			read += part;
+			segment->offset += part;
+			segment->size -= part;
+		}
+
+		spinlock_lock(&pipe->lock);
+
+		if (segment->size > 0) {
+			pipe_requeue(pipe, segment);
+			pipe_wake(pipe);
+		} else {
+			buffer_put(segment->buffer);
+			free(segment);
+		}
+
+		if (ret != 0) {
+			read = read > 0 ? read : -1;
+			break;
+		}
+	}
+
+	spinlock_unlock(&pipe->lock);
+	pipe_put(pipe);
+
+	return read;
+}
+
+long pipe_read_map(ARC_Process *process, int handle, void **address, int flags) {
+	ARC_Pipe *pipe = process != NULL ? get_pipe(process, handle, ARC_PIPE_READ) : NULL;
+
+	if (pipe == NULL || address == NULL) {
+		if (pipe != NULL) {
+			pipe_put(pipe);
+		}
+
+		return -1;
+	}
+
+	spinlock_lock(&pipe->lock);
+
+	long ret = pipe_wait_data(pipe, flags);
+
+	if (ret <= 0) {
+		spinlock_unlock(&pipe->lock);
+		pipe_put(pipe);
+
+		return ret;
+	}
+
+	struct ipc_segment *segment = pipe->head;
+	size_t count = segment->buffer->count;
+
+	// Mapping more would hand out bytes that were never written to the pipe
+	if (segment->offset != 0 || segment->size <= (count - 1) * PAGE_SIZE) {
+		spinlock_unlock(&pipe->lock);
+		pipe_put(pipe);
+
+		return -4;
+	}
+
+	pipe_dequeue(pipe);
+	pipe_wake(pipe);
+	spinlock_unlock(&pipe->lock);
+	pipe_put(pipe);
+
+	ARC_IPCBuffer *buffer = segment->buffer;
+	bool writable = __atomic_load_n(&buffer->refs, __ATOMIC_ACQUIRE) == 1;
+
+	if ((*address = buffer_map(process, buffer, writable)) == NULL) {
+		buffer_put(buffer);
+		free(segment);
+		return -2;
+	}
+
+	ret = segment->size;
+	free(segment);
+
+	return ret;
+}
+
+void *ipc_buffer_map(ARC_Process *process, size_t size) {
+	if (process == NULL || size == 0) {
+		return NULL;
+	}
+
+	ARC_IPCBuffer *buffer = buffer_alloc(ALIGN(size, PAGE_SIZE) / PAGE_SIZE);
+
+	if (buffer == NULL) {
+		return NULL;
+	}
+
+	void *virt = buffer_map(process, buffer, true);
+
+	if (virt == NULL) {
+		buffer_put(buffer);
+	}
+
+	return virt;
+}
+
+void *shm_map(ARC_Process *process, const char *name, size_t size, bool create) {
+	if (process == NULL || name == NULL) {
+		return NULL;
+	}
+
+	spinlock_lock(&names.lock);
+
+	struct ipc_name *entry = names_find(name);
+
+	if (entry == NULL && create && size > 0) {
+		entry = (struct ipc_name *)alloc(sizeof(*entry));
+
+		if (entry != NULL && (entry->shm = buffer_alloc(ALIGN(size, PAGE_SIZE) / PAGE_SIZE)) == NULL) {
+			free(entry);
+			entry = NULL;
+		}
+
+		if (entry != NULL) {
+			entry->pipe = NULL;
+			memset(entry->name, 0, sizeof(entry->name));
+			strncpy(entry->name, name, ARC_IPC_NAME_LIMIT - 1);
+			entry->next = names.head;
+			names.head = entry;
+		}
+	}
+
+	if (entry == NULL || entry->shm == NULL) {
+		spinlock_unlock(&names.lock);
+		return NULL;
+	}
+
+	ARC_IPCBuffer *buffer = entry->shm;
+	buffer_get(buffer);
+
+	spinlock_unlock(&names.lock);
+
+	void *virt = buffer_map(process, buffer, true);
+
+	if (virt == NULL) {
+		buffer_put(buffer);
+	}
+
+	return virt;
+}
+
+int ipc_unlink(const char *name) {
+	if (name == NULL) {
+		return -1;
+	}
+
+	spinlock_lock(&names.lock);
+
+	struct ipc_name **link = &names.head;
+	while (*link != NULL && strncmp((*link)->name, name, ARC_IPC_NAME_LIMIT) != 0) {
+		link = &(*link)->next;
+	}
+
+	struct ipc_name *entry = *link;
+
+	if (entry != NULL) {
+		*link = entry->next;
+	}
+
+	spinlock_unlock(&names.lock);
+
+	if (entry == NULL) {
+		return -1;
+	}
+
+	if (entry->pipe != NULL) {
+		pipe_put(entry->pipe);
+	} else {
+		buffer_put(entry->shm);
+	}
+
+	free(entry);
+
+	return 0;
+}
+
+int uninit_ipc(ARC_Process *process) {
+	if (process == NULL || process->ipc == NULL) {
+		return -1;
+	}
+
+	for (int i = 0; i < ARC_IPC_HANDLE_LIMIT; i++) {
+		if (process->ipc->handles[i].pipe != NULL) {
+			ipc_close(process, i);
+		}
+	}
+
+	free(process->ipc);
+	process->ipc = NULL;
+
+	return 0;
+}
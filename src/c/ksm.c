@@ -0,0 +1,745 @@
+/**
+ * @file ksm.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#include "arch/pager.h"
+#include "global.h"
+#include "lib/spinlock.h"
+#include "lib/util.h"
+#include "mm/allocator.h"
+#include "mm/pmm.h"
+#include "userspace/ksm.h"
+#include "userspace/reaper.h"
+#include "userspace/timer.h"
+
+#include <stdbool.h>
+
+struct ksm_region {
+	struct ksm_region *next;
+	ARC_Process *process;
+	ARC_ProcessRegion *region;
+};
+
+// A page of region that was write protected to be merged into target
+struct ksm_pending {
+	struct ksm_pending *next;
+	ARC_Process *process;
+	ARC_ProcessRegion *region;
+	size_t index;
+	void *page;
+	ARC_KSMPage *target;
+	uint64_t epoch;
+};
+
+// Kept at the start of a page that was merged away, it is freed once no
+// processor can still read it through a stale TLB entry
+struct ksm_retired {
+	struct ksm_retired *next;
+	uint64_t epoch;
+};
+
+static struct {
+	ARC_Spinlock lock;
+	ARC_KSMPage *buckets[ARC_KSM_BUCKETS];
+	struct ksm_region *regions;
+	// Where the scanner continues from
+	struct ksm_region *cursor;
+	size_t cursor_index;
+	struct ksm_pending *pending;
+	size_t pending_count;
+	struct ksm_retired *retired;
+	uint64_t last_run;
+	ARC_KSMStats stats;
+} ksm = { 0 };
+
+int init_ksm(void) {
+	init_static_spinlock(&ksm.lock);
+
+	return 0;
+}
+
+static uint64_t page_hash(const void *page) {
+	const uint64_t *words = (const uint64_t *)page;
+	uint64_t hash = 0xCBF29CE484222325ULL;
+
+	for (size_t i = 0; i < PAGE_SIZE / sizeof(uint64_t); i++) {
+		hash = (hash ^ words[i]) * 0x100000001B3ULL;
+	}
+
+	return hash ^ (hash >> 29);
+}
+
+static void bucket_remove(ARC_KSMPage *entry) {
+	ARC_KSMPage **link = &ksm.buckets[entry->hash % ARC_KSM_BUCKETS];
+
+	while (*link != NULL && *link != entry) {
+		link = &(*link)->next;
+	}
+
+	if (*link != NULL) {
+		*link = entry->next;
+	}
+}
+
+// Candidates only stay valid for a single pass over the regions
+static void drop_candidates(void) {
+	for (int i = 0; i < ARC_KSM_BUCKETS; i++) {
+		ARC_KSMPage **link = &ksm.buckets[i];
+
+		while (*link != NULL) {
+			ARC_KSMPage *entry = *link;
+
+			if (entry->stable || entry->pending > 0) {
+				link = &entry->next;
+				continue;
+			}
+
+			*link = entry->next;
+			free(entry);
+		}
+	}
+}
+
+// NOTE: Only the TLB of the current processor is flushed, the others drop
+//       their entries as they switch threads, which is what the grace period
+//       of the reaper waits for
+static void remap_page(ARC_Process *process, ARC_ProcessRegion *region, size_t index, void *page, bool writable) {
+	uintptr_t virt = (uintptr_t)region->virt + index * PAGE_SIZE;
+	uint32_t flags = writable ? region->flags : region->flags & ~(1 << ARC_PAGER_RW);
+
+	if (process->page_tables.user != NULL) {
+		pager_unmap(process->page_tables.user, virt, PAGE_SIZE, NULL);
+		pager_map(process->page_tables.user, virt, ARC_HHDM_TO_PHYS(page), PAGE_SIZE, flags);
+	}
+
+	pager_unmap(process->page_tables.kernel, virt, PAGE_SIZE, NULL);
+	pager_map(process->page_tables.kernel, virt, ARC_HHDM_TO_PHYS(page), PAGE_SIZE, flags);
+
+#ifndef ARC_HOSTED
+	__asm__ volatile("invlpg (%0)" :: "r"(virt) : "memory");
+#endif
+}
+
+static void retire_page(void *page) {
+	struct ksm_retired *retired = (struct ksm_retired *)page;
+
+	retired->epoch = reaper_retire();
+	retired->next = ksm.retired;
+	ksm.retired = retired;
+}
+
+static void free_retired(void) {
+	struct ksm_retired **link = &ksm.retired;
+
+	while (*link != NULL) {
+		struct ksm_retired *retired = *link;
+
+		if (!reaper_grace_passed(retired->epoch)) {
+			link = &retired->next;
+			continue;
+		}
+
+		*link = retired->next;
+		pmm_free(retired);
+	}
+}
+
+// Whether the merge involves page index of region, any page of it if index is
+// SIZE_MAX
+static bool pending_matches(struct ksm_pending *pending, ARC_ProcessRegion *region, size_t index) {
+	if (pending->region == region && (index == SIZE_MAX || pending->index == index)) {
+		return true;
+	}
+
+	ARC_KSMPage *target = pending->target;
+
+	return !target->stable && target->region == region && (index == SIZE_MAX || target->index == index);
+}
+
+// Forgets merges involving the given page, or those into target. Pages stay
+// write protected, ksm_cow_fault makes them writable again when touched
+static void pending_cancel(ARC_ProcessRegion *region, size_t index, ARC_KSMPage *target) {
+	struct ksm_pending **link = &ksm.pending;
+
+	while (*link != NULL) {
+		struct ksm_pending *pending = *link;
+
+		if ((region == NULL || !pending_matches(pending, region, index)) && pending->target != target) {
+			link = &pending->next;
+			continue;
+		}
+
+		*link = pending->next;
+		pending->target->pending--;
+		ksm.pending_count--;
+		free(pending);
+	}
+}
+
+static bool pending_find(ARC_ProcessRegion *region, size_t index) {
+	for (struct ksm_pending *pending = ksm.pending; pending != NULL; pending = pending->next) {
+		if (pending_matches(pending, region, index)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+int ksm_enable_region(ARC_Process *process, void *address) {
+	if (process == NULL) {
+		return -1;
+	}
+
+	struct ksm_region *entry = (struct ksm_region *)alloc(sizeof(*entry));
+
+	if (entry == NULL) {
+		return -2;
+	}
+
+	spinlock_lock(&ksm.lock);
+	spinlock_lock(&process->lock);
+
+	ARC_ProcessRegion *region = process->regions;
+	while (region != NULL && region->virt != address) {
+		region = region->next;
+	}
+
+	if (region == NULL || region->swap != NULL || region->swapping || region->pages != NULL || region->cached || region->ipc != NULL
+	    || region->backing != NULL) {
+		spinlock_unlock(&process->lock);
+		spinlock_unlock(&ksm.lock);
+		free(entry);
+
+		return region != NULL && region->pages != NULL ? 0 : -3;
+	}
+
+	size_t count = region->size / PAGE_SIZE;
+	void **pages = (void **)alloc(sizeof(*pages) * count);
+	ARC_KSMPage **shared = (ARC_KSMPage **)alloc(sizeof(*shared) * count);
+
+	if (pages == NULL || shared == NULL) {
+		goto fail;
+	}
+
+	memset(pages, 0, sizeof(*pages) * count);
+	memset(shared, 0, sizeof(*shared) * count);
+
+	for (size_t i = 0; i < count; i++) {
+		if ((pages[i] = pmm_alloc(PAGE_SIZE)) == NULL) {
+			goto fail;
+		}
+
+		memcpy(pages[i], (uint8_t *)region->phys + i * PAGE_SIZE, PAGE_SIZE);
+	}
+
+	region->pages = pages;
+	region->shared = shared;
+
+	for (size_t i = 0; i < count; i++) {
+		remap_page(process, region, i, pages[i], true);
+	}
+
+	pmm_free(region->phys);
+	region->phys = NULL;
+
+	entry->process = process;
+	entry->region = region;
+	entry->next = ksm.regions;
+	ksm.regions = entry;
+
+	spinlock_unlock(&process->lock);
+	spinlock_unlock(&ksm.lock);
+
+	return 0;
+
+	fail:;
+	for (size_t i = 0; pages != NULL && i < count; i++) {
+		if (pages[i] != NULL) {
+			pmm_free(pages[i]);
+		}
+	}
+
+	free(pages);
+	free(shared);
+	free(entry);
+
+	spinlock_unlock(&process->lock);
+	spinlock_unlock(&ksm.lock);
+
+	return -4;
+}
+
+int ksm_release_region(ARC_Process *process, ARC_ProcessRegion *region) {
+	if (region == NULL || region->pages == NULL) {
+		return -1;
+	}
+
+	spinlock_lock(&ksm.lock);
+
+	struct ksm_region **link = &ksm.regions;
+	while (*link != NULL && (*link)->region != region) {
+		link = &(*link)->next;
+	}
+
+	if (*link != NULL) {
+		struct ksm_region *entry = *link;
+		*link = entry->next;
+
+		if (ksm.cursor == entry) {
+			ksm.cursor = entry->next;
+			ksm.cursor_index = 0;
+		}
+
+		free(entry);
+	}
+
+	// Candidates and merges may point into this region
+	pending_cancel(region, SIZE_MAX, NULL);
+	drop_candidates();
+
+	size_t count = region->size / PAGE_SIZE;
+
+	for (size_t i = 0; i < count; i++) {
+		uintptr_t virt = (uintptr_t)region->virt + i * PAGE_SIZE;
+
+		if (process != NULL && process->page_tables.user != NULL) {
+			pager_unmap(process->page_tables.user, virt, PAGE_SIZE, NULL);
+		}
+
+		if (process != NULL) {
+			pager_unmap(process->page_tables.kernel, virt, PAGE_SIZE, NULL);
+		}
+
+		ARC_KSMPage *shared = region->shared[i];
+
+		if (shared == NULL) {
+			pmm_free(region->pages[i]);
+			continue;
+		}
+
+		if (shared->refs >= 2) {
+			ksm.stats.pages_sharing--;
+		}
+
+		if (--shared->refs == 0) {
+			pending_cancel(NULL, 0, shared);
+			bucket_remove(shared);
+			pmm_free(shared->page);
+			free(shared);
+		}
+	}
+
+	spinlock_unlock(&ksm.lock);
+
+	free(region->pages);
+	free(region->shared);
+	region->pages = NULL;
+	region->shared = NULL;
+
+	return 0;
+}
+
+int ksm_share_region(ARC_Process *process, void *address) {
+	int ret = ksm_enable_region(process, address);
+
+	if (ret != 0) {
+		return ret;
+	}
+
+	spinlock_lock(&ksm.lock);
+	spinlock_lock(&process->lock);
+
+	ARC_ProcessRegion *region = process->regions;
+	while (region != NULL && region->virt != address) {
+		region = region->next;
+	}
+
+	// Candidates may point at the pages about to become shared
+	drop_candidates();
+
+	size_t count = region != NULL ? region->size / PAGE_SIZE : 0;
+
+	for (size_t i = 0; i < count; i++) {
+		if (region->shared[i] != NULL) {
+			continue;
+		}
+
+		ARC_KSMPage *entry = (ARC_KSMPage *)alloc(sizeof(*entry));
+
+		if (entry == NULL) {
+			ret = -4;
+			break;
+		}
+
+		// Never hashed, so nothing merges into it and bucket_remove
+		// finds nothing to do
+		memset(entry, 0, sizeof(*entry));
+		entry->page = region->pages[i];
+		entry->refs = 1;
+		entry->stable = 1;
+
+		region->shared[i] = entry;
+		remap_page(process, region, i, entry->page, false);
+	}
+
+	spinlock_unlock(&process->lock);
+	spinlock_unlock(&ksm.lock);
+
+	return region != NULL ? ret : -3;
+}
+
+int ksm_ref_region(ARC_ProcessRegion *copy, ARC_ProcessRegion *region) {
+	if (copy == NULL || region == NULL || region->pages == NULL) {
+		return -1;
+	}
+
+	size_t count = region->size / PAGE_SIZE;
+	void **pages = (void **)alloc(sizeof(*pages) * count);
+	ARC_KSMPage **shared = (ARC_KSMPage **)alloc(sizeof(*shared) * count);
+
+	if (pages == NULL || shared == NULL) {
+		free(pages);
+		free(shared);
+		return -2;
+	}
+
+	spinlock_lock(&ksm.lock);
+
+	for (size_t i = 0; i < count; i++) {
+		if (region->shared[i] == NULL) {
+			// Written since it was shared, so it cannot be used
+			while (i-- > 0) {
+				shared[i]->refs--;
+				ksm.stats.pages_sharing--;
+			}
+
+			spinlock_unlock(&ksm.lock);
+			free(pages);
+			free(shared);
+
+			return -3;
+		}
+
+		pages[i] = region->shared[i]->page;
+		shared[i] = region->shared[i];
+		shared[i]->refs++;
+		ksm.stats.pages_sharing++;
+	}
+
+	spinlock_unlock(&ksm.lock);
+
+	copy->pages = pages;
+	copy->shared = shared;
+
+	return 0;
+}
+
+// Called with the ksm lock and the lock of process held
+static void merge_into(ARC_KSMPage *stable, ARC_Process *process, ARC_ProcessRegion *region, size_t index) {
+	void *old = region->pages[index];
+
+	remap_page(process, region, index, stable->page, false);
+
+	region->pages[index] = stable->page;
+	region->shared[index] = stable;
+	stable->refs++;
+	ksm.stats.pages_sharing++;
+
+	// Other processors may still read it until they switch
+	retire_page(old);
+}
+
+// Called with the ksm lock held, once the grace period of pending has passed
+static void pending_merge(struct ksm_pending *pending) {
+	ARC_Process *process = pending->process;
+	ARC_ProcessRegion *region = pending->region;
+	ARC_KSMPage *target = pending->target;
+	ARC_Process *owner = target->stable ? process : target->owner;
+
+	spinlock_lock(&process->lock);
+	if (owner != process) {
+		spinlock_lock(&owner->lock);
+	}
+
+	// Both have been read-only everywhere since they were protected,
+	// unless a write fault cancelled the merge, so comparing them now
+	// cannot miss a write
+	bool valid = region->pages[pending->index] == pending->page && region->shared[pending->index] == NULL;
+
+	if (!target->stable) {
+		ARC_ProcessRegion *from = target->region;
+		valid = valid && from->pages[target->index] == target->page && from->shared[target->index] == NULL;
+	}
+
+	if (valid && memcmp(target->page, pending->page, PAGE_SIZE) == 0) {
+		if (!target->stable) {
+			target->stable = 1;
+			target->region->shared[target->index] = target;
+		}
+
+		merge_into(target, process, region, pending->index);
+	}
+
+	if (owner != process) {
+		spinlock_unlock(&owner->lock);
+	}
+	spinlock_unlock(&process->lock);
+}
+
+// Called with the ksm lock held
+static void run_pending(void) {
+	struct ksm_pending **link = &ksm.pending;
+
+	while (*link != NULL) {
+		struct ksm_pending *pending = *link;
+
+		if (!reaper_grace_passed(pending->epoch)) {
+			link = &pending->next;
+			continue;
+		}
+
+		pending_merge(pending);
+
+		*link = pending->next;
+		pending->target->pending--;
+		ksm.pending_count--;
+		free(pending);
+	}
+}
+
+// Called with the ksm lock and the lock of process held. The page and, if
+// it is a candidate, the one it matches are write protected and left for a
+// later run to compare
+static void queue_merge(ARC_KSMPage *target, ARC_Process *process, ARC_ProcessRegion *region, size_t index) {
+	if (ksm.pending_count >= ARC_KSM_PAGES_PER_RUN) {
+		return;
+	}
+
+	struct ksm_pending *pending = (struct ksm_pending *)alloc(sizeof(*pending));
+
+	if (pending == NULL) {
+		return;
+	}
+
+	if (!target->stable) {
+		ARC_Process *owner = target->owner;
+
+		if (owner != process) {
+			spinlock_lock(&owner->lock);
+		}
+
+		remap_page(owner, target->region, target->index, target->page, false);
+
+		if (owner != process) {
+			spinlock_unlock(&owner->lock);
+		}
+	}
+
+	remap_page(process, region, index, region->pages[index], false);
+
+	pending->process = process;
+	pending->region = region;
+	pending->index = index;
+	pending->page = region->pages[index];
+	pending->target = target;
+	pending->epoch = reaper_retire();
+	pending->next = ksm.pending;
+	ksm.pending = pending;
+	ksm.pending_count++;
+	target->pending++;
+}
+
+// Called with the ksm lock and the lock of process held
+static void scan_page(ARC_Process *process, ARC_ProcessRegion *region, size_t index) {
+	if (region->shared[index] != NULL || pending_find(region, index)) {
+		return;
+	}
+
+	void *page = region->pages[index];
+	uint64_t hash = page_hash(page);
+	ARC_KSMPage **bucket = &ksm.buckets[hash % ARC_KSM_BUCKETS];
+
+	for (ARC_KSMPage *entry = *bucket; entry != NULL; entry = entry->next) {
+		if (entry->hash != hash || entry->page == page) {
+			continue;
+		}
+
+		// Only a hint while the page is writable, the comparison that
+		// counts happens once it is not
+		if (memcmp(entry->page, page, PAGE_SIZE) == 0) {
+			queue_merge(entry, process, region, index);
+			return;
+		}
+	}
+
+	ARC_KSMPage *candidate = (ARC_KSMPage *)alloc(sizeof(*candidate));
+
+	if (candidate == NULL) {
+		return;
+	}
+
+	candidate->page = page;
+	candidate->hash = hash;
+	candidate->refs = 1;
+	candidate->stable = 0;
+	candidate->pending = 0;
+	candidate->owner = process;
+	candidate->region = region;
+	candidate->index = index;
+	candidate->next = *bucket;
+	*bucket = candidate;
+}
+
+size_t ksm_run(void) {
+	uint64_t now = timer_now();
+
+	if (ksm.regions == NULL || now - __atomic_load_n(&ksm.last_run, __ATOMIC_RELAXED) < ARC_KSM_INTERVAL_NS) {
+		return 0;
+	}
+
+	spinlock_lock(&ksm.lock);
+	ksm.last_run = now;
+
+	run_pending();
+	free_retired();
+
+	size_t scanned = 0;
+
+	while (scanned < ARC_KSM_PAGES_PER_RUN && ksm.regions != NULL) {
+		if (ksm.cursor == NULL) {
+			// Start of a new pass
+			ksm.cursor = ksm.regions;
+			ksm.cursor_index = 0;
+			ksm.stats.full_scans++;
+			drop_candidates();
+		}
+
+		struct ksm_region *current = ksm.cursor;
+		ARC_Process *process = current->process;
+		size_t count = current->region->size / PAGE_SIZE;
+
+		spinlock_lock(&process->lock);
+
+		while (ksm.cursor_index < count && scanned < ARC_KSM_PAGES_PER_RUN) {
+			scan_page(process, current->region, ksm.cursor_index);
+			ksm.cursor_index++;
+			scanned++;
+		}
+
+		spinlock_unlock(&process->lock);
+
+		if (ksm.cursor_index >= count) {
+			ksm.cursor = current->next;
+			ksm.cursor_index = 0;
+		}
+	}
+
+	ksm.stats.pages_scanned += scanned;
+
+	spinlock_unlock(&ksm.lock);
+
+	return scanned;
+}
+
+int ksm_cow_fault(ARC_Process *process, void *address) {
+	if (process == NULL) {
+		return -1;
+	}
+
+	int ret = -2;
+
+	spinlock_lock(&ksm.lock);
+	spinlock_lock(&process->lock);
+
+	for (ARC_ProcessRegion *region = process->regions; region != NULL; region = region->next) {
+		uintptr_t base = (uintptr_t)region->virt;
+
+		if ((uintptr_t)address < base || base + region->size <= (uintptr_t)address || region->pages == NULL) {
+			continue;
+		}
+
+		if ((region->flags & (1 << ARC_PAGER_RW)) == 0) {
+			// Never was writable
+			break;
+		}
+
+		size_t index = ((uintptr_t)address - base) / PAGE_SIZE;
+		ARC_KSMPage *shared = region->shared[index];
+
+		if (shared == NULL) {
+			// Write protected by the scanner, the merge is off
+			pending_cancel(region, index, NULL);
+			remap_page(process, region, index, region->pages[index], true);
+			ret = 0;
+			break;
+		}
+
+		if (shared->refs == 1) {
+			// Last one left, it is private again
+			pending_cancel(NULL, 0, shared);
+			bucket_remove(shared);
+			free(shared);
+			region->shared[index] = NULL;
+			remap_page(process, region, index, region->pages[index], true);
+			ret = 0;
+			break;
+		}
+
+		void *copy = pmm_alloc(PAGE_SIZE);
+
+		if (copy == NULL) {
+			ret = -3;
+			break;
+		}
+
+		memcpy(copy, shared->page, PAGE_SIZE);
+		remap_page(process, region, index, copy, true);
+
+		region->pages[index] = copy;
+		region->shared[index] = NULL;
+		shared->refs--;
+		ksm.stats.pages_sharing--;
+		ksm.stats.pages_unshared++;
+		ret = 0;
+
+		break;
+	}
+
+	spinlock_unlock(&process->lock);
+	spinlock_unlock(&ksm.lock);
+
+	return ret;
+}
+
+void ksm_get_stats(ARC_KSMStats *stats) {
+	if (stats == NULL) {
+		return;
+	}
+
+	spinlock_lock(&ksm.lock);
+	*stats = ksm.stats;
+	spinlock_unlock(&ksm.lock);
+}
@@ -0,0 +1,319 @@
+/**
+ * @file 32.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#include "userspace/loaders/elf.h"
+#include "userspace/loader.h"
+#include "fs/vfs.h"
+#include "global.h"
+#include "lib/util.h"
+#include "mm/allocator.h"
+#include "abi-bits/seek-whence.h"
+
+// x32 binaries run in long mode, but every pointer they hold is 32 bits
+#define ADDRESS_LIMIT 0x100000000
+
+static int symbol_value(struct ARC_ELFMeta *elf_meta, uintptr_t symtab, size_t syment, uint32_t index, uint32_t *value) {
+        if (index == 0) {
+                *value = 0;
+                return 0;
+        }
+
+        struct Elf32_Sym *symbol = elf_segment_target(elf_meta, symtab + index * syment, sizeof(*symbol), NULL);
+
+        if (symtab == 0 || symbol == NULL) {
+                return -1;
+        }
+
+        if (symbol->st_shndx == SHN_UNDEF) {
+                *value = 0;
+                return ELF32_ST_BIND(symbol->st_info) == STB_WEAK ? 0 : -1;
+        }
+
+        *value = elf_meta->base + symbol->st_value;
+
+        return 0;
+}
+
+static int apply_relocations(struct ARC_ELFMeta *elf_meta, uintptr_t table, size_t size, size_t entsize, bool rela,
+                             uintptr_t symtab, size_t syment) {
+        if (table == 0 || size == 0) {
+                return 0;
+        }
+
+        if (entsize == 0) {
+                entsize = rela ? sizeof(struct Elf32_Rela) : sizeof(struct Elf32_Rel);
+        }
+
+        for (size_t i = 0; i + entsize <= size; i += entsize) {
+                struct Elf32_Rela *entry = elf_segment_target(elf_meta, table + i, entsize, NULL);
+
+                if (entry == NULL) {
+                        return -1;
+                }
+
+                uint32_t type = ELF32_R_TYPE(entry->r_info);
+                bool shared = false;
+                uint32_t *target = elf_segment_target(elf_meta, elf_meta->base + entry->r_offset, sizeof(uint32_t), &shared);
+
+                if (target == NULL) {
+                        ARC_DEBUG(ERR, "Relocation outside of the image (0x%x)\n", entry->r_offset);
+                        return -1;
+                }
+
+                if (type == R_X86_64_NONE || shared) {
+                        continue;
+                }
+
+                int32_t addend = rela ? entry->r_addend : (int32_t)*target;
+                uint32_t symbol = 0;
+
+                if (type != R_X86_64_RELATIVE && symbol_value(elf_meta, symtab, syment, ELF32_R_SYM(entry->r_info), &symbol) != 0) {
+                        ARC_DEBUG(ERR, "Unresolved symbol %u\n", ELF32_R_SYM(entry->r_info));
+                        return -1;
+                }
+
+                // Word sized fields are 32 bits wide under x32
+                switch (type) {
+                case R_X86_64_RELATIVE: {
+                        *target = elf_meta->base + addend;
+                        break;
+                }
+
+                case R_X86_64_32: {
+                        *target = symbol + addend;
+                        break;
+                }
+
+                case R_X86_64_GLOB_DAT:
+                case R_X86_64_JUMP_SLOT: {
+                        *target = symbol;
+                        break;
+                }
+
+                default: {
+                        ARC_DEBUG(ERR, "Unsupported relocation type %d\n", type);
+                        return -1;
+                }
+                }
+        }
+
+        return 0;
+}
+
+static int relocate(struct ARC_ELFMeta *elf_meta, struct Elf64_Phdr *dynamic) {
+        struct Elf32_Dyn *entries = elf_segment_target(elf_meta, elf_meta->base + dynamic->p_vaddr, dynamic->p_memsz, NULL);
+
+        if (entries == NULL) {
+                ARC_DEBUG(ERR, "PT_DYNAMIC is not loaded\n");
+                return -1;
+        }
+
+        uint32_t values[DT_JMPREL + 1] = { 0 };
+
+        for (size_t i = 0; i < dynamic->p_memsz / sizeof(*entries) && entries[i].d_tag != DT_NULL; i++) {
+                if (entries[i].d_tag >= 0 && entries[i].d_tag <= DT_JMPREL) {
+                        values[entries[i].d_tag] = entries[i].d_un.d_val;
+                }
+        }
+
+        uintptr_t base = elf_meta->base;
+        uintptr_t symtab = values[DT_SYMTAB] == 0 ? 0 : base + values[DT_SYMTAB];
+        size_t syment = values[DT_SYMENT] == 0 ? sizeof(struct Elf32_Sym) : values[DT_SYMENT];
+
+        if (values[DT_RELA] != 0 && apply_relocations(elf_meta, base + values[DT_RELA], values[DT_RELASZ], values[DT_RELAENT], true, symtab, syment) != 0) {
+                return -1;
+        }
+
+        if (values[DT_REL] != 0 && apply_relocations(elf_meta, base + values[DT_REL], values[DT_RELSZ], values[DT_RELENT], false, symtab, syment) != 0) {
+                return -1;
+        }
+
+        if (values[DT_JMPREL] != 0 && apply_relocations(elf_meta, base + values[DT_JMPREL], values[DT_PLTRELSZ], 0,
+                                                        values[DT_PLTREL] != DT_REL, symtab, syment) != 0) {
+                return -1;
+        }
+
+        return 0;
+}
+
+static int probe(void *data, size_t size) {
+        uint8_t *ident = (uint8_t *)data;
+
+        if (size < sizeof(struct Elf32_Ehdr) || ident[ELF_EI_MAG0] != 0x7F || ident[ELF_EI_MAG1] != 'E'
+            || ident[ELF_EI_MAG2] != 'L' || ident[ELF_EI_MAG3] != 'F' || ident[ELF_EI_CLASS] != ELF_CLASS_32) {
+                return -1;
+        }
+
+        // Only x32, i386 code cannot run in long mode
+        return ((struct Elf32_Ehdr *)data)->e_machine == EM_X86_64 ? 0 : -1;
+}
+
+// The rest of the loader works on the 64-bit layout
+static void widen_header(struct Elf64_Ehdr *wide, struct Elf32_Ehdr *header) {
+        memcpy(wide->e_ident, header->e_ident, sizeof(wide->e_ident));
+        wide->e_type = header->e_type;
+        wide->e_machine = header->e_machine;
+        wide->e_version = header->e_version;
+        wide->e_entry = header->e_entry;
+        wide->e_phoff = header->e_phoff;
+        wide->e_shoff = header->e_shoff;
+        wide->e_flags = header->e_flags;
+        wide->e_ehsize = header->e_ehsize;
+        wide->e_phentsize = header->e_phentsize;
+        wide->e_phnum = header->e_phnum;
+        wide->e_shentsize = header->e_shentsize;
+        wide->e_shnum = header->e_shnum;
+        wide->e_shstrndx = header->e_shstrndx;
+}
+
+static void widen_phdr(struct Elf64_Phdr *wide, struct Elf32_Phdr *phdr) {
+        wide->p_type = phdr->p_type;
+        wide->p_flags = phdr->p_flags;
+        wide->p_offset = phdr->p_offset;
+        wide->p_vaddr = phdr->p_vaddr;
+        wide->p_paddr = phdr->p_paddr;
+        wide->p_filesz = phdr->p_filesz;
+        wide->p_memsz = phdr->p_memsz;
+        wide->p_align = phdr->p_align;
+}
+
+static int init(ARC_ProgramMeta *meta, ARC_File *file) {
+        ARC_DEBUG(INFO, "Loading 32-bit ELF file (%p)\n", file);
+
+        struct Elf32_Ehdr header = { 0 };
+        uint8_t *buffer = NULL;
+        size_t have = 0;
+
+        if (meta->header != NULL && meta->header_size >= sizeof(header)) {
+                buffer = (uint8_t *)meta->header;
+                have = meta->header_size;
+                memcpy(&header, buffer, sizeof(header));
+        } else {
+                vfs_seek(file, 0, SEEK_SET);
+                vfs_read(&header, 1, sizeof(header), file);
+        }
+
+        if (header.e_ident[ELF_EI_CLASS] != ELF_CLASS_32 || header.e_machine != EM_X86_64
+            || (header.e_type != ET_EXEC && header.e_type != ET_DYN)) {
+                return -1;
+        }
+
+        struct ARC_ELFMeta *elf_meta = (struct ARC_ELFMeta *)alloc(sizeof(*elf_meta));
+        struct Elf64_Ehdr *wide = (struct Elf64_Ehdr *)alloc(sizeof(*wide));
+        struct Elf64_Phdr *phdrs = (struct Elf64_Phdr *)alloc(sizeof(*phdrs) * header.e_phnum);
+        struct Elf32_Phdr *narrow = (struct Elf32_Phdr *)alloc(sizeof(*narrow) * header.e_phnum);
+
+        if (elf_meta == NULL || wide == NULL || phdrs == NULL || narrow == NULL) {
+                ARC_DEBUG(ERR, "Failed to allocate ELF metadata\n");
+                goto fail;
+        }
+
+        size_t phdrs_size = sizeof(*narrow) * header.e_phnum;
+
+        if (header.e_phoff <= have && phdrs_size <= have - header.e_phoff) {
+                memcpy(narrow, buffer + header.e_phoff, phdrs_size);
+        } else {
+                vfs_seek(file, header.e_phoff, SEEK_SET);
+                vfs_read(narrow, 1, phdrs_size, file);
+        }
+
+        uintptr_t base = header.e_type == ET_DYN ? ARC_ELF_DYN_BASE : 0;
+        bool interp = false;
+
+        for (uint32_t i = 0; i < header.e_phnum; i++) {
+                interp |= narrow[i].p_type == PT_INTERP;
+        }
+
+        for (uint32_t i = 0; i < header.e_phnum; i++) {
+                widen_phdr(&phdrs[i], &narrow[i]);
+
+                if (phdrs[i].p_type != PT_LOAD) {
+                        continue;
+                }
+
+                uintptr_t start = base + phdrs[i].p_vaddr;
+                uintptr_t end = start + phdrs[i].p_memsz;
+
+                if (end > ADDRESS_LIMIT) {
+                        ARC_DEBUG(ERR, "Segment %d does not fit below 4GiB\n", i);
+                        goto fail;
+                }
+
+                // Both are placed at fixed addresses, whatever the image
+                if (start < ARC_ELF_LOW_ARENA + ARC_ELF_LOW_ARENA_SIZE && end > ARC_ELF_LOW_ARENA) {
+                        ARC_DEBUG(ERR, "Segment %d overlaps the process allocator\n", i);
+                        goto fail;
+                }
+
+                if (interp && end > ARC_ELF_INTERP_BASE_32) {
+                        ARC_DEBUG(ERR, "Segment %d overlaps the interpreter\n", i);
+                        goto fail;
+                }
+        }
+
+        free(narrow);
+        widen_header(wide, &header);
+
+        memset(elf_meta, 0, sizeof(*elf_meta));
+        elf_meta->header = wide;
+        elf_meta->phdrs.headers = phdrs;
+        elf_meta->phdrs.count = header.e_phnum;
+        elf_meta->phdrs.size = sizeof(*phdrs);
+        elf_meta->relocate_image = relocate;
+
+        meta->loader_data = (void *)elf_meta;
+        meta->address_limit = ADDRESS_LIMIT;
+
+        return elf_init_image(meta, elf_meta, file) == 0 ? 0 : -3;
+
+        fail:;
+        if (elf_meta != NULL) {
+                free(elf_meta);
+        }
+
+        if (wide != NULL) {
+                free(wide);
+        }
+
+        if (phdrs != NULL) {
+                free(phdrs);
+        }
+
+        if (narrow != NULL) {
+                free(narrow);
+        }
+
+        return -2;
+}
+
+ARC_REGISTER_LOADER(ARC_LDRGRP_32BIT, elf) = {
+        .init = init,
+        .uninit = elf_uninit,
+        .load = elf_load,
+        .unload = elf_unload,
+        .probe = probe,
+        .clone = elf_clone,
+};
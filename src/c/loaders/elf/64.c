@@ -27,99 +27,188 @@
 #include "userspace/loaders/elf.h"
 #include "userspace/loader.h"
 #include "fs/vfs.h"
+#include "global.h"
+#include "lib/util.h"
 #include "mm/allocator.h"
 #include "abi-bits/seek-whence.h"
 
-static int load_page(ARC_ProgramMeta *meta, void *virt) {
-        // TODO: Pager must be reworked for this
-        // void *a = NULL
-        // if ((a = pager_to_phys(page_tables, virt)) == NULL) {
-        //         a = pmm_alloc(PAGE_SIZE);
-        // }
-        // vfs_seek(file, offset to data in file, SEEK_SET);
-        // vfs_read(a + offset in page, 1, PAGE_SIZE - offset, file);
-        
-        return -1;
+static int symbol_value(struct ARC_ELFMeta *elf_meta, uintptr_t symtab, size_t syment, uint64_t index, uint64_t *value) {
+        if (index == 0) {
+                *value = 0;
+                return 0;
+        }
+
+        struct Elf64_Sym *symbol = elf_segment_target(elf_meta, symtab + index * syment, sizeof(*symbol), NULL);
+
+        if (symtab == 0 || symbol == NULL) {
+                return -1;
+        }
+
+        if (symbol->st_shndx == SHN_UNDEF) {
+                // Nothing else is loaded to resolve against
+                *value = 0;
+                return ELF64_ST_BIND(symbol->st_info) == STB_WEAK ? 0 : -1;
+        }
+
+        *value = elf_meta->base + symbol->st_value;
+
+        return 0;
 }
 
-int load(ARC_ProgramMeta *meta, void *virt, size_t size) {
-        struct ARC_ELFMeta *elf_meta = meta->loader_data;
-        
-        if (virt == NULL) {
-                ARC_DEBUG(INFO, "Loading full program from memory\n");
-
-                for (uint32_t i = 0; i < elf_meta->phdrs.count; i++) {
-                        struct Elf64_Phdr header = elf_meta->phdrs.headers[i];
-                        
-                        ARC_DEBUG(INFO, "\tHeader %d 0x%"PRIx64":0x%"PRIx64" 0x%"PRIx64", 0x%"PRIx64":0x%"PRIx64" B\n", i, header.p_paddr, header.p_vaddr,
-                                  header.p_offset, header.p_memsz, header.p_filesz);
-                        
-                        switch (header.p_type) {
-                        case PT_LOAD: {
-                                break;
-                        }
-                                
-                        }
+static int apply_relocations(struct ARC_ELFMeta *elf_meta, uintptr_t table, size_t size, size_t entsize, bool rela,
+                             uintptr_t symtab, size_t syment) {
+        if (table == 0 || size == 0) {
+                return 0;
+        }
+
+        if (entsize == 0) {
+                entsize = rela ? sizeof(struct Elf64_Rela) : sizeof(struct Elf64_Rel);
+        }
+
+        for (size_t i = 0; i + entsize <= size; i += entsize) {
+                struct Elf64_Rela *entry = elf_segment_target(elf_meta, table + i, entsize, NULL);
+
+                if (entry == NULL) {
+                        return -1;
+                }
+
+                uint32_t type = ELF64_R_TYPE(entry->r_info);
+                bool shared = false;
+                uint64_t *target = elf_segment_target(elf_meta, elf_meta->base + entry->r_offset, sizeof(uint64_t), &shared);
+
+                if (target == NULL) {
+                        ARC_DEBUG(ERR, "Relocation outside of the image (0x%"PRIx64")\n", entry->r_offset);
+                        return -1;
                 }
-                
+
+                if (type == R_X86_64_NONE || shared) {
+                        // Cached pages were relocated for this base already
+                        continue;
+                }
+
+                int64_t addend = rela ? entry->r_addend : (int64_t)*target;
+                uint64_t symbol = 0;
+
+                if (type != R_X86_64_RELATIVE && symbol_value(elf_meta, symtab, syment, ELF64_R_SYM(entry->r_info), &symbol) != 0) {
+                        ARC_DEBUG(ERR, "Unresolved symbol %"PRIu64"\n", (uint64_t)ELF64_R_SYM(entry->r_info));
+                        return -1;
+                }
+
+                switch (type) {
+                case R_X86_64_RELATIVE: {
+                        *target = elf_meta->base + addend;
+                        break;
+                }
+
+                case R_X86_64_64: {
+                        *target = symbol + addend;
+                        break;
+                }
+
+                case R_X86_64_GLOB_DAT:
+                case R_X86_64_JUMP_SLOT: {
+                        *target = symbol;
+                        break;
+                }
+
+                default: {
+                        ARC_DEBUG(ERR, "Unsupported relocation type %d\n", type);
+                        return -1;
+                }
+                }
+        }
+
+        return 0;
+}
+
+static int relocate(struct ARC_ELFMeta *elf_meta, struct Elf64_Phdr *dynamic) {
+        struct Elf64_Dyn *entries = elf_segment_target(elf_meta, elf_meta->base + dynamic->p_vaddr, dynamic->p_memsz, NULL);
+
+        if (entries == NULL) {
+                ARC_DEBUG(ERR, "PT_DYNAMIC is not loaded\n");
                 return -1;
         }
 
-        for (uint32_t i = 0; i < elf_meta->phdrs.count; i++) {
-                struct Elf64_Phdr *header = &elf_meta->phdrs.headers[i];
+        // Indexed by tag, only the small ones are of interest
+        uint64_t values[DT_JMPREL + 1] = { 0 };
 
-                if (header->p_vaddr <= (uintptr_t)virt && (uintptr_t)virt <= header->p_vaddr + header->p_memsz) {
-                        return load_page(header, virt);
+        for (size_t i = 0; i < dynamic->p_memsz / sizeof(*entries) && entries[i].d_tag != DT_NULL; i++) {
+                if (entries[i].d_tag >= 0 && entries[i].d_tag <= DT_JMPREL) {
+                        values[entries[i].d_tag] = entries[i].d_un.d_val;
                 }
         }
-        
-        return -1;
-}
 
-int unload(ARC_ProgramMeta *meta, void *virt, size_t size) {
-        if (virt == NULL) {
-                ARC_DEBUG(INFO, "Unloading full program from memory\n");
-                return 0;
+        uintptr_t base = elf_meta->base;
+        uintptr_t symtab = values[DT_SYMTAB] == 0 ? 0 : base + values[DT_SYMTAB];
+        size_t syment = values[DT_SYMENT] == 0 ? sizeof(struct Elf64_Sym) : values[DT_SYMENT];
+
+        if (values[DT_RELA] != 0 && apply_relocations(elf_meta, base + values[DT_RELA], values[DT_RELASZ], values[DT_RELAENT], true, symtab, syment) != 0) {
+                return -1;
         }
 
-        return -1;
+        if (values[DT_REL] != 0 && apply_relocations(elf_meta, base + values[DT_REL], values[DT_RELSZ], values[DT_RELENT], false, symtab, syment) != 0) {
+                return -1;
+        }
+
+        if (values[DT_JMPREL] != 0 && apply_relocations(elf_meta, base + values[DT_JMPREL], values[DT_PLTRELSZ], 0,
+                                                        values[DT_PLTREL] != DT_REL, symtab, syment) != 0) {
+                return -1;
+        }
+
+        return 0;
 }
 
-int uninit(ARC_ProgramMeta *meta) {
-        return -1;
+static int probe(void *data, size_t size) {
+        uint8_t *ident = (uint8_t *)data;
+
+        if (size < sizeof(struct Elf64_Ehdr) || ident[ELF_EI_MAG0] != 0x7F || ident[ELF_EI_MAG1] != 'E'
+            || ident[ELF_EI_MAG2] != 'L' || ident[ELF_EI_MAG3] != 'F') {
+                return -1;
+        }
+
+        return ident[ELF_EI_CLASS] == ELF_CLASS_64 ? 0 : -1;
 }
 
-int init(ARC_ProgramMeta *meta, ARC_File *file) {
+static int init(ARC_ProgramMeta *meta, ARC_File *file) {
         ARC_DEBUG(INFO, "Loading 64-bit ELF file (%p)\n", file);
 
-	struct ARC_ELFMeta *elf_meta = (struct ARC_ELFMeta *)alloc(sizeof(*meta));
-	if (meta == NULL) {
+	struct ARC_ELFMeta *elf_meta = (struct ARC_ELFMeta *)alloc(sizeof(*elf_meta));
+	if (elf_meta == NULL) {
 		ARC_DEBUG(ERR, "Failed to allocate ELF metadata\n");
 		return -1;
 	}
 
+        memset(elf_meta, 0, sizeof(*elf_meta));
         meta->loader_data = (void *)elf_meta;
+        meta->tls = NULL;
         
-	struct Elf64_Ehdr *header = (struct Elf64_Ehdr *)alloc(sizeof(*header));
+	struct Elf64_Ehdr *header = NULL;
+        size_t have = 0;
+
+        if (meta->header != NULL && meta->header_size >= sizeof(*header)) {
+                // Already read by the dispatcher, ours from here on
+                header = (struct Elf64_Ehdr *)meta->header;
+                have = meta->header_size;
+                meta->header = NULL;
+        } else if ((header = (struct Elf64_Ehdr *)alloc(sizeof(*header))) != NULL) {
+                vfs_seek(file, 0, SEEK_SET);
+                vfs_read(header, 1, sizeof(*header), file);
+        }
+
 	if (header == NULL) {
 		ARC_DEBUG(ERR, "Failed to allocate header\n");
                 free(elf_meta);
 		return -2;
 	}
 
-	vfs_seek(file, 0, SEEK_SET);
-	vfs_read(header, 1, sizeof(*header), file);
-
         elf_meta->header = header;
         
-	if (header->e_ident[ELF_EI_CLASS] != ELF_CLASS_64) {
+	if (header->e_ident[ELF_EI_CLASS] != ELF_CLASS_64 || (header->e_type != ET_EXEC && header->e_type != ET_DYN)) {
 		free(header);
                 free(elf_meta);
 		return -3;
 	}
 
-	meta->entry = (void *)header->e_entry;
-
 	uint32_t header_count = header->e_phnum;
 	struct Elf64_Phdr *program_headers = (struct Elf64_Phdr *)alloc(sizeof(*program_headers) * header_count);
 
@@ -130,21 +219,29 @@ int init(ARC_ProgramMeta *meta, ARC_File *file) {
 		return -4;
 	}
 
-	vfs_seek(file, header->e_phoff, SEEK_SET);
-	vfs_read(program_headers, 1, sizeof(*program_headers) * header_count, file);
+        size_t phdrs_size = sizeof(*program_headers) * header_count;
+
+        if (header->e_phoff <= have && phdrs_size <= have - header->e_phoff) {
+                memcpy(program_headers, (uint8_t *)header + header->e_phoff, phdrs_size);
+        } else {
+                vfs_seek(file, header->e_phoff, SEEK_SET);
+                vfs_read(program_headers, 1, phdrs_size, file);
+        }
 
         elf_meta->phdrs.headers = program_headers;
         elf_meta->phdrs.count = header_count;
         elf_meta->phdrs.size = header->e_phentsize;
-        
-        ARC_DEBUG(INFO, "Entry address: 0x%"PRIx64"\n", header->e_entry);
 
-        return 0;
+        elf_meta->relocate_image = relocate;
+
+        return elf_init_image(meta, elf_meta, file) == 0 ? 0 : -5;
 }
 
 ARC_REGISTER_LOADER(ARC_LDRGRP_64BIT, elf) = {
         .init = init,
-        .uninit = uninit,
-        .load = load,
-        .unload = unload,
+        .uninit = elf_uninit,
+        .load = elf_load,
+        .unload = elf_unload,
+        .probe = probe,
+        .clone = elf_clone,
 };
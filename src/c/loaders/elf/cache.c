@@ -0,0 +1,259 @@
+/**
+ * @file cache.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#include "fs/vfs.h"
+#include "global.h"
+#include "lib/atomics.h"
+#include "lib/spinlock.h"
+#include "mm/allocator.h"
+#include "mm/pmm.h"
+#include "userspace/loaders/elf.h"
+
+#include <stdbool.h>
+
+// Bytes of unreferenced pages kept around for the next load
+#define ELF_CACHE_IDLE_LIMIT 0x800000
+
+struct elf_cache_entry {
+	struct elf_cache_entry *next;
+	// Holds a reference, so the node cannot be freed and its address
+	// reused for another file while the entry is around
+	ARC_VFSNode *node;
+	uintptr_t base;
+	uint64_t offset;
+	size_t size;
+	void *phys;
+	uint32_t refs;
+	// The file was written since, no longer found by elf_cache_get and
+	// freed with its last reference
+	bool stale;
+};
+
+static struct {
+	ARC_Spinlock lock;
+	// Most recently added first
+	struct elf_cache_entry *entries;
+	size_t idle;
+} cache = { 0 };
+
+int init_elf_cache(void) {
+	init_static_spinlock(&cache.lock);
+
+	return 0;
+}
+
+static struct elf_cache_entry *cache_find(void *node, uintptr_t base, uint64_t offset, size_t size) {
+	struct elf_cache_entry *entry = cache.entries;
+
+	while (entry != NULL) {
+		if (entry->node == node && !entry->stale && entry->base == base && entry->offset == offset && entry->size == size) {
+			return entry;
+		}
+
+		entry = entry->next;
+	}
+
+	return NULL;
+}
+
+static void cache_free(struct elf_cache_entry *entry) {
+	ARC_ATOMIC_DEC(entry->node->ref_count);
+	pmm_free(entry->phys);
+	free(entry);
+}
+
+// Called with the lock held, drops the oldest idle entries until under the limit
+static void cache_trim(void) {
+	while (cache.idle > ELF_CACHE_IDLE_LIMIT) {
+		struct elf_cache_entry **link = &cache.entries;
+		struct elf_cache_entry **oldest = NULL;
+
+		while (*link != NULL) {
+			if ((*link)->refs == 0) {
+				oldest = link;
+			}
+
+			link = &(*link)->next;
+		}
+
+		if (oldest == NULL) {
+			return;
+		}
+
+		struct elf_cache_entry *entry = *oldest;
+		*oldest = entry->next;
+		cache.idle -= entry->size;
+
+		cache_free(entry);
+	}
+}
+
+void *elf_cache_get(void *node, uintptr_t base, uint64_t offset, size_t size) {
+	if (node == NULL) {
+		return NULL;
+	}
+
+	spinlock_lock(&cache.lock);
+
+	struct elf_cache_entry *entry = cache_find(node, base, offset, size);
+	void *phys = NULL;
+
+	if (entry != NULL) {
+		if (entry->refs++ == 0) {
+			cache.idle -= entry->size;
+		}
+
+		phys = entry->phys;
+	}
+
+	spinlock_unlock(&cache.lock);
+
+	return phys;
+}
+
+int elf_cache_put(void *node, uintptr_t base, uint64_t offset, size_t size, void *phys) {
+	if (node == NULL || phys == NULL) {
+		return -1;
+	}
+
+	struct elf_cache_entry *entry = (struct elf_cache_entry *)alloc(sizeof(*entry));
+
+	if (entry == NULL) {
+		return -1;
+	}
+
+	entry->node = (ARC_VFSNode *)node;
+	entry->base = base;
+	entry->offset = offset;
+	entry->size = size;
+	entry->phys = phys;
+	entry->refs = 1;
+	entry->stale = false;
+
+	spinlock_lock(&cache.lock);
+
+	if (cache_find(node, base, offset, size) != NULL) {
+		// Lost a race with another load of the same file
+		spinlock_unlock(&cache.lock);
+		free(entry);
+		return -1;
+	}
+
+	ARC_ATOMIC_INC(entry->node->ref_count);
+
+	entry->next = cache.entries;
+	cache.entries = entry;
+
+	spinlock_unlock(&cache.lock);
+
+	return 0;
+}
+
+int elf_cache_ref(void *phys) {
+	spinlock_lock(&cache.lock);
+
+	struct elf_cache_entry *entry = cache.entries;
+
+	while (entry != NULL && entry->phys != phys) {
+		entry = entry->next;
+	}
+
+	if (entry == NULL) {
+		spinlock_unlock(&cache.lock);
+		return -1;
+	}
+
+	if (entry->refs++ == 0) {
+		cache.idle -= entry->size;
+	}
+
+	spinlock_unlock(&cache.lock);
+
+	return 0;
+}
+
+int elf_cache_release(void *phys) {
+	spinlock_lock(&cache.lock);
+
+	struct elf_cache_entry **link = &cache.entries;
+
+	while (*link != NULL && (*link)->phys != phys) {
+		link = &(*link)->next;
+	}
+
+	struct elf_cache_entry *entry = *link;
+
+	if (entry == NULL) {
+		spinlock_unlock(&cache.lock);
+		return -1;
+	}
+
+	if (--entry->refs == 0) {
+		if (entry->stale) {
+			*link = entry->next;
+			cache_free(entry);
+		} else {
+			cache.idle += entry->size;
+			cache_trim();
+		}
+	}
+
+	spinlock_unlock(&cache.lock);
+
+	return 0;
+}
+
+void elf_cache_invalidate(void *node) {
+	if (node == NULL) {
+		return;
+	}
+
+	spinlock_lock(&cache.lock);
+
+	struct elf_cache_entry **link = &cache.entries;
+
+	while (*link != NULL) {
+		struct elf_cache_entry *entry = *link;
+
+		if (entry->node != node) {
+			link = &entry->next;
+			continue;
+		}
+
+		if (entry->refs > 0) {
+			// Mapped somewhere, those keep the old contents
+			entry->stale = true;
+			link = &entry->next;
+			continue;
+		}
+
+		*link = entry->next;
+		cache.idle -= entry->size;
+		cache_free(entry);
+	}
+
+	spinlock_unlock(&cache.lock);
+}
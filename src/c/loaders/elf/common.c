@@ -0,0 +1,598 @@
+/**
+ * @file common.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#include "arch/pager.h"
+#include "config.h"
+#include "fs/vfs.h"
+#include "global.h"
+#include "lib/util.h"
+#include "mm/allocator.h"
+#include "mm/pmm.h"
+#include "userspace/loader.h"
+#include "userspace/loaders/elf.h"
+#include "abi-bits/seek-whence.h"
+
+#define INTERP_PATH_LIMIT 4096
+
+static int load_page(ARC_ProgramMeta *meta, void *virt) {
+        // TODO: Pager must be reworked for this
+        // void *a = NULL
+        // if ((a = pager_to_phys(page_tables, virt)) == NULL) {
+        //         a = pmm_alloc(PAGE_SIZE);
+        // }
+        // vfs_seek(file, offset to data in file, SEEK_SET);
+        // vfs_read(a + offset in page, 1, PAGE_SIZE - offset, file);
+        
+        return -1;
+}
+
+static uint32_t segment_flags(ARC_ProgramMeta *meta, struct Elf64_Phdr *header) {
+        uint32_t flags = meta->userspace << ARC_PAGER_US;
+
+        if (header->p_flags & PF_W) {
+                flags |= 1 << ARC_PAGER_RW;
+        }
+
+        if (!(header->p_flags & PF_X)) {
+                flags |= 1 << ARC_PAGER_NX;
+        }
+
+        return flags;
+}
+
+void *elf_segment_target(struct ARC_ELFMeta *elf_meta, uintptr_t virt, size_t size, bool *shared) {
+        for (uint32_t i = 0; i < elf_meta->segment_count; i++) {
+                struct ARC_ELFSegment *segment = &elf_meta->segments[i];
+
+                if (virt < segment->virt || virt + size > segment->virt + segment->size) {
+                        continue;
+                }
+
+                if (shared != NULL) {
+                        *shared = segment->shared;
+                }
+
+                return (uint8_t *)segment->phys + (virt - segment->virt);
+        }
+
+        return NULL;
+}
+
+static void release_segments(ARC_ProgramMeta *meta, struct ARC_ELFMeta *elf_meta) {
+        for (uint32_t i = 0; i < elf_meta->segment_count; i++) {
+                struct ARC_ELFSegment *segment = &elf_meta->segments[i];
+
+                if (meta->page_table != NULL) {
+                        pager_unmap(meta->page_table, segment->virt, segment->size, NULL);
+                }
+
+                if (elf_cache_release(segment->phys) != 0) {
+                        pmm_free(segment->phys);
+                }
+        }
+
+        elf_meta->segment_count = 0;
+        meta->size = 0;
+}
+
+static int load_segment(ARC_ProgramMeta *meta, struct ARC_ELFMeta *elf_meta, struct Elf64_Phdr *header) {
+        uintptr_t virt = elf_meta->base + header->p_vaddr;
+        uintptr_t start = virt & ~(PAGE_SIZE - 1);
+        size_t size = ALIGN(virt + header->p_memsz, PAGE_SIZE) - start;
+
+        // NOTE: Segments sharing a page would need to share the memory behind
+        //       it, which nothing here does
+        if (header->p_filesz > header->p_memsz || elf_segment_target(elf_meta, start, 1, NULL) != NULL
+            || elf_segment_target(elf_meta, start + size - 1, 1, NULL) != NULL) {
+                ARC_DEBUG(ERR, "Unsupported PT_LOAD at 0x%"PRIx64"\n", header->p_vaddr);
+                return -1;
+        }
+
+        struct ARC_ELFSegment *segment = &elf_meta->segments[elf_meta->segment_count];
+        void *phys = NULL;
+
+        if (!(header->p_flags & PF_W)) {
+                phys = elf_cache_get(elf_meta->node, elf_meta->base, header->p_offset, size);
+        }
+
+        segment->shared = phys != NULL;
+
+        if (phys == NULL) {
+                if ((phys = pmm_alloc(size)) == NULL) {
+                        ARC_DEBUG(ERR, "Failed to allocate memory for segment\n");
+                        return -2;
+                }
+
+                memset(phys, 0, size);
+                vfs_seek(elf_meta->file, header->p_offset, SEEK_SET);
+
+                if (vfs_read((uint8_t *)phys + (virt - start), 1, header->p_filesz, elf_meta->file) != (long)header->p_filesz) {
+                        ARC_DEBUG(ERR, "Failed to read segment\n");
+                        pmm_free(phys);
+                        return -3;
+                }
+        }
+
+        segment->virt = start;
+        segment->phys = phys;
+        segment->size = size;
+        segment->offset = header->p_offset;
+        segment->flags = segment_flags(meta, header);
+
+        if (pager_map(meta->page_table, start, ARC_HHDM_TO_PHYS(phys), size, segment->flags) != 0) {
+                ARC_DEBUG(ERR, "Failed to map segment\n");
+
+                if (elf_cache_release(phys) != 0) {
+                        pmm_free(phys);
+                }
+
+                return -4;
+        }
+
+        elf_meta->segment_count++;
+        meta->size += size;
+
+        return 0;
+}
+
+int elf_load(ARC_ProgramMeta *meta, void *virt, size_t size) {
+        struct ARC_ELFMeta *elf_meta = meta->loader_data;
+        
+        if (virt == NULL) {
+                ARC_DEBUG(INFO, "Loading full program from memory (base 0x%"PRIx64")\n", elf_meta->base);
+
+                struct Elf64_Phdr *dynamic = NULL;
+
+                for (uint32_t i = 0; i < elf_meta->phdrs.count; i++) {
+                        struct Elf64_Phdr *header = &elf_meta->phdrs.headers[i];
+                        
+                        ARC_DEBUG(INFO, "\tHeader %d 0x%"PRIx64":0x%"PRIx64" 0x%"PRIx64", 0x%"PRIx64":0x%"PRIx64" B\n", i, header->p_paddr, header->p_vaddr,
+                                  header->p_offset, header->p_memsz, header->p_filesz);
+                        
+                        switch (header->p_type) {
+                        case PT_LOAD: {
+                                if (header->p_memsz != 0 && load_segment(meta, elf_meta, header) != 0) {
+                                        release_segments(meta, elf_meta);
+                                        return -1;
+                                }
+
+                                break;
+                        }
+
+                        case PT_DYNAMIC: {
+                                dynamic = header;
+                                break;
+                        }
+                        }
+                }
+
+                if (dynamic != NULL && elf_meta->relocate && elf_meta->relocate_image(elf_meta, dynamic) != 0) {
+                        ARC_DEBUG(ERR, "Failed to relocate program\n");
+                        release_segments(meta, elf_meta);
+                        return -2;
+                }
+
+                // Now relocated, read-only segments can be handed to the next
+                // load of this file at this base
+                for (uint32_t i = 0; i < elf_meta->segment_count; i++) {
+                        struct ARC_ELFSegment *segment = &elf_meta->segments[i];
+
+                        if (segment->shared || (segment->flags & (1 << ARC_PAGER_RW))) {
+                                continue;
+                        }
+
+                        segment->shared = elf_cache_put(elf_meta->node, elf_meta->base, segment->offset, segment->size, segment->phys) == 0;
+                }
+
+                if (elf_meta->interp != NULL) {
+                        elf_meta->interp->page_table = meta->page_table;
+                        elf_meta->interp->userspace = meta->userspace;
+
+                        if (program_loader_load(elf_meta->interp, NULL, 0) != 0) {
+                                ARC_DEBUG(ERR, "Failed to load interpreter\n");
+                                release_segments(meta, elf_meta);
+                                return -3;
+                        }
+                }
+
+                return 0;
+        }
+
+        for (uint32_t i = 0; i < elf_meta->phdrs.count; i++) {
+                struct Elf64_Phdr *header = &elf_meta->phdrs.headers[i];
+                uintptr_t start = elf_meta->base + header->p_vaddr;
+
+                if (start <= (uintptr_t)virt && (uintptr_t)virt <= start + header->p_memsz) {
+                        return load_page(meta, virt);
+                }
+        }
+        
+        return -1;
+}
+
+int elf_unload(ARC_ProgramMeta *meta, void *virt, size_t size) {
+        if (virt == NULL) {
+                ARC_DEBUG(INFO, "Unloading full program from memory\n");
+                struct ARC_ELFMeta *elf_meta = meta->loader_data;
+                release_segments(meta, elf_meta);
+
+                if (elf_meta->interp != NULL) {
+                        program_loader_unload(elf_meta->interp, NULL, 0);
+                }
+
+                return 0;
+        }
+
+        return -1;
+}
+
+int elf_uninit(ARC_ProgramMeta *meta) {
+        struct ARC_ELFMeta *elf_meta = meta->loader_data;
+
+        if (elf_meta == NULL) {
+                return -1;
+        }
+
+        release_segments(meta, elf_meta);
+
+        if (elf_meta->interp != NULL) {
+                ARC_File *file = ((struct ARC_ELFMeta *)elf_meta->interp->loader_data)->file;
+                uninit_program_loader(elf_meta->interp);
+
+                // Clones do not have the file open
+                if (file != NULL) {
+                        vfs_close(file);
+                }
+        }
+
+        if (elf_meta->tls.image != NULL) {
+                free(elf_meta->tls.image);
+        }
+
+        if (elf_meta->segments != NULL) {
+                free(elf_meta->segments);
+        }
+
+        free(elf_meta->phdrs.headers);
+        free(elf_meta->header);
+        free(elf_meta);
+
+        meta->loader_data = NULL;
+        meta->tls = NULL;
+
+        return 0;
+}
+
+static int clone_segment(ARC_ProgramMeta *copy, struct ARC_ELFMeta *elf_copy, struct ARC_ELFSegment *segment) {
+        struct ARC_ELFSegment *target = &elf_copy->segments[elf_copy->segment_count];
+        void *phys = NULL;
+
+        *target = *segment;
+
+        if (segment->shared && elf_cache_ref(segment->phys) == 0) {
+                phys = segment->phys;
+        } else if ((phys = pmm_alloc(segment->size)) != NULL) {
+                // Writable, or never made it into the cache, so it is
+                // private to each image
+                memcpy(phys, segment->phys, segment->size);
+                target->shared = false;
+        } else {
+                ARC_DEBUG(ERR, "Failed to allocate memory for segment copy\n");
+                return -1;
+        }
+
+        target->phys = phys;
+
+        if (copy->page_table != NULL && pager_map(copy->page_table, target->virt, ARC_HHDM_TO_PHYS(phys), target->size, target->flags) != 0) {
+                ARC_DEBUG(ERR, "Failed to map segment copy\n");
+
+                if (elf_cache_release(phys) != 0) {
+                        pmm_free(phys);
+                }
+
+                return -2;
+        }
+
+        elf_copy->segment_count++;
+        copy->size += target->size;
+
+        return 0;
+}
+
+int elf_clone(ARC_ProgramMeta *meta, ARC_ProgramMeta *copy) {
+        struct ARC_ELFMeta *elf_meta = meta->loader_data;
+        struct ARC_ELFMeta *elf_copy = (struct ARC_ELFMeta *)alloc(sizeof(*elf_copy));
+
+        if (elf_meta == NULL || elf_copy == NULL) {
+                free(elf_copy);
+                return -1;
+        }
+
+        memcpy(elf_copy, elf_meta, sizeof(*elf_copy));
+        elf_copy->file = NULL;
+        elf_copy->interp = NULL;
+        elf_copy->segment_count = 0;
+        elf_copy->tls.image = NULL;
+
+        copy->loader_data = elf_copy;
+        copy->size = 0;
+        copy->tls = NULL;
+
+        elf_copy->header = (struct Elf64_Ehdr *)alloc(sizeof(*elf_copy->header));
+        elf_copy->phdrs.headers = (struct Elf64_Phdr *)alloc(sizeof(*elf_copy->phdrs.headers) * elf_meta->phdrs.count);
+        elf_copy->segments = (struct ARC_ELFSegment *)alloc(sizeof(*elf_copy->segments) * elf_meta->phdrs.count);
+
+        if (elf_copy->header == NULL || elf_copy->phdrs.headers == NULL || elf_copy->segments == NULL) {
+                goto fail;
+        }
+
+        memcpy(elf_copy->header, elf_meta->header, sizeof(*elf_copy->header));
+        memcpy(elf_copy->phdrs.headers, elf_meta->phdrs.headers, sizeof(*elf_copy->phdrs.headers) * elf_meta->phdrs.count);
+
+        if (meta->tls != NULL) {
+                if ((elf_copy->tls.image = alloc(elf_meta->tls.file_size == 0 ? 1 : elf_meta->tls.file_size)) == NULL) {
+                        goto fail;
+                }
+
+                memcpy(elf_copy->tls.image, elf_meta->tls.image, elf_meta->tls.file_size);
+                copy->tls = &elf_copy->tls;
+        }
+
+        for (uint32_t i = 0; i < elf_meta->segment_count; i++) {
+                if (clone_segment(copy, elf_copy, &elf_meta->segments[i]) != 0) {
+                        goto fail;
+                }
+        }
+
+        if (elf_meta->interp != NULL && (elf_copy->interp = program_loader_clone(elf_meta->interp, copy->page_table)) == NULL) {
+                ARC_DEBUG(ERR, "Failed to clone interpreter\n");
+                goto fail;
+        }
+
+        return 0;
+
+        fail:;
+        // Frees whatever made it this far
+        elf_uninit(copy);
+
+        return -2;
+}
+
+static int init_tls(ARC_ProgramMeta *meta, struct ARC_ELFMeta *elf_meta, ARC_File *file) {
+        meta->tls = NULL;
+
+        for (uint32_t i = 0; i < elf_meta->phdrs.count; i++) {
+                struct Elf64_Phdr *header = &elf_meta->phdrs.headers[i];
+
+                if (header->p_type != PT_TLS) {
+                        continue;
+                }
+
+                size_t align = header->p_align == 0 ? 1 : header->p_align;
+
+                // The block sits between the stack and TCB of each thread, so
+                // it cannot ask for more than page alignment
+                if (header->p_filesz > header->p_memsz || align > PAGE_SIZE || (align & (align - 1)) != 0) {
+                        ARC_DEBUG(ERR, "Unsupported PT_TLS (0x%"PRIx64" 0x%"PRIx64" 0x%"PRIx64")\n", header->p_filesz, header->p_memsz, header->p_align);
+                        return -1;
+                }
+
+                // Keep the image even if it is all zeroes, so the size is known
+                void *image = alloc(header->p_filesz == 0 ? 1 : header->p_filesz);
+
+                if (image == NULL) {
+                        ARC_DEBUG(ERR, "Failed to allocate TLS image\n");
+                        return -1;
+                }
+
+                vfs_seek(file, header->p_offset, SEEK_SET);
+
+                if (vfs_read(image, 1, header->p_filesz, file) != (long)header->p_filesz) {
+                        ARC_DEBUG(ERR, "Failed to read TLS image\n");
+                        free(image);
+                        return -1;
+                }
+
+                elf_meta->tls.image = image;
+                elf_meta->tls.file_size = header->p_filesz;
+                elf_meta->tls.mem_size = header->p_memsz;
+                elf_meta->tls.align = align;
+                meta->tls = &elf_meta->tls;
+
+                ARC_DEBUG(INFO, "TLS image: 0x%"PRIx64" B, 0x%"PRIx64" B in memory\n", header->p_filesz, header->p_memsz);
+
+                break;
+        }
+
+        return 0;
+}
+
+static void init_aux(ARC_ProgramMeta *meta, struct ARC_ELFMeta *elf_meta) {
+        struct Elf64_Ehdr *header = elf_meta->header;
+
+        meta->aux.phent = header->e_phentsize;
+        meta->aux.phnum = header->e_phnum;
+        meta->aux.entry = elf_meta->base + header->e_entry;
+        meta->aux.phdr = 0;
+
+        for (uint32_t i = 0; i < elf_meta->phdrs.count; i++) {
+                struct Elf64_Phdr *phdr = &elf_meta->phdrs.headers[i];
+
+                if (phdr->p_type == PT_PHDR) {
+                        meta->aux.phdr = elf_meta->base + phdr->p_vaddr;
+                        return;
+                }
+
+                // Without PT_PHDR, the headers may still be part of a segment
+                if (phdr->p_type == PT_LOAD && meta->aux.phdr == 0 && phdr->p_offset <= header->e_phoff
+                    && header->e_phoff < phdr->p_offset + phdr->p_filesz) {
+                        meta->aux.phdr = elf_meta->base + phdr->p_vaddr + (header->e_phoff - phdr->p_offset);
+                }
+        }
+}
+
+// Whether every PT_LOAD of the image, at its base, ends at or below limit
+static bool segments_below(struct ARC_ELFMeta *elf_meta, uintptr_t limit) {
+        for (uint32_t i = 0; i < elf_meta->phdrs.count; i++) {
+                struct Elf64_Phdr *header = &elf_meta->phdrs.headers[i];
+
+                if (header->p_type != PT_LOAD) {
+                        continue;
+                }
+
+                uintptr_t start = elf_meta->base + header->p_vaddr;
+
+                if (start < elf_meta->base || start > limit || header->p_memsz > limit - start) {
+                        return false;
+                }
+        }
+
+        return true;
+}
+
+static int init_interp(ARC_ProgramMeta *meta, struct ARC_ELFMeta *elf_meta, ARC_File *file) {
+        struct Elf64_Phdr *interp = NULL;
+
+        for (uint32_t i = 0; i < elf_meta->phdrs.count && interp == NULL; i++) {
+                if (elf_meta->phdrs.headers[i].p_type == PT_INTERP) {
+                        interp = &elf_meta->phdrs.headers[i];
+                }
+        }
+
+        if (interp == NULL) {
+                return 0;
+        }
+
+        if (interp->p_filesz == 0 || interp->p_filesz > INTERP_PATH_LIMIT) {
+                ARC_DEBUG(ERR, "Bad PT_INTERP\n");
+                return -1;
+        }
+
+        char *path = (char *)alloc(interp->p_filesz + 1);
+
+        if (path == NULL) {
+                return -1;
+        }
+
+        vfs_seek(file, interp->p_offset, SEEK_SET);
+
+        if (vfs_read(path, 1, interp->p_filesz, file) != (long)interp->p_filesz) {
+                free(path);
+                return -1;
+        }
+
+        path[interp->p_filesz] = 0;
+
+        ARC_File *interp_file = NULL;
+
+        if (vfs_open(path, 0, ARC_STD_PERM, &interp_file) != 0) {
+                ARC_DEBUG(ERR, "Failed to open interpreter %s\n", path);
+                free(path);
+                return -1;
+        }
+
+        ARC_DEBUG(INFO, "Interpreter: %s\n", path);
+        free(path);
+
+        ARC_ProgramMeta *interp_meta = init_program_loader_probe(interp_file, meta->page_table);
+
+        if (interp_meta == NULL) {
+                vfs_close(interp_file);
+                return -1;
+        }
+
+        struct ARC_ELFMeta *interp_elf = interp_meta->loader_data;
+
+        if (interp_meta->loader != meta->loader || interp_elf->interp != NULL || interp_elf->header->e_type != ET_DYN) {
+                ARC_DEBUG(ERR, "Interpreter is not a position independent, standalone image\n");
+                uninit_program_loader(interp_meta);
+                vfs_close(interp_file);
+                return -1;
+        }
+
+        // Nothing is loaded yet, so the interpreter can still be moved out
+        // of the program's way
+        interp_elf->base = meta->address_limit != 0 ? ARC_ELF_INTERP_BASE_32 : ARC_ELF_INTERP_BASE;
+        interp_elf->relocate = false;
+
+        // Its own loader checked it at ARC_ELF_DYN_BASE, not here
+        if (meta->address_limit != 0 && !segments_below(interp_elf, meta->address_limit)) {
+                ARC_DEBUG(ERR, "Interpreter does not fit below the program's address limit\n");
+                uninit_program_loader(interp_meta);
+                vfs_close(interp_file);
+                return -1;
+        }
+
+        interp_meta->entry = (void *)(interp_elf->base + interp_elf->header->e_entry);
+
+        elf_meta->interp = interp_meta;
+        elf_meta->relocate = false;
+        meta->aux.base = interp_elf->base;
+        meta->entry = interp_meta->entry;
+
+        return 0;
+}
+
+int elf_init_image(ARC_ProgramMeta *meta, struct ARC_ELFMeta *elf_meta, ARC_File *file) {
+        struct Elf64_Ehdr *header = elf_meta->header;
+
+        // NOTE: A fixed base keeps the relocated pages the same from one
+        //       launch to the next, so they can be cached
+        elf_meta->base = header->e_type == ET_DYN ? ARC_ELF_DYN_BASE : 0;
+        elf_meta->node = file->node;
+        elf_meta->file = file;
+        elf_meta->relocate = true;
+
+	meta->entry = (void *)(elf_meta->base + header->e_entry);
+        meta->size = 0;
+        meta->tls = NULL;
+
+        elf_meta->segments = (struct ARC_ELFSegment *)alloc(sizeof(*elf_meta->segments) * elf_meta->phdrs.count);
+
+        if (elf_meta->segments == NULL) {
+                ARC_DEBUG(ERR, "Failed to allocate segments\n");
+                elf_uninit(meta);
+                return -1;
+        }
+
+        if (init_tls(meta, elf_meta, file) != 0) {
+                elf_uninit(meta);
+                return -2;
+        }
+
+        init_aux(meta, elf_meta);
+        meta->aux.base = 0;
+
+        if (init_interp(meta, elf_meta, file) != 0) {
+                ARC_DEBUG(ERR, "Failed to set up interpreter\n");
+                elf_uninit(meta);
+                return -3;
+        }
+
+        ARC_DEBUG(INFO, "Entry address: %p\n", meta->entry);
+
+        return 0;
+}
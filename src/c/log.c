@@ -0,0 +1,271 @@
+/**
+ * @file log.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#include "global.h"
+#include "interface/terminal.h"
+#include "lib/atomics.h"
+#include "lib/spinlock.h"
+#include "lib/util.h"
+#include "arch/smp.h"
+#include "mm/allocator.h"
+#include "userspace/log.h"
+#include "userspace/percpu.h"
+#include "userspace/thread.h"
+#include "userspace/usercopy.h"
+
+#define RECORD_DATA_SIZE (ARC_LOG_RECORD_SIZE - sizeof(uint64_t) - sizeof(uint32_t))
+#define CONSUMER_STACKSIZE 0x4000
+
+struct log_record {
+	// Position + 1 of the record once it has been published
+	uint64_t seq;
+	uint32_t size;
+	char data[RECORD_DATA_SIZE];
+};
+STATIC_ASSERT(sizeof(struct log_record) == ARC_LOG_RECORD_SIZE, "Log record is not packed as expected");
+
+struct log_ring {
+	uint64_t head;
+	uint64_t tail;
+	struct log_record records[ARC_LOG_RING_RECORDS];
+};
+
+static struct log_ring rings[ARC_USERSPACE_CPU_SLOTS] = { 0 };
+static uint64_t dropped = 0;
+
+static struct {
+	char data[ARC_LOG_HISTORY_SIZE];
+	// Total number of bytes ever appended
+	uint64_t position;
+	ARC_Spinlock lock;
+} history = { 0 };
+
+static ARC_Thread *consumer = NULL;
+// Set by the consumer before it parks, whoever clears it wakes the consumer
+static uint32_t consumer_sleeping = 0;
+
+static int log_push(struct log_ring *ring, const char *data, uint32_t size) {
+	uint64_t pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+
+	do {
+		if (pos - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >= ARC_LOG_RING_RECORDS) {
+			ARC_ATOMIC_INC(dropped);
+			return -1;
+		}
+	} while (!__atomic_compare_exchange_n(&ring->head, &pos, pos + 1, true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+	struct log_record *record = &ring->records[pos % ARC_LOG_RING_RECORDS];
+	memcpy(record->data, data, size);
+	record->size = size;
+	__atomic_store_n(&record->seq, pos + 1, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+int log_write(const char *data, size_t size) {
+	if (data == NULL) {
+		return -1;
+	}
+
+	struct log_ring *ring = &rings[percpu_slot()];
+	int ret = 0;
+
+	while (size > 0) {
+		uint32_t part = size > RECORD_DATA_SIZE ? RECORD_DATA_SIZE : size;
+
+		if (log_push(ring, data, part) != 0) {
+			ret = -1;
+		}
+
+		data += part;
+		size -= part;
+	}
+
+	ARC_Thread *thread = __atomic_load_n(&consumer, __ATOMIC_ACQUIRE);
+
+	if (thread != NULL && __atomic_exchange_n(&consumer_sleeping, 0, __ATOMIC_ACQ_REL)) {
+		thread_unpark(thread);
+	}
+
+	return ret;
+}
+
+static bool log_pending(void) {
+	for (int i = 0; i < ARC_USERSPACE_CPU_SLOTS; i++) {
+		if (__atomic_load_n(&rings[i].tail, __ATOMIC_RELAXED) != __atomic_load_n(&rings[i].head, __ATOMIC_ACQUIRE)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void history_append(const char *data, size_t size) {
+	size_t offset = history.position % ARC_LOG_HISTORY_SIZE;
+	size_t first = ARC_LOG_HISTORY_SIZE - offset;
+
+	if (first > size) {
+		first = size;
+	}
+
+	memcpy(&history.data[offset], data, first);
+	memcpy(history.data, data + first, size - first);
+	history.position += size;
+}
+
+size_t log_drain(void) {
+	size_t count = 0;
+
+	for (int i = 0; i < ARC_USERSPACE_CPU_SLOTS; i++) {
+		struct log_ring *ring = &rings[i];
+		uint64_t tail = ring->tail;
+
+		while (tail != __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)) {
+			struct log_record *record = &ring->records[tail % ARC_LOG_RING_RECORDS];
+
+			if (__atomic_load_n(&record->seq, __ATOMIC_ACQUIRE) != tail + 1) {
+				// Reserved but not yet written
+				break;
+			}
+
+			printf("%.*s", (int)record->size, record->data);
+
+			spinlock_lock(&history.lock);
+			history_append(record->data, record->size);
+			spinlock_unlock(&history.lock);
+
+			tail++;
+			__atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+			count++;
+		}
+	}
+
+	return count;
+}
+
+long log_read_user(uint64_t *cursor, void *buffer, size_t count) {
+	uint64_t from = 0;
+
+	if (!user_access_ok(buffer, count) || copy_from_user(&from, cursor, sizeof(from)) != 0) {
+		return -1;
+	}
+
+	if (count > ARC_LOG_HISTORY_SIZE) {
+		count = ARC_LOG_HISTORY_SIZE;
+	}
+
+	// The user buffer may fault, which must not happen with the history
+	// locked
+	char *bounce = (char *)alloc(count > 0 ? count : 1);
+
+	if (bounce == NULL) {
+		return -1;
+	}
+
+	spinlock_lock(&history.lock);
+
+	uint64_t oldest = history.position > ARC_LOG_HISTORY_SIZE ? history.position - ARC_LOG_HISTORY_SIZE : 0;
+
+	if (from < oldest || from > history.position) {
+		from = oldest;
+	}
+
+	size_t size = history.position - from;
+	if (size > count) {
+		size = count;
+	}
+
+	size_t offset = from % ARC_LOG_HISTORY_SIZE;
+	size_t first = ARC_LOG_HISTORY_SIZE - offset;
+
+	if (first > size) {
+		first = size;
+	}
+
+	memcpy(bounce, &history.data[offset], first);
+	memcpy(bounce + first, history.data, size - first);
+
+	spinlock_unlock(&history.lock);
+
+	int err = copy_to_user(buffer, bounce, size);
+	free(bounce);
+
+	if (err != 0) {
+		return -1;
+	}
+
+	from += size;
+	copy_to_user(cursor, &from, sizeof(from));
+
+	return size;
+}
+
+uint64_t log_get_dropped(void) {
+	return __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+}
+
+static void log_consumer(void) {
+	ARC_Thread *self = smp_get_proc_desc()->thread;
+
+	while (1) {
+		if (log_drain() > 0) {
+			term_draw();
+		}
+
+		thread_prepare_park(self);
+		__atomic_store_n(&consumer_sleeping, 1, __ATOMIC_SEQ_CST);
+
+		// A record pushed before the flag was set would not wake us
+		if (log_pending() && __atomic_exchange_n(&consumer_sleeping, 0, __ATOMIC_ACQ_REL)) {
+			thread_unpark(self);
+		}
+
+		thread_park(self);
+	}
+}
+
+ARC_Process *init_log_consumer(void) {
+	init_static_spinlock(&history.lock);
+
+	ARC_Process *process = process_create(false, NULL);
+
+	if (process == NULL) {
+		ARC_DEBUG(ERR, "Failed to create log consumer process\n");
+		return NULL;
+	}
+
+	ARC_Thread *thread = thread_create(process, (void *)log_consumer, CONSUMER_STACKSIZE);
+
+	if (thread == NULL) {
+		ARC_DEBUG(ERR, "Failed to create log consumer thread\n");
+		process_delete(process);
+		return NULL;
+	}
+
+	__atomic_store_n(&consumer, thread, __ATOMIC_RELEASE);
+
+	return process;
+}
@@ -0,0 +1,112 @@
+/**
+ * @file percpu.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#include "arch/smp.h"
+#include "userspace/percpu.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+static ARC_ProcessorDescriptor *descs[ARC_USERSPACE_CPU_SLOTS] = { 0 };
+// APIC id + 1, 0 until the owner of the slot has written it
+static uint64_t cpu_ids[ARC_USERSPACE_CPU_SLOTS] = { 0 };
+static uint64_t online = 0;
+
+static inline void cpuid(uint32_t leaf, uint32_t sub, uint32_t *a, uint32_t *b, uint32_t *c, uint32_t *d) {
+	__asm__ volatile("cpuid" : "=a"(*a), "=b"(*b), "=c"(*c), "=d"(*d) : "a"(leaf), "c"(sub));
+}
+
+static uint32_t read_cpu_id(void) {
+	uint32_t a, b, c, d;
+
+	cpuid(0, 0, &a, &b, &c, &d);
+
+	if (a >= 0xB) {
+		cpuid(0xB, 0, &a, &b, &c, &d);
+
+		// Only valid if it reports a level, the x2APIC id is in EDX
+		if ((b & 0xFFFF) != 0) {
+			return d;
+		}
+	}
+
+	cpuid(1, 0, &a, &b, &c, &d);
+
+	return b >> 24;
+}
+
+uint32_t percpu_register(void) {
+	ARC_ProcessorDescriptor *desc = smp_get_proc_desc();
+
+	for (uint32_t i = 0; i < ARC_USERSPACE_CPU_SLOTS; i++) {
+		ARC_ProcessorDescriptor *expected = NULL;
+
+		if (__atomic_compare_exchange_n(&descs[i], &expected, desc, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+			__atomic_store_n(&cpu_ids[i], (uint64_t)read_cpu_id() + 1, __ATOMIC_RELEASE);
+			__atomic_or_fetch(&online, 1ULL << i, __ATOMIC_ACQ_REL);
+			return i;
+		}
+
+		if (expected == desc) {
+			return i;
+		}
+	}
+
+	// More processors than slots, share one
+	return ((uintptr_t)desc / sizeof(ARC_ProcessorDescriptor)) % ARC_USERSPACE_CPU_SLOTS;
+}
+
+uint32_t percpu_slot(void) {
+	ARC_ProcessorDescriptor *desc = smp_get_proc_desc();
+
+	for (uint32_t i = 0; i < ARC_USERSPACE_CPU_SLOTS; i++) {
+		ARC_ProcessorDescriptor *owner = __atomic_load_n(&descs[i], __ATOMIC_ACQUIRE);
+
+		if (owner == desc) {
+			return i;
+		}
+
+		if (owner == NULL) {
+			break;
+		}
+	}
+
+	return percpu_register();
+}
+
+int64_t percpu_cpu_id(uint32_t slot) {
+	if (slot >= ARC_USERSPACE_CPU_SLOTS) {
+		return -1;
+	}
+
+	uint64_t id = __atomic_load_n(&cpu_ids[slot], __ATOMIC_ACQUIRE);
+
+	return id == 0 ? -1 : (int64_t)(id - 1);
+}
+
+uint64_t percpu_online_mask(void) {
+	return __atomic_load_n(&online, __ATOMIC_ACQUIRE);
+}
@@ -24,6 +24,7 @@
  *
  * @DESCRIPTION
 */
+#include "abi-bits/seek-whence.h"
 #include "arch/convention.h"
 #include "arch/pager.h"
 #include "arch/smp.h"
@@ -33,11 +34,19 @@
 #include "lib/atomics.h"
 #include "lib/util.h"
 #include "mm/allocator.h"
+#include "mm/pmm.h"
 #include "mm/vmm.h"
-#include "userspace/loader_defs.h"
+#include "userspace/affinity.h"
+#include "userspace/epoll.h"
+#include "userspace/ipc.h"
+#include "userspace/ksm.h"
+#include "userspace/reaper.h"
+#include "userspace/spawn_stats.h"
+#include "userspace/template.h"
 #include "userspace/thread.h"
 #include "userspace/process.h"
 #include "userspace/loader.h"
+#include "userspace/loaders/elf.h"
 
 #define DEFAULT_MEMSIZE 0x1000 * 4096
 #define DEFAULT_STACKSIZE 0x4000
@@ -46,6 +55,7 @@ static uint64_t pid_counter = 0;
 
 // Expected that process->base will be set by the caller
 struct ARC_Process *process_create(bool userspace, void *page_tables) {
+	uint64_t start = spawn_stats_start();
 	struct ARC_Process *process = (struct ARC_Process *)alloc(sizeof(*process));
 
 	if (process == NULL) {
@@ -54,6 +64,8 @@ struct ARC_Process *process_create(bool userspace, void *page_tables) {
 	}
 
 	memset(process, 0, sizeof(*process));
+	init_static_spinlock(&process->lock);
+	process->affinity = ARC_AFFINITY_ALL;
 
 	if (!userspace) {
 		// Not a userspace process
@@ -96,6 +108,10 @@ struct ARC_Process *process_create(bool userspace, void *page_tables) {
 
 		process->page_tables.user = user;
 		process->page_tables.kernel = kernel;
+
+		// Only the roots, the tables below them are charged along with
+		// each mapping
+		process_charge(process, ARC_PROCESS_MEM_PAGE_TABLES, 2 * PAGE_SIZE);
 	}
 
 	void *base = (void *)0x10000000000; // TODO: Figure this out somehow
@@ -112,6 +128,8 @@ struct ARC_Process *process_create(bool userspace, void *page_tables) {
 	process->pid = ARC_ATOMIC_INC(pid_counter);
 	process->userspace = userspace;
 
+	spawn_stats_record(ARC_SPAWN_PROCESS_CREATE, start);
+
 	return process;
 }
 
@@ -121,6 +139,8 @@ struct ARC_Process *process_create_from_file(bool userspace, char *filepath) {
 		return NULL;
 	}
 
+	uint64_t start = spawn_stats_start();
+
 	ARC_File *file = NULL;
 
 	if (vfs_open(filepath, 0, ARC_STD_PERM, &file) != 0) {
@@ -132,37 +152,84 @@ struct ARC_Process *process_create_from_file(bool userspace, char *filepath) {
 
 	if (process == NULL) {
 		ARC_DEBUG(ERR, "Failed to allocate process\n");
+		vfs_close(file);
 		return NULL;
 	}
 
         void *page_table = userspace ? process->page_tables.user : process->page_tables.kernel;
-        ARC_ProgramMeta *meta = init_program_loader(ARC_LDRGRP_64BIT, ARC_LOADER_64BIT_ELF,
-                                                    file, page_table);
+        uint64_t step = spawn_stats_start();
+        ARC_ProgramMeta *meta = init_program_loader_probe(file, page_table);
+        spawn_stats_record(ARC_SPAWN_LOADER_INIT, step);
 
         if (meta == NULL) {
                 ARC_DEBUG(ERR, "Failed to initialize program loader\n");
-                return NULL;
+                goto fail;
+        }
+
+        meta->userspace = userspace;
+
+        if (meta->address_limit != 0) {
+                if (ARC_ELF_LOW_ARENA + ARC_ELF_LOW_ARENA_SIZE > meta->address_limit) {
+                        ARC_DEBUG(ERR, "Program address limit is too low\n");
+                        uninit_program_loader(meta);
+                        goto fail;
+                }
+
+                // Stacks, TLS and mappings all come from here, so they must
+                // stay below the limit too
+                ARC_VMMMeta *vmm = init_vmm((void *)ARC_ELF_LOW_ARENA, ARC_ELF_LOW_ARENA_SIZE);
+
+                if (vmm == NULL) {
+                        ARC_DEBUG(ERR, "Failed to create bounded process allocator\n");
+                        uninit_program_loader(meta);
+                        goto fail;
+                }
+
+                uninit_vmm(process->allocator);
+                process->allocator = vmm;
         }
 
+        step = spawn_stats_start();
+
         if (program_loader_load(meta, NULL, 0) != 0) {
                 ARC_DEBUG(ERR, "Failed to load program\n");
                 uninit_program_loader(meta);
-                return NULL;
+                goto fail;
         }
 
+	spawn_stats_record(ARC_SPAWN_LOADER_LOAD, step);
+	// No limits are set yet, so this cannot fail
+	process_charge_mapping(process, meta->size, true);
+	process->program = meta;
+
 	struct ARC_Thread *main = thread_create(process, meta->entry, DEFAULT_STACKSIZE);
 	if (main == NULL) {
-		process_delete(process);
+		// The program goes with the process
 		ARC_DEBUG(ERR, "Failed to create main thread\n");
-		return NULL;
+		goto fail;
 	}
 
 	char *argv[] = {"hello", "world"};
-	conv_prepare_entry_stack(main, meta, NULL, 0, argv, 2);
+	step = spawn_stats_start();
+	if (meta->address_limit != 0) {
+		// x32, every word on the stack is 32 bits wide
+		thread_prepare_entry_stack_32(main, meta, NULL, 0, argv, 2);
+	} else {
+		conv_prepare_entry_stack(main, meta, NULL, 0, argv, 2);
+	}
+	spawn_stats_record(ARC_SPAWN_ENTRY_STACK, step);
 
 	ARC_DEBUG(INFO, "Created process from file %s\n", filepath);
+	spawn_stats_record(ARC_SPAWN_FROM_FILE, start);
 
 	return process;
+
+	fail:;
+	// No loader keeps the program's own file open
+	process_delete(process);
+	vfs_close(file);
+
+	return NULL;
 }
 
 int process_associate_thread(struct ARC_Process *process, struct ARC_Thread *thread) {
@@ -172,9 +239,28 @@ int process_associate_thread(struct ARC_Process *process, struct ARC_Thread *thr
 	}
 
 	ARC_ThreadElement *elem = alloc(sizeof(*elem));
+
+	if (elem == NULL) {
+		ARC_DEBUG(ERR, "Failed to allocate thread element\n");
+		return -2;
+	}
+
 	elem->t = thread;
 	thread->parent = process;
-	ARC_ATOMIC_XCHG(&process->threads, &elem, &elem->next);
+
+	spinlock_lock(&process->lock);
+
+	if (process->dead) {
+		// process_delete has already stopped the threads it had
+		spinlock_unlock(&process->lock);
+		free(elem);
+
+		return -3;
+	}
+
+	elem->next = process->threads;
+	process->threads = elem;
+	spinlock_unlock(&process->lock);
 
 	return 0;
 }
@@ -185,20 +271,25 @@ int process_disassociate_thread(struct ARC_Process *process, struct ARC_Thread *
 		return -1;
 	}
 
-	ARC_ThreadElement *current = process->threads;
-	ARC_ThreadElement *prev = NULL;
-	while (current != NULL && current->t != thread) {
-		prev = current;
-		current = current->next;
+	spinlock_lock(&process->lock);
+
+	ARC_ThreadElement **link = &process->threads;
+	while (*link != NULL && (*link)->t != thread) {
+		link = &(*link)->next;
 	}
 
+	ARC_ThreadElement *current = *link;
+
 	if (current == NULL) {
+		spinlock_unlock(&process->lock);
 		ARC_DEBUG(ERR, "Could not find thread\n");
 		return -2;
 	}
 
-	ARC_ThreadElement *temp = NULL;
-	ARC_ATOMIC_XCHG(&prev->next, &current->next, &temp);
+	*link = current->next;
+	thread->parent = NULL;
+
+	spinlock_unlock(&process->lock);
 
 	free(current);
 
@@ -222,15 +313,750 @@ int process_delete(struct ARC_Process *process) {
 		return -1;
 	}
 
+	uint32_t was_dead = __atomic_exchange_n(&process->dead, 1, __ATOMIC_ACQ_REL);
+
+	if (was_dead) {
+		return 0;
+	}
+
+	// Take the threads off the processors first, those in the kernel
+	// back out of their waits and halt on the way to userspace
+	spinlock_lock(&process->lock);
+	for (ARC_ThreadElement *elem = process->threads; elem != NULL; elem = elem->next) {
+		thread_stop(elem->t);
+	}
+	spinlock_unlock(&process->lock);
+
+	// Everything else happens once no processor can still be running
+	// one of its threads
+	return reaper_defer_process(process);
+}
+
+static void mem_add(ARC_Process *process, int type, int64_t size) {
+	__atomic_add_fetch(&process->memory.counters[type], size, __ATOMIC_RELAXED);
+
+	if (type != ARC_PROCESS_MEM_FILES) {
+		__atomic_add_fetch(&process->memory.total, size, __ATOMIC_RELAXED);
+	}
+}
+
+int process_charge(struct ARC_Process *process, int type, size_t size) {
+	if (process == NULL || type < 0 || type >= ARC_PROCESS_MEM_TYPES) {
+		return -1;
+	}
+
+	if (type == ARC_PROCESS_MEM_FILES) {
+		mem_add(process, type, size);
+		return 0;
+	}
+
+	uint64_t total = __atomic_add_fetch(&process->memory.total, size, __ATOMIC_RELAXED);
+	uint64_t hard = process->memory.hard_limit;
+	uint64_t soft = process->memory.soft_limit;
+
+	if (hard != 0 && total > hard) {
+		__atomic_sub_fetch(&process->memory.total, size, __ATOMIC_RELAXED);
+		return -1;
+	}
+
+	if (soft != 0 && total > soft && total - size <= soft) {
+		ARC_DEBUG(WARN, "Process %lu went over its soft memory limit (%lu > %lu)\n", process->pid, total, soft);
+	}
+
+	__atomic_add_fetch(&process->memory.counters[type], size, __ATOMIC_RELAXED);
+
 	return 0;
 }
 
-int process_swap_out(ARC_Process *process) {
-	ARC_DEBUG(WARN, "Definitely swapping out process %p\n", process);
+void process_uncharge(struct ARC_Process *process, int type, size_t size) {
+	if (process == NULL || type < 0 || type >= ARC_PROCESS_MEM_TYPES) {
+		return;
+	}
+
+	mem_add(process, type, -(int64_t)size);
+}
+
+// NOTE: The pager does not report the tables it allocates, so this assumes a
+//       page table for every 2MiB spanned plus one for the levels above, in
+//       both the user and kernel tables
+static size_t page_table_cost(size_t size) {
+	return ((ALIGN(size, 0x200000) / 0x200000) + 1) * 2 * PAGE_SIZE;
+}
+
+int process_charge_mapping(struct ARC_Process *process, size_t size, bool file) {
+	size = ALIGN(size, PAGE_SIZE);
+
+	if (process_charge(process, ARC_PROCESS_MEM_RSS, size) != 0) {
+		return -1;
+	}
+
+	if (process_charge(process, ARC_PROCESS_MEM_PAGE_TABLES, page_table_cost(size)) != 0) {
+		process_uncharge(process, ARC_PROCESS_MEM_RSS, size);
+		return -1;
+	}
+
+	if (file) {
+		process_charge(process, ARC_PROCESS_MEM_FILES, size);
+	}
+
+	return 0;
+}
+
+void process_uncharge_mapping(struct ARC_Process *process, size_t size, bool file) {
+	size = ALIGN(size, PAGE_SIZE);
+
+	process_uncharge(process, ARC_PROCESS_MEM_RSS, size);
+	process_uncharge(process, ARC_PROCESS_MEM_PAGE_TABLES, page_table_cost(size));
+
+	if (file) {
+		process_uncharge(process, ARC_PROCESS_MEM_FILES, size);
+	}
+}
+
+int process_set_limits(struct ARC_Process *process, uint64_t soft, uint64_t hard) {
+	if (process == NULL || (hard != 0 && soft > hard)) {
+		return -1;
+	}
+
+	process->memory.soft_limit = soft;
+	process->memory.hard_limit = hard;
+
+	return 0;
+}
+
+static void region_unmap(ARC_Process *process, ARC_ProcessRegion *region) {
+	if (process->page_tables.user != NULL) {
+		pager_unmap(process->page_tables.user, (uintptr_t)region->virt, region->size, NULL);
+	}
+
+	pager_unmap(process->page_tables.kernel, (uintptr_t)region->virt, region->size, NULL);
+}
+
+void process_release_region(struct ARC_Process *process, ARC_ProcessRegion *region) {
+	if (region == NULL) {
+		return;
+	}
+
+	size_t pages = region->size / PAGE_SIZE;
+
+	if (region->pages != NULL) {
+		ksm_release_region(process, region);
+	} else if (region->ipc != NULL) {
+		ipc_release_region(process, region);
+	} else if (region->swap != NULL) {
+		for (size_t i = 0; i < pages; i++) {
+			zswap_drop(&region->swap[i]);
+		}
+
+		free(region->swap);
+	} else {
+		if (process != NULL) {
+			region_unmap(process, region);
+		}
+
+		process_write_back_region(region);
+
+		if (!region->cached || elf_cache_release(region->phys) != 0) {
+			pmm_free(region->phys);
+		}
+	}
+
+	free(region);
+}
+
+static int process_reclaim_stage(struct ARC_Process *process, size_t *budget) {
+	switch (process->reap.stage) {
+	case 0: {
+		while (process->threads != NULL && *budget > 0) {
+			ARC_Thread *thread = process->threads->t;
+
+			if (!thread_gone(thread)) {
+				// Still on its way out, try again on a later run
+				return 0;
+			}
+
+			if (__atomic_load_n(&thread->exit.exited, __ATOMIC_ACQUIRE)) {
+				// Its stacks are already with the reaper, nobody
+				// is going to join it now
+				process_disassociate_thread(process, thread);
+				thread_release(thread);
+			} else {
+				thread_delete(thread);
+			}
+
+			(*budget)--;
+		}
+
+		if (process->threads != NULL) {
+			return 0;
+		}
+
+		process->reap.stage++;
+	}
+	// fall through
+
+	case 1: {
+		while (process->regions != NULL && *budget > 0) {
+			spinlock_lock(&process->lock);
+
+			if (process->swapping != 0) {
+				// A swap out is still finishing up
+				spinlock_unlock(&process->lock);
+				return 0;
+			}
+
+			ARC_ProcessRegion *region = process->regions;
+			process->regions = region->next;
+
+			spinlock_unlock(&process->lock);
+
+			size_t pages = region->size / PAGE_SIZE;
+
+			process_release_region(process, region);
+
+			if (pages == 0) {
+				pages = 1;
+			}
+
+			*budget = pages < *budget ? *budget - pages : 0;
+		}
+
+		if (process->regions != NULL) {
+			return 0;
+		}
+
+		process->reap.stage++;
+	}
+	// fall through
+
+	case 2: {
+		for (int i = 0; i < ARC_PROCESS_FILE_LIMIT; i++) {
+			if (process->file_table[i] != NULL) {
+				vfs_close(process->file_table[i]);
+				process->file_table[i] = NULL;
+			}
+
+			free(process->file_origin[i].path);
+			process->file_origin[i].path = NULL;
+		}
+
+		// Pipes stop notifying the epoll instance before it goes
+		if (process->ipc != NULL) {
+			uninit_ipc(process);
+		}
+
+		if (process->epoll != NULL) {
+			uninit_epoll(process);
+		}
+
+		// Nobody else may use them
+		template_release_owner(process);
+
+		if (process->program != NULL) {
+			process_uncharge_mapping(process, process->program->size, true);
+			uninit_program_loader(process->program);
+			process->program = NULL;
+		}
+
+		if (process->allocator != NULL) {
+			uninit_vmm(process->allocator);
+			process->allocator = NULL;
+		}
+
+		process->reap.stage++;
+	}
+	// fall through
+
+	case 3: {
+		// Kernel processes share the kernel's page tables
+		if (process->userspace) {
+			free(process->page_tables.user);
+			free(process->page_tables.kernel);
+		}
+
+		ARC_DEBUG(INFO, "Reclaimed process %lu\n", process->pid);
+		free(process);
+
+		return 1;
+	}
+	}
+
 	return -1;
 }
 
+int process_reclaim(struct ARC_Process *process, size_t *budget) {
+	if (process == NULL || budget == NULL) {
+		return -1;
+	}
+
+	uint64_t start = spawn_stats_start();
+	int ret = process_reclaim_stage(process, budget);
+	spawn_stats_record(ARC_SPAWN_PROCESS_RECLAIM, start);
+
+	return ret;
+}
+
+static ARC_ProcessRegion *region_create(void *virt, void *phys, size_t size, uint32_t flags) {
+	ARC_ProcessRegion *region = (ARC_ProcessRegion *)alloc(sizeof(*region));
+
+	if (region == NULL) {
+		ARC_DEBUG(ERR, "Failed to allocate region\n");
+		return NULL;
+	}
+
+	region->virt = virt;
+	region->phys = phys;
+	region->size = ALIGN(size, PAGE_SIZE);
+	region->flags = flags;
+	region->file = false;
+	region->cached = false;
+	region->swap = NULL;
+	region->swapping = false;
+	region->pages = NULL;
+	region->shared = NULL;
+	region->ipc = NULL;
+	region->backing = NULL;
+	region->offset = 0;
+	region->length = 0;
+
+	return region;
+}
+
+static void region_link(struct ARC_Process *process, ARC_ProcessRegion *region) {
+	spinlock_lock(&process->lock);
+	region->next = process->regions;
+	process->regions = region;
+	spinlock_unlock(&process->lock);
+}
+
+int process_add_region(struct ARC_Process *process, void *virt, void *phys, size_t size, uint32_t flags, bool file, bool cached) {
+	if (process == NULL || virt == NULL || phys == NULL || size == 0) {
+		ARC_DEBUG(ERR, "Improper arguments\n");
+		return -1;
+	}
+
+	ARC_ProcessRegion *region = region_create(virt, phys, size, flags);
+
+	if (region == NULL) {
+		return -2;
+	}
+
+	region->file = file;
+	region->cached = cached;
+	region_link(process, region);
+
+	return 0;
+}
+
+int process_add_file_region(struct ARC_Process *process, void *virt, void *phys, size_t size, uint32_t flags, struct ARC_File *backing, long offset, size_t length) {
+	if (process == NULL || virt == NULL || phys == NULL || size == 0 || backing == NULL) {
+		ARC_DEBUG(ERR, "Improper arguments\n");
+		return -1;
+	}
+
+	ARC_ProcessRegion *region = region_create(virt, phys, size, flags);
+
+	if (region == NULL) {
+		return -2;
+	}
+
+	region->file = true;
+	region->backing = backing;
+	region->offset = offset;
+	region->length = length < region->size ? length : region->size;
+	region_link(process, region);
+
+	return 0;
+}
+
+void process_write_back_region(ARC_ProcessRegion *region) {
+	if (region == NULL || region->backing == NULL) {
+		return;
+	}
+
+	// NOTE: Only what was read from the file goes back, the mapping never
+	//       makes it any longer
+	vfs_seek(region->backing, region->offset, SEEK_SET);
+
+	if (vfs_write(region->phys, 1, region->length, region->backing) != (long)region->length) {
+		ARC_DEBUG(ERR, "Failed to write back shared mapping %p\n", region->virt);
+	}
+
+	elf_cache_invalidate(region->backing->node);
+	vfs_close(region->backing);
+	region->backing = NULL;
+}
+
+int process_add_ipc_region(struct ARC_Process *process, void *virt, struct ARC_IPCBuffer *buffer, uint32_t flags) {
+	if (process == NULL || virt == NULL || buffer == NULL || buffer->count == 0) {
+		ARC_DEBUG(ERR, "Improper arguments\n");
+		return -1;
+	}
+
+	ARC_ProcessRegion *region = region_create(virt, buffer->pages[0], buffer->count * PAGE_SIZE, flags);
+
+	if (region == NULL) {
+		return -2;
+	}
+
+	region->ipc = buffer;
+	region_link(process, region);
+
+	return 0;
+}
+
+// The HHDM address of the index-th page backing region
+static void *region_page(ARC_ProcessRegion *region, size_t index) {
+	if (region->pages != NULL) {
+		return region->pages[index];
+	}
+
+	if (region->ipc != NULL) {
+		return region->ipc->pages[index];
+	}
+
+	return (uint8_t *)region->phys + index * PAGE_SIZE;
+}
+
+ARC_ProcessRegion *process_share_region(struct ARC_Process *process, ARC_ProcessRegion *region) {
+	if (region == NULL || region->swap != NULL || region->swapping || region->backing != NULL) {
+		return NULL;
+	}
+
+	ARC_ProcessRegion *copy = region_create(region->virt, region->phys, region->size, region->flags);
+
+	if (copy == NULL) {
+		return NULL;
+	}
+
+	copy->file = region->file;
+	copy->cached = region->cached;
+
+	int ret = -1;
+
+	if (region->pages != NULL) {
+		ret = ksm_ref_region(copy, region);
+	} else if (region->ipc != NULL) {
+		copy->ipc = ipc_buffer_ref(region->ipc);
+		ret = 0;
+	} else if (region->cached) {
+		ret = elf_cache_ref(region->phys);
+	}
+
+	if (ret != 0) {
+		// Private memory, it would have to be shared first
+		free(copy);
+		return NULL;
+	}
+
+	if (process == NULL) {
+		return copy;
+	}
+
+	if (process_charge_mapping(process, copy->size, copy->file) != 0) {
+		process_release_region(NULL, copy);
+		return NULL;
+	}
+
+	// Writes to pages shared through ksm fault, and are copied by
+	// ksm_cow_fault
+	uint32_t flags = copy->pages != NULL ? copy->flags & ~(1 << ARC_PAGER_RW) : copy->flags;
+
+	for (size_t i = 0; i < copy->size / PAGE_SIZE; i++) {
+		uintptr_t virt = (uintptr_t)copy->virt + i * PAGE_SIZE;
+		uintptr_t phys = ARC_HHDM_TO_PHYS(region_page(copy, i));
+
+		if (process->page_tables.user != NULL && pager_map(process->page_tables.user, virt, phys, PAGE_SIZE, flags) != 0) {
+			ARC_DEBUG(ERR, "Failed to map shared region page\n");
+			pager_unmap(process->page_tables.user, (uintptr_t)copy->virt, i * PAGE_SIZE, NULL);
+			pager_unmap(process->page_tables.kernel, (uintptr_t)copy->virt, i * PAGE_SIZE, NULL);
+			process_uncharge_mapping(process, copy->size, copy->file);
+			process_release_region(NULL, copy);
+
+			return NULL;
+		}
+
+		pager_map(process->page_tables.kernel, virt, phys, PAGE_SIZE, flags);
+	}
+
+	region_link(process, copy);
+
+	return copy;
+}
+
+// Called with the process lock held, which is dropped while process_swap_out
+// finishes with region. Returns true if it waited, the regions may have
+// changed since then
+static bool region_wait(ARC_Process *process, ARC_ProcessRegion *region) {
+	if (!region->swapping) {
+		return false;
+	}
+
+	spinlock_unlock(&process->lock);
+
+	while (__atomic_load_n(&process->swapping, __ATOMIC_ACQUIRE) != 0) {
+		__builtin_ia32_pause();
+	}
+
+	spinlock_lock(&process->lock);
+
+	return true;
+}
+
+ARC_ProcessRegion *process_remove_region(struct ARC_Process *process, void *virt) {
+	if (process == NULL) {
+		return NULL;
+	}
+
+	spinlock_lock(&process->lock);
+
+	ARC_ProcessRegion **link;
+
+	do {
+		link = &process->regions;
+		while (*link != NULL && (*link)->virt != virt) {
+			link = &(*link)->next;
+		}
+	} while (*link != NULL && region_wait(process, *link));
+
+	ARC_ProcessRegion *region = *link;
+
+	if (region != NULL) {
+		*link = region->next;
+		region->next = NULL;
+	}
+
+	spinlock_unlock(&process->lock);
+
+	return region;
+}
+
+// Maps the region's pages back in where they were
+static void region_map(ARC_Process *process, ARC_ProcessRegion *region) {
+	uintptr_t phys = ARC_HHDM_TO_PHYS(region->phys);
+
+	if (process->page_tables.user != NULL) {
+		pager_map(process->page_tables.user, (uintptr_t)region->virt, phys, region->size, region->flags);
+	}
+
+	pager_map(process->page_tables.kernel, (uintptr_t)region->virt, phys, region->size, region->flags);
+}
+
+// Compresses the pages of the region, which nothing else may touch meanwhile.
+// Returns NULL if the pool is exhausted
+static ARC_SwapSlot *region_compress(ARC_ProcessRegion *region, ARC_ZSwapScratch *scratch, uint64_t *stored, uint64_t *zeroes) {
+	size_t pages = region->size / PAGE_SIZE;
+	ARC_SwapSlot *slots = (ARC_SwapSlot *)alloc(sizeof(*slots) * pages);
+
+	if (slots == NULL) {
+		return NULL;
+	}
+
+	for (size_t i = 0; i < pages; i++) {
+		if (zswap_store((uint8_t *)region->phys + i * PAGE_SIZE, &slots[i], scratch) != 0) {
+			while (i-- > 0) {
+				zswap_drop(&slots[i]);
+			}
+
+			free(slots);
+			return NULL;
+		}
+
+		*stored += slots[i].size;
+		*zeroes += slots[i].size == 0;
+	}
+
+	return slots;
+}
+
+// Called with the process lock held
+static int region_swap_in(ARC_Process *process, ARC_ProcessRegion *region) {
+	size_t pages = region->size / PAGE_SIZE;
+	uint8_t *phys = (uint8_t *)pmm_alloc(region->size);
+
+	if (phys == NULL) {
+		return -1;
+	}
+
+	uint64_t stored = 0;
+
+	// Nothing is dropped until all of it has come back, so a corrupt
+	// page does not take the rest with it
+	for (size_t i = 0; i < pages; i++) {
+		stored += region->swap[i].size;
+
+		if (zswap_load(&region->swap[i], phys + i * PAGE_SIZE) != 0) {
+			ARC_DEBUG(ERR, "Lost page %lu of region %p of process %lu\n", i, region->virt, process->pid);
+			pmm_free(phys);
+			return -3;
+		}
+	}
+
+	for (size_t i = 0; i < pages; i++) {
+		zswap_drop(&region->swap[i]);
+	}
+
+	free(region->swap);
+	region->swap = NULL;
+	region->phys = phys;
+	region_map(process, region);
+
+	// Already accounted for when it was mapped, so no limit applies
+	mem_add(process, ARC_PROCESS_MEM_RSS, region->size);
+
+	process->swap.pages_in += pages;
+	process->swap.original_bytes -= region->size;
+	process->swap.stored_bytes -= stored;
+
+	return 0;
+}
+
+// NOTE: There is no record of which pages were touched recently, so the whole
+//       of an idle process is treated as cold. Each region is unmapped before
+//       it is compressed without the lock, a thread that touches it waits in
+//       process_swap_fault for it to be done
+int process_swap_out(ARC_Process *process) {
+	if (process == NULL || !process->userspace) {
+		ARC_DEBUG(ERR, "Cannot swap out process %p\n", process);
+		return -1;
+	}
+
+	ARC_ZSwapScratch *scratch = (ARC_ZSwapScratch *)alloc(sizeof(*scratch));
+
+	if (scratch == NULL) {
+		ARC_DEBUG(ERR, "Failed to allocate compression scratch\n");
+		return -2;
+	}
+
+	int ret = 0;
+
+	while (1) {
+		spinlock_lock(&process->lock);
+
+		ARC_ProcessRegion *region = process->regions;
+
+		// Regions opted in to merging are left to ksm, cached and IPC
+		// ones are shared with other processes
+		while (region != NULL && (region->swap != NULL || region->swapping || region->pages != NULL
+					  || region->cached || region->ipc != NULL || region->backing != NULL)) {
+			region = region->next;
+		}
+
+		if (region == NULL || process->dead) {
+			spinlock_unlock(&process->lock);
+			break;
+		}
+
+		region->swapping = true;
+		process->swapping++;
+		region_unmap(process, region);
+
+		spinlock_unlock(&process->lock);
+
+		uint64_t stored = 0;
+		uint64_t zeroes = 0;
+		ARC_SwapSlot *slots = region_compress(region, scratch, &stored, &zeroes);
+
+		spinlock_lock(&process->lock);
+
+		if (slots != NULL) {
+			pmm_free(region->phys);
+			region->phys = NULL;
+			region->swap = slots;
+
+			mem_add(process, ARC_PROCESS_MEM_RSS, -(int64_t)region->size);
+
+			process->swap.pages_out += region->size / PAGE_SIZE;
+			process->swap.zero_pages += zeroes;
+			process->swap.original_bytes += region->size;
+			process->swap.stored_bytes += stored;
+		} else {
+			region_map(process, region);
+			ret = -3;
+		}
+
+		region->swapping = false;
+		__atomic_store_n(&process->swapping, process->swapping - 1, __ATOMIC_RELEASE);
+
+		spinlock_unlock(&process->lock);
+
+		if (slots == NULL) {
+			// Pool is exhausted, leave the rest be
+			break;
+		}
+	}
+
+	free(scratch);
+
+	ARC_DEBUG(INFO, "Swapped out process %lu, %lu bytes held in %lu\n", process->pid,
+		  process->swap.original_bytes, process->swap.stored_bytes);
+
+	return ret;
+}
+
 int process_swap_in(ARC_Process *process) {
-	ARC_DEBUG(WARN, "Definitely swapping in process %p\n", process);
-	return -1;
+	if (process == NULL) {
+		ARC_DEBUG(ERR, "No process given\n");
+		return -1;
+	}
+
+	int ret = 0;
+
+	spinlock_lock(&process->lock);
+
+	ARC_ProcessRegion *region = process->regions;
+
+	while (region != NULL) {
+		if (region_wait(process, region)) {
+			region = process->regions;
+			continue;
+		}
+
+		if (region->swap != NULL) {
+			int err = region_swap_in(process, region);
+
+			if (err != 0 && ret != -3) {
+				ret = err == -3 ? -3 : -2;
+			}
+		}
+
+		region = region->next;
+	}
+
+	spinlock_unlock(&process->lock);
+
+	return ret;
+}
+
+int process_swap_fault(ARC_Process *process, void *address) {
+	if (process == NULL) {
+		return -1;
+	}
+
+	int ret = -2;
+
+	spinlock_lock(&process->lock);
+
+	ARC_ProcessRegion *region = process->regions;
+
+	while (region != NULL) {
+		uintptr_t base = (uintptr_t)region->virt;
+
+		if (base > (uintptr_t)address || (uintptr_t)address >= base + region->size) {
+			region = region->next;
+			continue;
+		}
+
+		if (region_wait(process, region)) {
+			region = process->regions;
+			continue;
+		}
+
+		ret = region->swap == NULL ? 1 : region_swap_in(process, region);
+		break;
+	}
+
+	spinlock_unlock(&process->lock);
+
+	return ret;
 }
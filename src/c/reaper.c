@@ -0,0 +1,190 @@
+/**
+ * @file reaper.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#include "global.h"
+#include "lib/atomics.h"
+#include "lib/spinlock.h"
+#include "userspace/percpu.h"
+#include "userspace/reaper.h"
+
+struct reaper_shard {
+	// Pushed onto without a lock from the exit path
+	ARC_Process *incoming;
+	ARC_Spinlock lock;
+	ARC_Process *pending;
+	ARC_Thread *threads_incoming;
+	ARC_Thread *threads_pending;
+};
+
+static struct reaper_shard shards[ARC_USERSPACE_CPU_SLOTS] = { 0 };
+static uint64_t global_epoch = 1;
+// Last epoch each processor slot has seen, UINT64_MAX while it idles
+static uint64_t slot_epochs[ARC_USERSPACE_CPU_SLOTS] = { 0 };
+
+int init_reaper(void) {
+	for (int i = 0; i < ARC_USERSPACE_CPU_SLOTS; i++) {
+		init_static_spinlock(&shards[i].lock);
+	}
+
+	return 0;
+}
+
+uint64_t reaper_retire(void) {
+	return ARC_ATOMIC_INC(global_epoch) - 1;
+}
+
+bool reaper_grace_passed(uint64_t epoch) {
+	// Every processor that is up has to have reported since, one that
+	// never did could be anywhere
+	uint64_t online = percpu_online_mask();
+
+	while (online != 0) {
+		int i = __builtin_ctzll(online);
+		online &= online - 1;
+
+		if (__atomic_load_n(&slot_epochs[i], __ATOMIC_ACQUIRE) <= epoch) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void reaper_idle(void) {
+	__atomic_store_n(&slot_epochs[percpu_slot()], UINT64_MAX, __ATOMIC_RELEASE);
+}
+
+int reaper_defer_process(ARC_Process *process) {
+	if (process == NULL) {
+		return -1;
+	}
+
+	struct reaper_shard *shard = &shards[percpu_slot()];
+
+	process->reap.epoch = reaper_retire();
+	process->reap.next = __atomic_load_n(&shard->incoming, __ATOMIC_RELAXED);
+
+	while (!__atomic_compare_exchange_n(&shard->incoming, &process->reap.next, process, true,
+					    __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+	return 0;
+}
+
+int reaper_defer_thread(ARC_Thread *thread) {
+	if (thread == NULL) {
+		return -1;
+	}
+
+	struct reaper_shard *shard = &shards[percpu_slot()];
+
+	thread->exit.epoch = reaper_retire();
+	thread->exit.next = __atomic_load_n(&shard->threads_incoming, __ATOMIC_RELAXED);
+
+	while (!__atomic_compare_exchange_n(&shard->threads_incoming, &thread->exit.next, thread, true,
+					    __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+	return 0;
+}
+
+static void reaper_run_threads(struct reaper_shard *shard, size_t *left) {
+	ARC_Thread *incoming = __atomic_exchange_n(&shard->threads_incoming, NULL, __ATOMIC_ACQUIRE);
+
+	while (incoming != NULL) {
+		ARC_Thread *next = incoming->exit.next;
+		incoming->exit.next = shard->threads_pending;
+		shard->threads_pending = incoming;
+		incoming = next;
+	}
+
+	ARC_Thread **link = &shard->threads_pending;
+
+	while (*link != NULL && *left > 0) {
+		ARC_Thread *thread = *link;
+
+		// The thread yields once it has exited, until a processor
+		// has switched away from it its kernel stack is in use
+		if (!thread_gone(thread) || !reaper_grace_passed(thread->exit.epoch)) {
+			link = &thread->exit.next;
+			continue;
+		}
+
+		*link = thread->exit.next;
+
+		size_t pages = (thread->kstack.size + thread->ustack.size) / PAGE_SIZE;
+		*left = pages < *left ? *left - pages : 0;
+
+		thread_reclaim(thread);
+	}
+}
+
+size_t reaper_run(size_t budget) {
+	uint32_t slot = percpu_slot();
+	struct reaper_shard *shard = &shards[slot];
+
+	__atomic_store_n(&slot_epochs[slot], __atomic_load_n(&global_epoch, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+
+	if (shard->pending == NULL && __atomic_load_n(&shard->incoming, __ATOMIC_RELAXED) == NULL
+	    && shard->threads_pending == NULL && __atomic_load_n(&shard->threads_incoming, __ATOMIC_RELAXED) == NULL) {
+		return 0;
+	}
+
+	spinlock_lock(&shard->lock);
+
+	size_t left = budget;
+	reaper_run_threads(shard, &left);
+
+	ARC_Process *incoming = __atomic_exchange_n(&shard->incoming, NULL, __ATOMIC_ACQUIRE);
+
+	while (incoming != NULL) {
+		ARC_Process *next = incoming->reap.next;
+		incoming->reap.next = shard->pending;
+		shard->pending = incoming;
+		incoming = next;
+	}
+
+	ARC_Process **link = &shard->pending;
+
+	while (*link != NULL && left > 0) {
+		ARC_Process *process = *link;
+
+		if (!reaper_grace_passed(process->reap.epoch)) {
+			link = &process->reap.next;
+			continue;
+		}
+
+		ARC_Process *next = process->reap.next;
+
+		if (process_reclaim(process, &left) == 1) {
+			*link = next;
+		} else {
+			link = &process->reap.next;
+		}
+	}
+
+	spinlock_unlock(&shard->lock);
+
+	return budget - left;
+}
@@ -0,0 +1,100 @@
+/**
+ * @file spawn_stats.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#include "global.h"
+#include "userspace/spawn_stats.h"
+
+#include <stdio.h>
+
+static ARC_SpawnStats stats = { 0 };
+
+static const char *names[ARC_SPAWN_STEPS] = {
+	[ARC_SPAWN_PROCESS_CREATE] = "process_create",
+	[ARC_SPAWN_LOADER_INIT] = "loader_init",
+	[ARC_SPAWN_LOADER_LOAD] = "loader_load",
+	[ARC_SPAWN_THREAD_CREATE] = "thread_create",
+	[ARC_SPAWN_ENTRY_STACK] = "entry_stack",
+	[ARC_SPAWN_FROM_FILE] = "from_file",
+	[ARC_SPAWN_PROCESS_RECLAIM] = "process_reclaim",
+	[ARC_SPAWN_THREAD_RECLAIM] = "thread_reclaim",
+	[ARC_SPAWN_FROM_TEMPLATE] = "from_template",
+};
+
+void spawn_stats_record(int step, uint64_t start) {
+	if (step < 0 || step >= ARC_SPAWN_STEPS) {
+		return;
+	}
+
+	uint64_t cycles = __builtin_ia32_rdtsc() - start;
+	ARC_SpawnStat *stat = &stats.steps[step];
+
+	__atomic_add_fetch(&stat->count, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&stat->cycles, cycles, __ATOMIC_RELAXED);
+
+	uint64_t min = __atomic_load_n(&stat->min, __ATOMIC_RELAXED);
+	while ((min == 0 || cycles < min)
+	       && !__atomic_compare_exchange_n(&stat->min, &min, cycles, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+	uint64_t max = __atomic_load_n(&stat->max, __ATOMIC_RELAXED);
+	while (cycles > max && !__atomic_compare_exchange_n(&stat->max, &max, cycles, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+void spawn_stats_get(ARC_SpawnStats *out) {
+	for (int i = 0; i < ARC_SPAWN_STEPS; i++) {
+		out->steps[i].count = __atomic_load_n(&stats.steps[i].count, __ATOMIC_RELAXED);
+		out->steps[i].cycles = __atomic_load_n(&stats.steps[i].cycles, __ATOMIC_RELAXED);
+		out->steps[i].min = __atomic_load_n(&stats.steps[i].min, __ATOMIC_RELAXED);
+		out->steps[i].max = __atomic_load_n(&stats.steps[i].max, __ATOMIC_RELAXED);
+	}
+}
+
+void spawn_stats_reset(void) {
+	// NOTE: Samples recorded while this runs may be partly lost
+	for (int i = 0; i < ARC_SPAWN_STEPS; i++) {
+		__atomic_store_n(&stats.steps[i].count, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&stats.steps[i].cycles, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&stats.steps[i].min, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&stats.steps[i].max, 0, __ATOMIC_RELAXED);
+	}
+}
+
+const char *spawn_stats_name(int step) {
+	if (step < 0 || step >= ARC_SPAWN_STEPS) {
+		return NULL;
+	}
+
+	return names[step];
+}
+
+void spawn_stats_dump(void) {
+	ARC_SpawnStats copy = { 0 };
+	spawn_stats_get(&copy);
+
+	for (int i = 0; i < ARC_SPAWN_STEPS; i++) {
+		ARC_SpawnStat *stat = &copy.steps[i];
+		printf(ARC_SPAWN_STATS_LINE, names[i], stat->count, stat->cycles, stat->min, stat->max);
+	}
+}
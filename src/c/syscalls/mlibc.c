@@ -25,6 +25,7 @@
  * @DESCRIPTION
 */
 #include "abi-bits/seek-whence.h"
+#include "abi-bits/vm-flags.h"
 #include "arch/context.h"
 #include <interface/terminal.h>
 #include <fs/vfs.h>
@@ -39,71 +40,220 @@
 #include <arch/smp.h>
 #include <mp/scheduler.h>
 #include <mm/pmm.h>
+#include <mm/allocator.h>
+#include <userspace/affinity.h>
+#include <userspace/epoll.h>
+#include <userspace/futex.h>
+#include <userspace/ipc.h>
+#include <userspace/ksm.h>
+#include <userspace/loaders/elf.h>
+#include <userspace/log.h>
+#include <userspace/percpu.h>
+#include <userspace/spawn_stats.h>
+#include <userspace/template.h>
+#include <userspace/timer.h>
+#include <userspace/usercopy.h>
+
+#define COPY_RANGE_CHUNK (PAGE_SIZE * 16)
+#define RW_BOUNCE_CHUNK PAGE_SIZE
+#define PATH_LIMIT 4096
+#define LOG_LIMIT 512
+#define TIMER_ABSTIME 1
+#define CLOCK_REALTIME 0
+#define CLOCK_MONOTONIC 1
+
+// Every syscall acts on the process of the calling thread
+static ARC_Process *current_process(void) {
+	return smp_get_proc_desc()->thread->parent;
+}
+
+static struct ARC_File *get_file(int fd) {
+	if (fd < 0 || fd >= ARC_PROCESS_FILE_LIMIT) {
+		return NULL;
+	}
+
+	return current_process()->file_table[fd];
+}
 
 static int syscall_tcb_set(void *arg) {
 	ARC_ProcessorDescriptor *desc = smp_get_proc_desc();
 	context_set_tcb(desc->thread->context, arg);
+	desc->thread->tcb = arg;
 
 	return 0;
 }
 
-static int syscall_futex_wait(int *ptr, int expected, struct timespec const *time) {
-	(void)ptr;
-	(void)expected;
-	(void)time;
+// A time given by userspace, as every timeout and sleep takes it
+static bool timespec_ok(const ARC_TimeSpec *ts) {
+	return ts->sec >= 0 && ts->nsec >= 0 && ts->nsec < 1000000000;
+}
+
+// base plus a valid ts in nanoseconds, saturating instead of wrapping around
+// into the past
+static uint64_t deadline_after(uint64_t base, const ARC_TimeSpec *ts) {
+	if ((uint64_t)ts->sec > (UINT64_MAX - base) / 1000000000) {
+		return UINT64_MAX;
+	}
 
-	printf("Futex wait\n");
+	uint64_t left = UINT64_MAX - base - (uint64_t)ts->sec * 1000000000;
 
-	return 0;
+	if ((uint64_t)ts->nsec > left) {
+		return UINT64_MAX;
+	}
+
+	return base + timespec_to_ns(ts);
+}
+
+static int syscall_futex_wait(int *ptr, int expected, ARC_TimeSpec const *time) {
+	uint64_t deadline = 0;
+
+	if (time != NULL) {
+		ARC_TimeSpec timeout = { 0 };
+
+		if (copy_from_user(&timeout, time, sizeof(timeout)) != 0 || !timespec_ok(&timeout)) {
+			return -1;
+		}
+
+		deadline = deadline_after(timer_now(), &timeout);
+	}
+
+	return futex_wait(ptr, expected, deadline);
 }
 
 static int syscall_futex_wake(int *ptr) {
-	(void)ptr;
+	futex_wake(ptr, INT32_MAX);
 
-	printf("Futex wake\n");
-	
 	return 0;
 }
 
-static int syscall_clock_get(int a, long *b, long *c) {
-	(void)a;
-	(void)b;
-	(void)c;
+static int syscall_futex_lock_pi(int *ptr, ARC_TimeSpec const *time) {
+	uint64_t deadline = 0;
+
+	if (time != NULL) {
+		ARC_TimeSpec timeout = { 0 };
+
+		if (copy_from_user(&timeout, time, sizeof(timeout)) != 0 || !timespec_ok(&timeout)) {
+			return -1;
+		}
+
+		deadline = deadline_after(timer_now(), &timeout);
+	}
+
+	return futex_lock_pi(ptr, deadline);
+}
+
+static int syscall_futex_unlock_pi(int *ptr) {
+	return futex_unlock_pi(ptr);
+}
+
+static int syscall_futex_trylock_pi(int *ptr) {
+	return futex_trylock_pi(ptr);
+}
+
+static int syscall_clock_get(int clock, long *secs, long *nanos) {
+	// NOTE: There is no wall clock source yet, every clock reads as
+	//       monotonic
+	(void)clock;
+
+	uint64_t now = timer_now();
+	long sec = now / 1000000000;
+	long nsec = now % 1000000000;
+
+	if (copy_to_user(secs, &sec, sizeof(sec)) != 0 || copy_to_user(nanos, &nsec, sizeof(nsec)) != 0) {
+		return -1;
+	}
+
+	return 0;
+}
+
+static int syscall_sleep(long *secs, long *nanos) {
+	ARC_TimeSpec request = { 0 };
+
+	if (copy_from_user(&request.sec, secs, sizeof(long)) != 0 || copy_from_user(&request.nsec, nanos, sizeof(long)) != 0
+	    || !timespec_ok(&request)) {
+		return -1;
+	}
+
+	timer_sleep_until(deadline_after(timer_now(), &request));
+
+	// Sleeps are not interrupted, nothing remains
+	long zero = 0;
+	copy_to_user(secs, &zero, sizeof(zero));
+	copy_to_user(nanos, &zero, sizeof(zero));
+
+	return 0;
+}
+
+static int syscall_clock_nanosleep(int clock, int flags, ARC_TimeSpec const *request, ARC_TimeSpec *remain) {
+	// NOTE: Both read as the monotonic clock, see syscall_clock_get
+	if (clock != CLOCK_REALTIME && clock != CLOCK_MONOTONIC) {
+		return -1;
+	}
+
+	ARC_TimeSpec time = { 0 };
+
+	if (copy_from_user(&time, request, sizeof(time)) != 0 || !timespec_ok(&time)) {
+		return -1;
+	}
+
+	uint64_t deadline = deadline_after((flags & TIMER_ABSTIME) ? 0 : timer_now(), &time);
+
+	timer_sleep_until(deadline);
+
+	if (remain != NULL) {
+		ARC_TimeSpec zero = { 0 };
+		copy_to_user(remain, &zero, sizeof(zero));
+	}
 
-	printf("Syscall clock get\n");
-	
 	return 0;
 }
 
 static int syscall_exit(int code) {
 	ARC_DEBUG(INFO, "Exiting %d\n", code);
 	struct ARC_ProcessorDescriptor *desc = smp_get_proc_desc();
-	term_draw();
-	process_delete(desc->thread->parent);
+	process_delete(current_process());
+	thread_halt(desc->thread);
+
+	// Halted, this thread will not be picked again
+	while (1) {
+		sched_yield_cpu();
+	}
 
 	return 0;
 }
 
 static int syscall_seek(int fd, long offset, int whence, long *new_offset) {
-	struct ARC_ProcessorDescriptor *desc = smp_get_proc_desc();
-	struct ARC_File *file = desc->thread->parent->file_table[fd];
+	struct ARC_File *file = get_file(fd);
 
 	if (file == NULL) {
 		return -1;
 	}
 
-	*new_offset = vfs_seek(file, offset, whence);
+	long ret = vfs_seek(file, offset, whence);
 
-	return 0;
+	return copy_to_user(new_offset, &ret, sizeof(ret));
 }
 
 static int syscall_write(int fd, void const *buffer, unsigned long count, long *written) {
-	struct ARC_ProcessorDescriptor *desc = smp_get_proc_desc();
-	struct ARC_File *file = desc->thread->parent->file_table[fd];
+	if (!user_access_ok(buffer, count)) {
+		return -1;
+	}
+
+	struct ARC_File *file = get_file(fd);
 
 #ifdef ARC_DEBUG_ENABLE
 	if (fd == 0) {
-		printf("%.*s", (int)count, (char *)buffer);
+		char part[LOG_LIMIT];
+
+		for (unsigned long i = 0; i < count; i += sizeof(part)) {
+			size_t size = count - i < sizeof(part) ? count - i : sizeof(part);
+
+			if (copy_from_user(part, (uint8_t *)buffer + i, size) != 0) {
+				break;
+			}
+
+			log_write(part, size);
+		}
 	}
 #endif
 
@@ -111,34 +261,108 @@ static int syscall_write(int fd, void const *buffer, unsigned long count, long *
 		return -1;
 	}
 
-	*written = vfs_write((void *)buffer, 1, count, file);
-	
-	return 0;
+	// The VFS is never handed user pointers, the data goes through a
+	// kernel buffer a chunk at a time so a bad address faults in the copy
+	void *bounce = pmm_alloc(RW_BOUNCE_CHUNK);
+
+	if (bounce == NULL) {
+		return -2;
+	}
+
+	long ret = 0;
+
+	for (unsigned long i = 0; i < count;) {
+		size_t size = count - i < RW_BOUNCE_CHUNK ? count - i : RW_BOUNCE_CHUNK;
+
+		if (copy_from_user(bounce, (uint8_t *)buffer + i, size) != 0) {
+			ret = ret == 0 ? -1 : ret;
+			break;
+		}
+
+		long put = vfs_write(bounce, 1, size, file);
+
+		if (put <= 0) {
+			ret = ret == 0 ? put : ret;
+			break;
+		}
+
+		ret += put;
+		i += put;
+
+		if ((size_t)put != size) {
+			break;
+		}
+	}
+
+	pmm_free(bounce);
+
+	if (ret > 0) {
+		elf_cache_invalidate(file->node);
+	}
+
+	return copy_to_user(written, &ret, sizeof(ret));
 }
 
 static int syscall_read(int fd, void *buffer, unsigned long count, long *read) {
-	struct ARC_ProcessorDescriptor *desc = smp_get_proc_desc();
-	struct ARC_File *file = desc->thread->parent->file_table[fd];
+	struct ARC_File *file = get_file(fd);
 
-	if (file == NULL) {
+	if (file == NULL || !user_access_ok(buffer, count)) {
 		return -1;
 	}
 
-	*read = vfs_read((void *)buffer, 1, count, file);
-	
-	return 0;
+	void *bounce = pmm_alloc(RW_BOUNCE_CHUNK);
+
+	if (bounce == NULL) {
+		return -2;
+	}
+
+	long ret = 0;
+
+	for (unsigned long i = 0; i < count;) {
+		size_t size = count - i < RW_BOUNCE_CHUNK ? count - i : RW_BOUNCE_CHUNK;
+		long got = vfs_read(bounce, 1, size, file);
+
+		if (got <= 0) {
+			ret = ret == 0 ? got : ret;
+			break;
+		}
+
+		if (copy_to_user((uint8_t *)buffer + i, bounce, got) != 0) {
+			// Put back what never reached userspace
+			vfs_seek(file, -got, SEEK_CUR);
+			ret = ret == 0 ? -1 : ret;
+			break;
+		}
+
+		ret += got;
+		i += got;
+
+		if ((size_t)got != size) {
+			break;
+		}
+	}
+
+	pmm_free(bounce);
+
+	return copy_to_user(read, &ret, sizeof(ret));
 }
 
 static int syscall_close(int fd) {
-	struct ARC_ProcessorDescriptor *desc = smp_get_proc_desc();
-	struct ARC_File *file = desc->thread->parent->file_table[fd];
+	ARC_Process *process = current_process();
+	struct ARC_File *file = get_file(fd);
 
 	if (file == NULL) {
 		return -1;
 	}
 
 	if (vfs_close(file) == 0) {
-		desc->thread->parent->file_table[fd] = NULL;
+		process->file_table[fd] = NULL;
+		free(process->file_origin[fd].path);
+		process->file_origin[fd].path = NULL;
+
+		if (process->epoll != NULL) {
+			epoll_ctl(process, ARC_EPOLL_CTL_DEL, fd, NULL);
+		}
 	} else {
 		return -1;
 	}
@@ -148,23 +372,62 @@ static int syscall_close(int fd) {
 
 static int syscall_open(char const *name, int flags, unsigned int mode, int *fd) {
         printf("syscall_open\n");
-        
+
+	int ret = -1;
+	char *path = (char *)alloc(PATH_LIMIT);
+
+	if (path == NULL) {
+		copy_to_user(fd, &ret, sizeof(ret));
+		return -1;
+	}
+
 	struct ARC_File *file = NULL;
-	if (vfs_open((char *)name, flags, mode, &file) != 0) {
-		*fd = -1;
+	long len = strncpy_from_user(path, name, PATH_LIMIT);
+
+	if (len < 0 || vfs_open(path, flags, mode, &file) != 0) {
+		free(path);
+		copy_to_user(fd, &ret, sizeof(ret));
 		return -1;
 	}
 
-	struct ARC_ProcessorDescriptor *desc = smp_get_proc_desc();
+	// Kept so process templates can open the file again
+	char *origin = (char *)alloc(len + 1);
+
+	if (origin != NULL) {
+		memcpy(origin, path, len + 1);
+	}
+
+	free(path);
+
+	ARC_Process *process = current_process();
 	for (int i = 0; i < ARC_PROCESS_FILE_LIMIT; i++) {
-		if (desc->thread->parent->file_table[i] == NULL) {
-			desc->thread->parent->file_table[i] = file;
-			*fd = i;
+		if (process->file_table[i] == NULL) {
+			process->file_table[i] = file;
+			process->file_origin[i].path = origin;
+			process->file_origin[i].flags = flags;
+			process->file_origin[i].mode = mode;
+			ret = i;
 			break;
 		}
 	}
 
-	return 0;
+	if (ret < 0) {
+		free(origin);
+	}
+
+	return copy_to_user(fd, &ret, sizeof(ret));
+}
+
+static void vm_release_pages(void *paddr, bool cached) {
+	if (!cached || elf_cache_release(paddr) != 0) {
+		pmm_free(paddr);
+	}
+}
+
+static void vm_release_backing(struct ARC_File *backing) {
+	if (backing != NULL) {
+		vfs_close(backing);
+	}
 }
 
 static int syscall_vm_map(void *hint, unsigned long size, uint64_t prot_flags, int fd, long offset, void **ptr) {
@@ -173,40 +436,84 @@ static int syscall_vm_map(void *hint, unsigned long size, uint64_t prot_flags, i
 	int _prot = prot_flags >> 32;
 	int _flags = prot_flags & UINT32_MAX;
 
-	(void)_prot;
-	(void)_flags;
+	void *vaddr = NULL;
 
-	if (size == 0 || ptr == NULL) {
+	if (size == 0 || copy_to_user(ptr, &vaddr, sizeof(vaddr)) != 0) {
 		return -1;
 	}
 
-	ARC_ProcessorDescriptor *desc = smp_get_proc_desc();
-	ARC_VMMMeta *vmeta = desc->process->allocator;
-	
-	*ptr = NULL;
-	
-	void *paddr = pmm_alloc(size);
+	if (hint != NULL && !user_access_ok(hint, size)) {
+		hint = NULL;
+	}
+
+	ARC_Process *process = current_process();
+	ARC_VMMMeta *vmeta = process->allocator;
+	struct ARC_File *file = get_file(fd);
+	struct ARC_File *backing = NULL;
+
+	if (file != NULL && (_flags & MAP_SHARED) && (_prot & PROT_WRITE)) {
+		// Written back when unmapped, through a file of its own as the
+		// descriptor may well be closed by then
+		char *path = process->file_origin[fd].path;
+
+		if (path == NULL || vfs_open(path, process->file_origin[fd].flags, process->file_origin[fd].mode, &backing) != 0) {
+			return -1;
+		}
+
+		elf_cache_invalidate(file->node);
+	}
+
+	if (process_charge_mapping(process, size, file != NULL) != 0) {
+		vm_release_backing(backing);
+		return -2;
+	}
+
+	// Read-only file mappings, as made for shared libraries, use the same
+	// pages as every other such mapping of that part of the file
+	bool cacheable = file != NULL && !(_prot & PROT_WRITE) && (offset & (PAGE_SIZE - 1)) == 0;
+	size_t pages_size = ALIGN(size, PAGE_SIZE);
+	void *paddr = cacheable ? elf_cache_get(file->node, ARC_ELF_CACHE_FILE, offset, pages_size) : NULL;
+	bool cached = paddr != NULL;
 
-	if (paddr == NULL) {
+	if (paddr == NULL && (paddr = pmm_alloc(pages_size)) == NULL) {
+		process_uncharge_mapping(process, size, file != NULL);
+		vm_release_backing(backing);
 		return -2;
 	}
 
+	if (cacheable && !cached) {
+		memset(paddr, 0, pages_size);
+		vfs_seek(file, offset, SEEK_SET);
+		vfs_read(paddr, 1, size, file);
+		cached = elf_cache_put(file->node, ARC_ELF_CACHE_FILE, offset, pages_size, paddr) == 0;
+	}
+
 	retry:;
 
-	void *vaddr = (hint == NULL ? vmm_alloc(vmeta, size) : hint);
+	vaddr = (hint == NULL ? vmm_alloc(vmeta, size) : hint);
 
 	if (vaddr == NULL) {
+		vm_release_pages(paddr, cached);
+		process_uncharge_mapping(process, size, file != NULL);
+		vm_release_backing(backing);
 		return -3;
 	}
 
 	// TODO: Properly set the flags
 	uint32_t flags = (1 << ARC_PAGER_US) | (1 << ARC_PAGER_RW);
 
-	if (pager_map(desc->process->page_tables.user, (uintptr_t)vaddr, ARC_HHDM_TO_PHYS(paddr), size, flags) != 0) {
+	if (cacheable) {
+		flags = (1 << ARC_PAGER_US) | (!(_prot & PROT_EXEC) << ARC_PAGER_NX);
+	}
+
+	if (pager_map(process->page_tables.user, (uintptr_t)vaddr, ARC_HHDM_TO_PHYS(paddr), size, flags) != 0) {
 		if (hint != NULL) {
 			hint = NULL;
 			goto retry;
 		} else {
+			vm_release_pages(paddr, cached);
+			process_uncharge_mapping(process, size, file != NULL);
+			vm_release_backing(backing);
 			return -4;
 		}
 	}
@@ -214,54 +521,549 @@ static int syscall_vm_map(void *hint, unsigned long size, uint64_t prot_flags, i
 	// NOTE: This call can fail, the page fault handler should
 	//       take care of the case when such a memory region needs
 	//       to be accessed and isn't already mapped in
-	pager_map(desc->process->page_tables.kernel, (uintptr_t)vaddr, ARC_HHDM_TO_PHYS(paddr), size, flags);
+	pager_map(process->page_tables.kernel, (uintptr_t)vaddr, ARC_HHDM_TO_PHYS(paddr), size, flags);
 
-	if (fd >= 0 && fd <= ARC_PROCESS_FILE_LIMIT - 1) {
-		struct ARC_File *file = desc->process->file_table[fd];
+	long length = 0;
 
-		if (file != NULL) {
-			vfs_seek(file, offset, SEEK_SET);
-			vfs_read(vaddr, 1, size, file);
-			// TODO: Should the previous offset be restored?
-		}
+	if (file != NULL && !cacheable) {
+		vfs_seek(file, offset, SEEK_SET);
+		length = vfs_read(paddr, 1, size, file);
+		// TODO: Should the previous offset be restored?
 	}
 
-	*ptr = vaddr;
+	int tracked = -1;
 
-	return 0;
+	if (backing != NULL) {
+		tracked = process_add_file_region(process, vaddr, paddr, size, flags, backing, offset, length > 0 ? length : 0);
+	} else {
+		tracked = process_add_region(process, vaddr, paddr, size, flags, file != NULL, cached);
+	}
+
+	if (tracked != 0) {
+		ARC_DEBUG(ERR, "Failed to track mapping, it will outlive the process\n");
+		vm_release_backing(backing);
+	}
+
+	return copy_to_user(ptr, &vaddr, sizeof(vaddr));
 }
 
 static int syscall_vm_unmap(void *address, unsigned long size) {
-	if (size == 0) {
+	if (size == 0 || !user_access_ok(address, size)) {
 		return -1;
 	}
 
-	struct ARC_ProcessorDescriptor *desc = smp_get_proc_desc();
-	struct ARC_VMMMeta *vmeta = desc->thread->parent->allocator;
+	ARC_Process *process = current_process();
+	struct ARC_VMMMeta *vmeta = process->allocator;
+
+	// Must be resident to be unmapped
+	if (process_swap_fault(process, address) == -3) {
+		return -1;
+	}
+
+	ARC_ProcessRegion *region = process_remove_region(process, address);
+
+	if (region != NULL && region->pages != NULL) {
+		// Backed page by page, some of which may be shared
+		vmm_free(vmeta, address);
+		ksm_release_region(process, region);
+		process_uncharge_mapping(process, region->size, region->file);
+		free(region);
+
+		return 0;
+	}
+
+	if (region != NULL && region->ipc != NULL) {
+		vmm_free(vmeta, address);
+		ipc_release_region(process, region);
+		process_uncharge_mapping(process, region->size, false);
+		free(region);
+
+		return 0;
+	}
 
 	vmm_free(vmeta, address);
 	void *paddr = NULL;
-	if (pager_unmap(desc->process->page_tables.user, (uintptr_t)address, size, &paddr) != 0) {
+	if (pager_unmap(process->page_tables.user, (uintptr_t)address, size, &paddr) != 0) {
 		ARC_DEBUG(ERR, "I do not know how to recover from this\n");
 		ARC_HANG;
 	}
 
-	if (pager_unmap(desc->process->page_tables.kernel, (uintptr_t)address, size, NULL) != 0) {
+	if (pager_unmap(process->page_tables.kernel, (uintptr_t)address, size, NULL) != 0) {
 		ARC_DEBUG(ERR, "I do not know how to recover from this\n");
 		ARC_HANG;
 	}
 
-	pmm_free(paddr);
+	if (region != NULL && region->cached) {
+		vm_release_pages(region->phys, true);
+	} else {
+		process_write_back_region(region);
+		pmm_free(paddr);
+	}
+
+	if (region != NULL) {
+		process_uncharge_mapping(process, region->size, region->file);
+		free(region);
+	}
+
+	return 0;
+}
+
+static int syscall_copy_file_range(int fd_in, long *off_in, int fd_out, long *off_out, unsigned long count, long *copied) {
+	struct ARC_File *in = get_file(fd_in);
+	struct ARC_File *out = get_file(fd_out);
+	long total = 0;
+
+	if (in == NULL || out == NULL || copy_to_user(copied, &total, sizeof(total)) != 0) {
+		return -1;
+	}
+
+	long start_in = 0;
+	long start_out = 0;
+
+	if ((off_in != NULL && copy_from_user(&start_in, off_in, sizeof(start_in)) != 0)
+	    || (off_out != NULL && copy_from_user(&start_out, off_out, sizeof(start_out)) != 0)) {
+		return -1;
+	}
+
+	// NOTE: If an explicit offset is given, the file's own offset is
+	//       left as it was, like pread / pwrite
+	long in_restore = -1;
+	long out_restore = -1;
+
+	if (off_in != NULL) {
+		in_restore = vfs_seek(in, 0, SEEK_CUR);
+		vfs_seek(in, start_in, SEEK_SET);
+	}
+
+	if (off_out != NULL) {
+		out_restore = vfs_seek(out, 0, SEEK_CUR);
+		vfs_seek(out, start_out, SEEK_SET);
+	}
+
+	// The data only ever passes through this kernel buffer, userspace
+	// never sees it
+	size_t chunk = count < COPY_RANGE_CHUNK ? ALIGN(count, PAGE_SIZE) : COPY_RANGE_CHUNK;
+	void *buffer = chunk == 0 ? NULL : pmm_alloc(chunk);
+
+	if (buffer == NULL && chunk != 0) {
+		if (off_in != NULL) {
+			vfs_seek(in, in_restore, SEEK_SET);
+		}
+
+		if (off_out != NULL) {
+			vfs_seek(out, out_restore, SEEK_SET);
+		}
+
+		return -2;
+	}
+
+	while ((unsigned long)total < count) {
+		size_t want = count - total;
+		if (want > chunk) {
+			want = chunk;
+		}
+
+		long got = vfs_read(buffer, 1, want, in);
+
+		if (got <= 0) {
+			break;
+		}
+
+		long put = vfs_write(buffer, 1, got, out);
+
+		if (put > 0) {
+			total += put;
+		}
+
+		if (put != got) {
+			// Short write, put back what did not make it
+			vfs_seek(in, -(got - (put > 0 ? put : 0)), SEEK_CUR);
+			break;
+		}
+	}
+
+	if (buffer != NULL) {
+		pmm_free(buffer);
+	}
+
+	if (total > 0) {
+		elf_cache_invalidate(out->node);
+	}
+
+	if (off_in != NULL) {
+		start_in += total;
+		copy_to_user(off_in, &start_in, sizeof(start_in));
+		vfs_seek(in, in_restore, SEEK_SET);
+	}
+
+	if (off_out != NULL) {
+		start_out += total;
+		copy_to_user(off_out, &start_out, sizeof(start_out));
+		vfs_seek(out, out_restore, SEEK_SET);
+	}
+
+	return copy_to_user(copied, &total, sizeof(total));
+}
+
+static int syscall_libc_log(const char *str) {
+	char line[LOG_LIMIT + 1];
+
+	long len = strncpy_from_user(line, str, LOG_LIMIT);
+
+	// A truncated line is still worth logging
+	if (len < 0 && len != -3) {
+		return -1;
+	}
+
+	len = strlen(line);
+	line[len++] = '\n';
+
+	log_write(line, len);
 
 	return 0;
 }
 
-static int syscall_libc_log(const char *str) {	
-	printf("%s\n", str);
+static int syscall_log_read(uint64_t *cursor, void *buffer, unsigned long count, long *read, uint64_t *dropped) {
+	long ret = log_read_user(cursor, buffer, count);
+
+	if (ret < 0) {
+		return -1;
+	}
+
+	uint64_t lost = log_get_dropped();
+
+	if (dropped != NULL && copy_to_user(dropped, &lost, sizeof(lost)) != 0) {
+		return -1;
+	}
+
+	return copy_to_user(read, &ret, sizeof(ret));
+}
+
+static int syscall_epoll_ctl(int op, int fd, ARC_EPollEvent *event) {
+	ARC_EPollEvent copy = { 0 };
+
+	if (event != NULL && copy_from_user(&copy, event, sizeof(copy)) != 0) {
+		return -1;
+	}
+
+	return epoll_ctl(current_process(), op, fd, event == NULL ? NULL : &copy);
+}
+
+static int syscall_epoll_wait(ARC_EPollEvent *events, int max, long timeout_ms, int *count) {
+	// A negative timeout waits forever, zero only polls
+	int ret = epoll_wait(current_process(), events, max, timeout_ms < 0 ? -1 : timeout_ms);
+
+	if (ret < 0) {
+		return -1;
+	}
+
+	return copy_to_user(count, &ret, sizeof(ret));
+}
+
+static int syscall_thread_exit(int code) {
+	thread_exit(smp_get_proc_desc()->thread, code);
+
+	// The thread has exited, it will not be picked again
+	while (1) {
+		sched_yield_cpu();
+	}
 
 	return 0;
 }
 
+static int syscall_thread_join(uint64_t tid, int *code) {
+	int ret = 0;
+
+	if (code != NULL && !user_access_ok(code, sizeof(*code))) {
+		return -1;
+	}
+
+	if (thread_join(current_process(), tid, &ret) != 0) {
+		return -1;
+	}
+
+	if (code != NULL) {
+		return copy_to_user(code, &ret, sizeof(ret));
+	}
+
+	return 0;
+}
+
+static int syscall_swap_stats(ARC_SwapStats *stats) {
+	ARC_Process *process = current_process();
+
+	spinlock_lock(&process->lock);
+	ARC_SwapStats copy = process->swap;
+	spinlock_unlock(&process->lock);
+
+	return copy_to_user(stats, &copy, sizeof(copy));
+}
+
+static int syscall_vm_merge(void *address) {
+	return ksm_enable_region(current_process(), address) == 0 ? 0 : -1;
+}
+
+static int syscall_ksm_stats(ARC_KSMStats *stats) {
+	ARC_KSMStats copy = { 0 };
+	ksm_get_stats(&copy);
+
+	return copy_to_user(stats, &copy, sizeof(copy));
+}
+
+static int syscall_mem_stats(ARC_ProcessMemory *stats) {
+	ARC_Process *process = current_process();
+	ARC_ProcessMemory copy = { 0 };
+
+	for (int i = 0; i < ARC_PROCESS_MEM_TYPES; i++) {
+		copy.counters[i] = __atomic_load_n(&process->memory.counters[i], __ATOMIC_RELAXED);
+	}
+
+	copy.total = __atomic_load_n(&process->memory.total, __ATOMIC_RELAXED);
+	copy.soft_limit = process->memory.soft_limit;
+	copy.hard_limit = process->memory.hard_limit;
+
+	return copy_to_user(stats, &copy, sizeof(copy));
+}
+
+// A process may only tighten its own limits, 0 keeps a limit as is
+static int syscall_mem_limit(uint64_t soft, uint64_t hard) {
+	ARC_Process *process = current_process();
+	uint64_t cur_soft = process->memory.soft_limit;
+	uint64_t cur_hard = process->memory.hard_limit;
+
+	if ((soft != 0 && cur_soft != 0 && soft > cur_soft) || (hard != 0 && cur_hard != 0 && hard > cur_hard)) {
+		return -1;
+	}
+
+	return process_set_limits(process, soft == 0 ? cur_soft : soft, hard == 0 ? cur_hard : hard);
+}
+
+// Without a buffer, the stats go to the kernel log, either way they are
+// cleared afterwards if reset is set
+static int syscall_spawn_stats(ARC_SpawnStats *stats, int reset) {
+	int ret = 0;
+
+	if (stats == NULL) {
+		spawn_stats_dump();
+	} else {
+		ARC_SpawnStats copy = { 0 };
+		spawn_stats_get(&copy);
+		ret = copy_to_user(stats, &copy, sizeof(copy));
+	}
+
+	if (reset && ret == 0) {
+		spawn_stats_reset();
+	}
+
+	return ret;
+}
+
+// Masks are of APIC ids, with process_default set tid is ignored and the
+// mask applies to threads the process creates from now on
+static int syscall_affinity_set(uint64_t tid, uint64_t mask, int process_default) {
+	ARC_Process *process = current_process();
+	uint64_t slots = affinity_slots_from_cpus(mask);
+
+	if (process_default) {
+		return affinity_set_default(process, slots);
+	}
+
+	return affinity_set(process, tid, slots);
+}
+
+// last is the APIC id of the processor the thread last ran on,
+// ARC_AFFINITY_NONE if it has not run yet
+static int syscall_affinity_get(uint64_t tid, uint64_t *mask, uint32_t *last) {
+	uint64_t _mask = 0;
+	uint32_t _last = 0;
+
+	if (affinity_get(current_process(), tid, &_mask, &_last) != 0) {
+		return -1;
+	}
+
+	int64_t id = _last == ARC_AFFINITY_NONE ? -1 : percpu_cpu_id(_last);
+
+	_mask = affinity_cpus_from_slots(_mask);
+	_last = id < 0 ? ARC_AFFINITY_NONE : (uint32_t)id;
+
+	if (copy_to_user(mask, &_mask, sizeof(_mask)) != 0 || copy_to_user(last, &_last, sizeof(_last)) != 0) {
+		return -1;
+	}
+
+	return 0;
+}
+
+// Names are copied in by the caller, NULL if name is
+static int ipc_copy_name(char *dst, const char *name) {
+	if (name == NULL) {
+		return 1;
+	}
+
+	return strncpy_from_user(dst, name, ARC_IPC_NAME_LIMIT) < 0 ? -1 : 0;
+}
+
+static int syscall_pipe_create(const char *name, int *handles) {
+	char _name[ARC_IPC_NAME_LIMIT];
+	int _handles[2] = { -1, -1 };
+	int named = ipc_copy_name(_name, name);
+
+	if (named < 0 || !user_access_ok(handles, sizeof(_handles))) {
+		return -1;
+	}
+
+	if (pipe_create(current_process(), named == 0 ? _name : NULL, _handles) != 0) {
+		return -1;
+	}
+
+	return copy_to_user(handles, _handles, sizeof(_handles));
+}
+
+static int syscall_pipe_open(const char *name, int end, int *handle) {
+	char _name[ARC_IPC_NAME_LIMIT];
+
+	if (ipc_copy_name(_name, name) != 0 || !user_access_ok(handle, sizeof(*handle))) {
+		return -1;
+	}
+
+	int ret = pipe_open(current_process(), _name, end);
+
+	if (ret < 0) {
+		return -1;
+	}
+
+	return copy_to_user(handle, &ret, sizeof(ret));
+}
+
+static int syscall_ipc_close(int handle) {
+	return ipc_close(current_process(), handle);
+}
+
+static int syscall_pipe_write(int handle, void const *buffer, unsigned long count, int flags, long *written) {
+	if (!user_access_ok(written, sizeof(*written))) {
+		return -1;
+	}
+
+	long ret = pipe_write(current_process(), handle, buffer, count, flags);
+
+	if (ret < 0) {
+		return ret;
+	}
+
+	return copy_to_user(written, &ret, sizeof(ret));
+}
+
+static int syscall_pipe_read(int handle, void *buffer, unsigned long count, int flags, long *read) {
+	if (!user_access_ok(read, sizeof(*read))) {
+		return -1;
+	}
+
+	long ret = pipe_read(current_process(), handle, buffer, count, flags);
+
+	if (ret < 0) {
+		return ret;
+	}
+
+	return copy_to_user(read, &ret, sizeof(ret));
+}
+
+static int syscall_pipe_read_map(int handle, int flags, void **ptr, long *size) {
+	void *vaddr = NULL;
+
+	if (!user_access_ok(ptr, sizeof(*ptr)) || !user_access_ok(size, sizeof(*size))) {
+		return -1;
+	}
+
+	long ret = pipe_read_map(current_process(), handle, &vaddr, flags);
+
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (copy_to_user(ptr, &vaddr, sizeof(vaddr)) != 0) {
+		return -1;
+	}
+
+	return copy_to_user(size, &ret, sizeof(ret));
+}
+
+static int syscall_ipc_buffer_map(unsigned long size, void **ptr) {
+	if (!user_access_ok(ptr, sizeof(*ptr))) {
+		return -1;
+	}
+
+	void *vaddr = ipc_buffer_map(current_process(), size);
+
+	if (vaddr == NULL) {
+		return -2;
+	}
+
+	return copy_to_user(ptr, &vaddr, sizeof(vaddr));
+}
+
+static int syscall_shm_map(const char *name, unsigned long size, int create, void **ptr) {
+	char _name[ARC_IPC_NAME_LIMIT];
+
+	if (ipc_copy_name(_name, name) != 0 || !user_access_ok(ptr, sizeof(*ptr))) {
+		return -1;
+	}
+
+	void *vaddr = shm_map(current_process(), _name, size, create != 0);
+
+	if (vaddr == NULL) {
+		return -2;
+	}
+
+	return copy_to_user(ptr, &vaddr, sizeof(vaddr));
+}
+
+static int syscall_ipc_unlink(const char *name) {
+	char _name[ARC_IPC_NAME_LIMIT];
+
+	if (ipc_copy_name(_name, name) != 0) {
+		return -1;
+	}
+
+	return ipc_unlink(_name);
+}
+
+// Instances return from here too, with *id as it was before the call
+static int syscall_template_capture(int *id) {
+	if (!user_access_ok(id, sizeof(*id))) {
+		return -1;
+	}
+
+	int _id = template_capture(current_process());
+
+	if (_id < 0) {
+		return -1;
+	}
+
+	if (copy_to_user(id, &_id, sizeof(_id)) != 0) {
+		template_destroy(current_process(), _id);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int syscall_template_spawn(int id, uint64_t *pid) {
+	if (!user_access_ok(pid, sizeof(*pid))) {
+		return -1;
+	}
+
+	ARC_Process *process = process_create_from_template(current_process(), id);
+
+	if (process == NULL) {
+		return -1;
+	}
+
+	return copy_to_user(pid, &process->pid, sizeof(process->pid));
+}
+
+static int syscall_template_destroy(int id) {
+	return template_destroy(current_process(), id);
+}
+
 uintptr_t Arc_SyscallTable[] = {
 	[0] =  (uintptr_t)syscall_tcb_set,
         [1] =  (uintptr_t)syscall_futex_wait,
@@ -276,4 +1078,37 @@ uintptr_t Arc_SyscallTable[] = {
         [10] = (uintptr_t)syscall_vm_map,
         [11] = (uintptr_t)syscall_vm_unmap,
         [12] = (uintptr_t)syscall_libc_log,
+        [13] = (uintptr_t)syscall_copy_file_range,
+        [14] = (uintptr_t)syscall_log_read,
+        [15] = (uintptr_t)syscall_sleep,
+        [16] = (uintptr_t)syscall_clock_nanosleep,
+        [17] = (uintptr_t)syscall_epoll_ctl,
+        [18] = (uintptr_t)syscall_epoll_wait,
+        [19] = (uintptr_t)syscall_thread_exit,
+        [20] = (uintptr_t)syscall_thread_join,
+        [21] = (uintptr_t)syscall_swap_stats,
+        [22] = (uintptr_t)syscall_vm_merge,
+        [23] = (uintptr_t)syscall_ksm_stats,
+        [24] = (uintptr_t)syscall_mem_stats,
+        [25] = (uintptr_t)syscall_mem_limit,
+        [26] = (uintptr_t)syscall_spawn_stats,
+        [27] = (uintptr_t)syscall_affinity_set,
+        [28] = (uintptr_t)syscall_affinity_get,
+        [29] = (uintptr_t)syscall_futex_lock_pi,
+        [30] = (uintptr_t)syscall_futex_unlock_pi,
+        [31] = (uintptr_t)syscall_futex_trylock_pi,
+        [32] = (uintptr_t)syscall_pipe_create,
+        [33] = (uintptr_t)syscall_pipe_open,
+        [34] = (uintptr_t)syscall_ipc_close,
+        [35] = (uintptr_t)syscall_pipe_write,
+        [36] = (uintptr_t)syscall_pipe_read,
+        [37] = (uintptr_t)syscall_pipe_read_map,
+        [38] = (uintptr_t)syscall_ipc_buffer_map,
+        [39] = (uintptr_t)syscall_shm_map,
+        [40] = (uintptr_t)syscall_ipc_unlink,
+        [41] = (uintptr_t)syscall_template_capture,
+        [42] = (uintptr_t)syscall_template_spawn,
+        [43] = (uintptr_t)syscall_template_destroy,
 };
+
+const size_t Arc_SyscallCount = sizeof(Arc_SyscallTable) / sizeof(*Arc_SyscallTable);
@@ -0,0 +1,497 @@
+/**
+ * @file template.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#include "abi-bits/seek-whence.h"
+#include "arch/context.h"
+#include "arch/smp.h"
+#include "fs/vfs.h"
+#include "global.h"
+#include "lib/spinlock.h"
+#include "lib/util.h"
+#include "mm/allocator.h"
+#include "mm/pmm.h"
+#include "mm/vmm.h"
+#include "userspace/affinity.h"
+#include "userspace/ksm.h"
+#include "userspace/loader.h"
+#include "userspace/process.h"
+#include "userspace/spawn_stats.h"
+#include "userspace/template.h"
+#include "userspace/thread.h"
+
+static struct {
+	ARC_Spinlock lock;
+	ARC_ProcessTemplate *slots[ARC_TEMPLATE_LIMIT];
+} templates = { 0 };
+
+int init_templates(void) {
+	init_static_spinlock(&templates.lock);
+
+	return 0;
+}
+
+static char *copy_path(const char *path) {
+	size_t len = strlen(path);
+	char *copy = (char *)alloc(len + 1);
+
+	if (copy != NULL) {
+		memcpy(copy, path, len + 1);
+	}
+
+	return copy;
+}
+
+static void template_free(ARC_ProcessTemplate *template) {
+	ARC_ProcessRegion *region = template->regions;
+
+	while (region != NULL) {
+		ARC_ProcessRegion *next = region->next;
+		process_release_region(NULL, region);
+		region = next;
+	}
+
+	if (template->program != NULL) {
+		uninit_program_loader(template->program);
+	}
+
+	for (int i = 0; i < ARC_PROCESS_FILE_LIMIT; i++) {
+		free(template->files[i].path);
+	}
+
+	if (template->thread.context != NULL) {
+		uninit_context(template->thread.context);
+	}
+
+	if (template->thread.stack != NULL) {
+		pmm_free(template->thread.stack);
+	}
+
+	free(template);
+}
+
+// The template with the given ID if process captured it
+static ARC_ProcessTemplate *template_get(ARC_Process *process, int id) {
+	if (process == NULL || id < 0 || id >= ARC_TEMPLATE_LIMIT) {
+		return NULL;
+	}
+
+	spinlock_lock(&templates.lock);
+
+	ARC_ProcessTemplate *template = templates.slots[id];
+
+	if (template != NULL && template->owner != process->pid) {
+		template = NULL;
+	}
+
+	if (template != NULL) {
+		__atomic_add_fetch(&template->refs, 1, __ATOMIC_RELAXED);
+	}
+
+	spinlock_unlock(&templates.lock);
+
+	return template;
+}
+
+static void template_put(ARC_ProcessTemplate *template) {
+	if (__atomic_sub_fetch(&template->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+		template_free(template);
+	}
+}
+
+static ARC_ProcessRegion *find_region(ARC_Process *process, void *virt) {
+	spinlock_lock(&process->lock);
+
+	ARC_ProcessRegion *region = process->regions;
+	while (region != NULL && region->virt != virt) {
+		region = region->next;
+	}
+
+	spinlock_unlock(&process->lock);
+
+	return region;
+}
+
+// Makes every region of process shared and takes a reference to it, end is
+// raised to the address right past the highest one
+static int capture_regions(ARC_ProcessTemplate *template, ARC_Process *process, uintptr_t *end) {
+	size_t count = 0;
+
+	spinlock_lock(&process->lock);
+	for (ARC_ProcessRegion *region = process->regions; region != NULL; region = region->next) {
+		count++;
+	}
+	spinlock_unlock(&process->lock);
+
+	if (count == 0) {
+		return 0;
+	}
+
+	void **addresses = (void **)alloc(sizeof(*addresses) * count);
+
+	if (addresses == NULL) {
+		return -1;
+	}
+
+	size_t i = 0;
+
+	spinlock_lock(&process->lock);
+	for (ARC_ProcessRegion *region = process->regions; region != NULL && i < count; region = region->next) {
+		addresses[i++] = region->virt;
+
+		uintptr_t top = (uintptr_t)region->virt + region->size;
+		*end = top > *end ? top : *end;
+	}
+	spinlock_unlock(&process->lock);
+
+	count = i;
+	int ret = 0;
+
+	for (i = 0; i < count; i++) {
+		ARC_ProcessRegion *region = find_region(process, addresses[i]);
+
+		if (region == NULL) {
+			continue;
+		}
+
+		// Cached and IPC memory is already shared
+		if (!region->cached && region->ipc == NULL && ksm_share_region(process, addresses[i]) != 0) {
+			ARC_DEBUG(ERR, "Failed to share region %p\n", addresses[i]);
+			ret = -2;
+			break;
+		}
+
+		ARC_ProcessRegion *copy = process_share_region(NULL, region);
+
+		if (copy == NULL) {
+			ARC_DEBUG(ERR, "Failed to reference region %p\n", addresses[i]);
+			ret = -3;
+			break;
+		}
+
+		copy->next = template->regions;
+		template->regions = copy;
+	}
+
+	free(addresses);
+
+	return ret;
+}
+
+static int capture_files(ARC_ProcessTemplate *template, ARC_Process *process) {
+	for (int i = 0; i < ARC_PROCESS_FILE_LIMIT; i++) {
+		ARC_File *file = process->file_table[i];
+
+		// Files not opened by path cannot be opened again
+		if (file == NULL || process->file_origin[i].path == NULL) {
+			continue;
+		}
+
+		long offset = vfs_seek(file, 0, SEEK_CUR);
+		char *path = copy_path(process->file_origin[i].path);
+
+		if (offset < 0 || path == NULL) {
+			free(path);
+			return -1;
+		}
+
+		template->files[i].path = path;
+		template->files[i].flags = process->file_origin[i].flags;
+		template->files[i].mode = process->file_origin[i].mode;
+		template->files[i].offset = offset;
+	}
+
+	return 0;
+}
+
+static int capture_thread(ARC_ProcessTemplate *template, ARC_Thread *thread) {
+	template->thread.priority = thread->priority;
+	template->thread.mask = __atomic_load_n(&thread->cpu.mask, __ATOMIC_RELAXED);
+	template->thread.tcb = thread->tcb;
+
+	// Saved as it returns from this very call
+	if ((template->thread.context = init_context(1 << ARC_CONTEXT_FLAG_FLOATS, &template->thread.features)) == NULL
+	    || context_save_syscall(template->thread.context, 0) != 0) {
+		ARC_DEBUG(ERR, "Failed to save thread context\n");
+		return -1;
+	}
+
+	// Not a region, so it cannot be shared and is copied instead
+	if ((template->thread.stack = pmm_alloc(thread->ustack.size)) == NULL) {
+		return -2;
+	}
+
+	memcpy(template->thread.stack, thread->ustack.phys, thread->ustack.size);
+	template->thread.stack_virt = thread->ustack.virt;
+	template->thread.stack_size = thread->ustack.size;
+
+	return 0;
+}
+
+int template_capture(ARC_Process *process) {
+	if (process == NULL) {
+		ARC_DEBUG(ERR, "Improper arguments\n");
+		return -1;
+	}
+
+	spinlock_lock(&process->lock);
+
+	ARC_ThreadElement *elem = process->threads;
+	ARC_Thread *thread = elem != NULL && elem->next == NULL ? elem->t : NULL;
+
+	spinlock_unlock(&process->lock);
+
+	if (thread == NULL || thread != smp_get_proc_desc()->thread) {
+		ARC_DEBUG(ERR, "Process must have exactly one thread, the caller, to be captured\n");
+		return -2;
+	}
+
+	// Swapped out regions cannot be shared
+	if (process_swap_in(process) != 0) {
+		return -3;
+	}
+
+	ARC_ProcessTemplate *template = (ARC_ProcessTemplate *)alloc(sizeof(*template));
+
+	if (template == NULL) {
+		return -4;
+	}
+
+	memset(template, 0, sizeof(*template));
+	template->refs = 1;
+	template->owner = process->pid;
+	template->userspace = process->userspace;
+	template->priority = process->priority;
+	template->affinity = __atomic_load_n(&process->affinity, __ATOMIC_RELAXED);
+	template->soft_limit = process->memory.soft_limit;
+	template->hard_limit = process->memory.hard_limit;
+
+	uintptr_t end = (uintptr_t)thread->ustack.virt + thread->ustack.size;
+
+	if (capture_regions(template, process, &end) != 0 || capture_files(template, process) != 0
+	    || capture_thread(template, thread) != 0) {
+		goto fail;
+	}
+
+	if (process->program != NULL && (template->program = program_loader_clone(process->program, NULL)) == NULL) {
+		ARC_DEBUG(ERR, "Failed to clone program image\n");
+		goto fail;
+	}
+
+	template->arena = ALIGN(end, PAGE_SIZE);
+
+	ARC_ProgramMeta *meta = process->program;
+	uintptr_t arena_end = template->arena + ARC_TEMPLATE_ARENA_SIZE;
+
+	if (meta != NULL && ((meta->address_limit != 0 && arena_end > meta->address_limit)
+	    || (meta->aux.base != 0 && template->arena < meta->aux.base && arena_end > meta->aux.base))) {
+		ARC_DEBUG(ERR, "No room for the allocator of instances\n");
+		goto fail;
+	}
+
+	spinlock_lock(&templates.lock);
+
+	int id = 0;
+	while (id < ARC_TEMPLATE_LIMIT && templates.slots[id] != NULL) {
+		id++;
+	}
+
+	if (id < ARC_TEMPLATE_LIMIT) {
+		templates.slots[id] = template;
+	}
+
+	spinlock_unlock(&templates.lock);
+
+	if (id == ARC_TEMPLATE_LIMIT) {
+		ARC_DEBUG(ERR, "Out of template slots\n");
+		goto fail;
+	}
+
+	ARC_DEBUG(INFO, "Captured process %lu as template %d\n", process->pid, id);
+
+	return id;
+
+	fail:;
+	template_free(template);
+
+	return -5;
+}
+
+int template_destroy(ARC_Process *process, int id) {
+	if (process == NULL || id < 0 || id >= ARC_TEMPLATE_LIMIT) {
+		return -1;
+	}
+
+	spinlock_lock(&templates.lock);
+
+	ARC_ProcessTemplate *template = templates.slots[id];
+
+	if (template != NULL && template->owner == process->pid) {
+		templates.slots[id] = NULL;
+	} else {
+		template = NULL;
+	}
+
+	spinlock_unlock(&templates.lock);
+
+	if (template == NULL) {
+		return -2;
+	}
+
+	template_put(template);
+
+	return 0;
+}
+
+void template_release_owner(ARC_Process *process) {
+	if (process == NULL) {
+		return;
+	}
+
+	for (int id = 0; id < ARC_TEMPLATE_LIMIT; id++) {
+		template_destroy(process, id);
+	}
+}
+
+static int instance_files(ARC_Process *process, ARC_ProcessTemplate *template) {
+	for (int i = 0; i < ARC_PROCESS_FILE_LIMIT; i++) {
+		if (template->files[i].path == NULL) {
+			continue;
+		}
+
+		ARC_File *file = NULL;
+		char *path = copy_path(template->files[i].path);
+
+		if (path == NULL || vfs_open(path, template->files[i].flags, template->files[i].mode, &file) != 0) {
+			ARC_DEBUG(ERR, "Failed to reopen %s\n", template->files[i].path);
+			free(path);
+			return -1;
+		}
+
+		process->file_table[i] = file;
+		process->file_origin[i].path = path;
+		process->file_origin[i].flags = template->files[i].flags;
+		process->file_origin[i].mode = template->files[i].mode;
+
+		if (vfs_seek(file, template->files[i].offset, SEEK_SET) < 0) {
+			return -2;
+		}
+	}
+
+	return 0;
+}
+
+static ARC_Thread *instance_thread(ARC_Process *process, ARC_ProcessTemplate *template) {
+	ARC_Thread *main = thread_create_from(process, template->thread.context, template->thread.stack_virt, template->thread.stack,
+					      template->thread.stack_size, template->thread.tcb);
+
+	if (main == NULL) {
+		return NULL;
+	}
+
+	main->priority = template->thread.priority;
+
+	if (template->thread.mask != template->affinity) {
+		affinity_set(process, main->tid, template->thread.mask);
+	}
+
+	return main;
+}
+
+ARC_Process *process_create_from_template(ARC_Process *caller, int id) {
+	uint64_t start = spawn_stats_start();
+	ARC_ProcessTemplate *template = template_get(caller, id);
+
+	if (template == NULL) {
+		ARC_DEBUG(ERR, "No template %d\n", id);
+		return NULL;
+	}
+
+	ARC_Process *process = process_create(template->userspace, NULL);
+
+	if (process == NULL) {
+		ARC_DEBUG(ERR, "Failed to allocate process\n");
+		template_put(template);
+		return NULL;
+	}
+
+	// Everything inherited lies below the arena
+	ARC_VMMMeta *vmm = init_vmm((void *)template->arena, ARC_TEMPLATE_ARENA_SIZE);
+
+	if (vmm == NULL) {
+		ARC_DEBUG(ERR, "Failed to create instance allocator\n");
+		goto fail;
+	}
+
+	uninit_vmm(process->allocator);
+	process->allocator = vmm;
+
+	process->priority = template->priority;
+	affinity_set_default(process, template->affinity);
+	process_set_limits(process, template->soft_limit, template->hard_limit);
+
+	if (template->program != NULL) {
+		void *page_table = template->userspace ? process->page_tables.user : process->page_tables.kernel;
+
+		ARC_ProgramMeta *program = program_loader_clone(template->program, page_table);
+
+		if (program == NULL) {
+			ARC_DEBUG(ERR, "Failed to clone program image\n");
+			goto fail;
+		}
+
+		if (process_charge_mapping(process, program->size, true) != 0) {
+			ARC_DEBUG(ERR, "Program image is over the memory limit\n");
+			uninit_program_loader(program);
+			goto fail;
+		}
+
+		process->program = program;
+	}
+
+	for (ARC_ProcessRegion *region = template->regions; region != NULL; region = region->next) {
+		if (process_share_region(process, region) == NULL) {
+			ARC_DEBUG(ERR, "Failed to map region %p\n", region->virt);
+			goto fail;
+		}
+	}
+
+	if (instance_files(process, template) != 0 || instance_thread(process, template) == NULL) {
+		goto fail;
+	}
+
+	template_put(template);
+
+	ARC_DEBUG(INFO, "Created process %lu from template %d\n", process->pid, id);
+	spawn_stats_record(ARC_SPAWN_FROM_TEMPLATE, start);
+
+	return process;
+
+	fail:;
+	process_delete(process);
+	template_put(template);
+
+	return NULL;
+}
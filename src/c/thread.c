@@ -34,28 +34,202 @@
 #include "mm/pmm.h"
 #include "mm/vmm.h"
 #include "mp/scheduler.h"
+#include "userspace/loader.h"
+#include "userspace/loaders/elf.h"
 #include "userspace/process.h"
 #include <stdio.h>
 #include "userspace/thread.h"
+#include "userspace/affinity.h"
+#include "userspace/futex.h"
+#include "userspace/reaper.h"
+#include "userspace/spawn_stats.h"
 #include "arch/convention.h"
+#include "arch/smp.h"
+
+#define THREAD_CACHE_SIZE 16
+
+// Recently freed thread resources, handed back out by thread_create
+struct thread_cache {
+	ARC_Spinlock lock;
+	int count;
+	void *entries[THREAD_CACHE_SIZE];
+	size_t sizes[THREAD_CACHE_SIZE];
+};
 
 static uint64_t tid_counter = 0;
+static struct thread_cache thread_structs = { 0 };
+static struct thread_cache kstacks = { 0 };
+static struct thread_cache ustacks = { 0 };
 
-ARC_Thread *thread_create(ARC_Process *process, void *entry, size_t stack_size) {
-	if (process == NULL || entry == NULL || stack_size == 0) {
-		ARC_DEBUG(ERR, "Failed to create thread, improper parameters (%p %lu)\n", entry, stack_size);
-		return NULL;
+int init_thread_caches(void) {
+	init_static_spinlock(&thread_structs.lock);
+	init_static_spinlock(&kstacks.lock);
+	init_static_spinlock(&ustacks.lock);
+
+	return 0;
+}
+
+static void *cache_take(struct thread_cache *cache, size_t size) {
+	void *entry = NULL;
+
+	spinlock_lock(&cache->lock);
+
+	for (int i = cache->count - 1; i >= 0; i--) {
+		if (cache->sizes[i] != size) {
+			continue;
+		}
+
+		entry = cache->entries[i];
+		cache->count--;
+		cache->entries[i] = cache->entries[cache->count];
+		cache->sizes[i] = cache->sizes[cache->count];
+
+		break;
 	}
 
-	ARC_Thread *thread = (struct ARC_Thread *)alloc(sizeof(*thread));
+	spinlock_unlock(&cache->lock);
 
-	if (thread == NULL) {
+	return entry;
+}
+
+static int cache_put(struct thread_cache *cache, void *entry, size_t size) {
+	int ret = -1;
+
+	spinlock_lock(&cache->lock);
+
+	if (cache->count < THREAD_CACHE_SIZE) {
+		cache->entries[cache->count] = entry;
+		cache->sizes[cache->count] = size;
+		cache->count++;
+		ret = 0;
+	}
+
+	spinlock_unlock(&cache->lock);
+
+	return ret;
+}
+
+static void thread_free_kstack(ARC_Thread *thread) {
+	if (thread->kstack.hhdm != NULL && cache_put(&kstacks, thread->kstack.hhdm, thread->kstack.size) != 0) {
+		free(thread->kstack.hhdm);
+	}
+
+	thread->kstack.hhdm = NULL;
+}
+
+static void thread_free_ustack(ARC_Thread *thread) {
+	if (thread->ustack.phys != NULL && cache_put(&ustacks, thread->ustack.phys, thread->ustack.size) != 0) {
+		pmm_free(thread->ustack.phys);
+	}
+
+	thread->ustack.phys = NULL;
+}
+
+static void thread_free_struct(ARC_Thread *thread) {
+	if (cache_put(&thread_structs, thread, sizeof(*thread)) != 0) {
+		free(thread);
+	}
+}
+
+// Only for a thread that is not running, the stack may still be mapped
+static void thread_unmap_ustack(ARC_Thread *thread) {
+	ARC_Process *process = thread->parent;
+
+	if (process == NULL || thread->ustack.virt == NULL) {
+		return;
+	}
+
+	pager_unmap(process->page_tables.user, (uintptr_t)thread->ustack.virt, thread->ustack.size, NULL);
+
+	if (!thread->ustack.fixed) {
+		vmm_free(process->allocator, thread->ustack.virt);
+	}
+
+	thread->ustack.virt = NULL;
+
+	// The kernel stack goes later, but it no longer belongs to the process
+	process_uncharge_mapping(process, thread->ustack.size, false);
+	process_uncharge(process, ARC_PROCESS_MEM_KSTACKS, thread->kstack.size);
+}
+
+// Bytes needed past the stack for the TLS block of the program and the TCB
+static size_t thread_tls_size(ARC_ProgramTLS *tls) {
+	if (tls == NULL) {
+		return 0;
+	}
+
+	return ALIGN(ALIGN(tls->mem_size, tls->align) + ARC_THREAD_TCB_SIZE, PAGE_SIZE);
+}
+
+// Variant II layout, the block ends where the TCB starts and the first word of
+// the TCB points to itself, returns the thread pointer
+static void *thread_setup_tls(ARC_Thread *thread, ARC_ProgramTLS *tls, size_t stack_size) {
+	size_t offset = stack_size + ALIGN(tls->mem_size, tls->align);
+	uint8_t *phys = (uint8_t *)thread->ustack.phys;
+	uint8_t *block = phys + offset - ALIGN(tls->mem_size, tls->align);
+
+	memset(phys + stack_size, 0, thread->ustack.size - stack_size);
+	memcpy(block, tls->image, tls->file_size);
+
+	uintptr_t tp = (uintptr_t)thread->ustack.virt + offset;
+	*(uintptr_t *)(phys + offset) = tp;
+
+	return (void *)tp;
+}
+
+// Undoes thread_build
+static void thread_discard(ARC_Process *process, ARC_Thread *thread) {
+	affinity_remove(thread);
+
+	process_uncharge_mapping(process, thread->ustack.size, false);
+	process_uncharge(process, ARC_PROCESS_MEM_KSTACKS, ARC_STD_KSTACK_SIZE);
+
+	if (thread->context != NULL) {
+		uninit_context(thread->context);
+	}
+
+	thread_free_ustack(thread);
+
+	if (thread->ustack.virt != NULL && !thread->ustack.fixed) {
+		vmm_free(process->allocator, thread->ustack.virt);
+	}
+
+	thread_free_kstack(thread);
+	thread_free_struct(thread);
+}
+
+// Allocates a thread with its context and stacks, the user stack of map_size
+// bytes is mapped at virt, or wherever the process's allocator puts it if virt
+// is NULL. The scheduler cannot see the thread until thread_start
+static ARC_Thread *thread_build(ARC_Process *process, size_t map_size, void *virt) {
+	ARC_Thread *thread = cache_take(&thread_structs, sizeof(*thread));
+
+	if (thread == NULL && (thread = (struct ARC_Thread *)alloc(sizeof(*thread))) == NULL) {
 		ARC_DEBUG(ERR, "Failed to allocate thread\n");
 		return NULL;
 	}
 
 	memset(thread, 0, sizeof(*thread));
 	init_static_spinlock(&thread->lock);
+	thread->exit.refs = 2;
+	thread->cpu.mask = __atomic_load_n(&process->affinity, __ATOMIC_RELAXED);
+	thread->cpu.last = ARC_AFFINITY_NONE;
+	thread->cpu.target = ARC_AFFINITY_NONE;
+	thread->pi.boost = -1;
+	thread->ustack.size = map_size;
+
+	if (process_charge_mapping(process, map_size, false) != 0) {
+		ARC_DEBUG(ERR, "Failed to create thread, process %lu is over its memory limit\n", process->pid);
+		thread_free_struct(thread);
+		return NULL;
+	}
+
+	if (process_charge(process, ARC_PROCESS_MEM_KSTACKS, ARC_STD_KSTACK_SIZE) != 0) {
+		ARC_DEBUG(ERR, "Failed to create thread, process %lu is over its memory limit\n", process->pid);
+		process_uncharge_mapping(process, map_size, false);
+		thread_free_struct(thread);
+		return NULL;
+	}
 
 	if ((thread->context = init_context(1 << ARC_CONTEXT_FLAG_FLOATS, &thread->features)) == NULL) {
 		ARC_DEBUG(ERR, "Failed to initialize context\n");
@@ -63,66 +237,126 @@ ARC_Thread *thread_create(ARC_Process *process, void *entry, size_t stack_size)
 	}
 
         thread->kstack.size = ARC_STD_KSTACK_SIZE;
-        
-        if ((thread->kstack.hhdm = alloc(ARC_STD_KSTACK_SIZE)) == NULL) {
+
+        if ((thread->kstack.hhdm = cache_take(&kstacks, ARC_STD_KSTACK_SIZE)) == NULL
+	    && (thread->kstack.hhdm = alloc(ARC_STD_KSTACK_SIZE)) == NULL) {
                 ARC_DEBUG(ERR, "Failed to allocate kstack\n");
                 goto clean_up;
         }
-        
-	thread->ustack.size = stack_size;
 
-	if ((thread->ustack.phys = pmm_alloc(stack_size)) == NULL) {
+	if ((thread->ustack.phys = cache_take(&ustacks, map_size)) != NULL) {
+		// Last used by another thread, possibly of another process
+		memset(thread->ustack.phys, 0, map_size);
+	} else if ((thread->ustack.phys = pmm_alloc(map_size)) == NULL) {
 		ARC_DEBUG(ERR, "Failed to allocate physical memory for thread\n");
 		goto clean_up;
 	}
 
-	if ((thread->ustack.virt = (void *)vmm_alloc(process->allocator, stack_size)) == NULL) {
+	if (virt != NULL) {
+		thread->ustack.virt = virt;
+		thread->ustack.fixed = true;
+	} else if ((thread->ustack.virt = (void *)vmm_alloc(process->allocator, map_size)) == NULL) {
 		ARC_DEBUG(ERR, "Failed to allocate virtual memory for thread\n");
 		goto clean_up;
 	}
 
-	if (pager_map(process->page_tables.user, (uintptr_t)thread->ustack.virt, ARC_HHDM_TO_PHYS(thread->ustack.phys), stack_size,
+	if (pager_map(process->page_tables.user, (uintptr_t)thread->ustack.virt, ARC_HHDM_TO_PHYS(thread->ustack.phys), map_size,
 		      (1 << ARC_PAGER_RW) | (1 << ARC_PAGER_NX) | (process->userspace << ARC_PAGER_US)) != 0) {
 		ARC_DEBUG(ERR, "Failed to map memory for thread\n");
 		goto clean_up;
 	}
 
-        void *stack = (void *)STACK_START(thread->ustack.virt, thread->ustack.size, 16);
-        context_setup_for_thread(thread->context, entry, stack, process->page_tables.user, process->userspace);
+	return thread;
 
+	clean_up:;
+	thread_discard(process, thread);
+
+	return NULL;
+}
+
+// Makes a thread from thread_build ready and hands it to process
+static int thread_start(ARC_Process *process, ARC_Thread *thread) {
 	thread->state = ARC_THREAD_READY;
 	thread->tid = ARC_ATOMIC_INC(tid_counter);
+	affinity_place(thread);
 
 	if (process_associate_thread(process, thread) != 0) {
 		ARC_DEBUG(ERR, "Failed to associate thread with process\n");
-		pager_unmap(process->page_tables.user, (uintptr_t)thread->ustack.virt, stack_size, NULL);
-		goto clean_up;
+		pager_unmap(process->page_tables.user, (uintptr_t)thread->ustack.virt, thread->ustack.size, NULL);
+		thread_discard(process, thread);
+
+		return -1;
 	}
 
 	ARC_DEBUG(INFO, "Created thread %lu (%p)\n", thread->tid, thread);
 
+	return 0;
+}
+
+ARC_Thread *thread_create(ARC_Process *process, void *entry, size_t stack_size) {
+	if (process == NULL || entry == NULL || stack_size == 0) {
+		ARC_DEBUG(ERR, "Failed to create thread, improper parameters (%p %lu)\n", entry, stack_size);
+		return NULL;
+	}
+
+	uint64_t start = spawn_stats_start();
+
+	// The TLS block and TCB share the stack's allocation, right above it
+	stack_size = ALIGN(stack_size, PAGE_SIZE);
+	ARC_ProgramTLS *tls = process->program != NULL ? process->program->tls : NULL;
+	ARC_Thread *thread = thread_build(process, stack_size + thread_tls_size(tls), NULL);
+
+	if (thread == NULL) {
+		return NULL;
+	}
+
+        void *stack = (void *)STACK_START(thread->ustack.virt, stack_size, 16);
+        context_setup_for_thread(thread->context, entry, stack, process->page_tables.user, process->userspace);
+
+	if (tls != NULL) {
+		// Starts with fs ready, no tcb_set needed
+		thread->tcb = thread_setup_tls(thread, tls, stack_size);
+		context_set_tcb(thread->context, thread->tcb);
+	}
+
+	if (thread_start(process, thread) != 0) {
+		return NULL;
+	}
+
+	spawn_stats_record(ARC_SPAWN_THREAD_CREATE, start);
+
 	return thread;
+}
 
-	clean_up:;
-	if (thread->context != NULL) {
-		uninit_context(thread->context);
+ARC_Thread *thread_create_from(ARC_Process *process, ARC_Context *context, void *virt, const void *stack, size_t size, void *tcb) {
+	if (process == NULL || context == NULL || virt == NULL || stack == NULL || size == 0) {
+		ARC_DEBUG(ERR, "Failed to create thread, improper parameters\n");
+		return NULL;
 	}
 
-	if (thread->ustack.phys != NULL) {
-		pmm_free(thread->ustack.phys);
+	uint64_t start = spawn_stats_start();
+	ARC_Thread *thread = thread_build(process, size, virt);
+
+	if (thread == NULL) {
+		return NULL;
 	}
 
-	if (thread->ustack.virt != NULL) {
-		vmm_free(process->allocator, thread->ustack.virt);
+	// TLS block and TCB included, they sit in the same allocation
+	memcpy(thread->ustack.phys, stack, size);
+	context_setup_from(thread->context, context, process->page_tables.user, process->userspace);
+
+	if (tcb != NULL) {
+		thread->tcb = tcb;
+		context_set_tcb(thread->context, tcb);
 	}
 
-        if (thread->kstack.hhdm != NULL) {
-                free(thread->kstack.hhdm);
-        }
+	if (thread_start(process, thread) != 0) {
+		return NULL;
+	}
 
-	free(thread);
+	spawn_stats_record(ARC_SPAWN_THREAD_CREATE, start);
 
-	return NULL;
+	return thread;
 }
 
 int thread_delete(ARC_Thread *thread) {
@@ -131,11 +365,386 @@ int thread_delete(ARC_Thread *thread) {
 		return -1;
 	}
 
-	// TODO: Signal an exit to the thread?
+	// NOTE: The caller guarantees no processor is running the thread, if
+	//       it may still be, thread_exit is to be used instead
+
+	futex_pi_exit(thread);
+
+	spinlock_lock(&thread->lock);
+
+	affinity_remove(thread);
+	thread_unmap_ustack(thread);
+
+	if (thread->parent != NULL) {
+		process_disassociate_thread(thread->parent, thread);
+	}
+
+	if (thread->context != NULL) {
+		uninit_context(thread->context);
+		thread->context = NULL;
+	}
+
+	thread_free_ustack(thread);
+	thread_free_kstack(thread);
+
+	spinlock_unlock(&thread->lock);
+
+	// Both the running and the joining reference, a joiner that still
+	// looks at the thread holds a third
+	if (__atomic_sub_fetch(&thread->exit.refs, 2, __ATOMIC_ACQ_REL) == 0) {
+		thread_free_struct(thread);
+	}
+
+	return 0;
+}
+
+int thread_exit(ARC_Thread *thread, int code) {
+	if (thread == NULL) {
+		ARC_DEBUG(ERR, "Failed to exit thread, given thread is NULL\n");
+		return -1;
+	}
+
+	// Hand over held PI futexes while the futex words are still mapped
+	futex_pi_exit(thread);
+
+	// The kernel is on the kernel stack, the user stack can go now
+	thread_unmap_ustack(thread);
+	affinity_remove(thread);
+
+	spinlock_lock(&thread->lock);
+	thread->exit.code = code;
+	__atomic_store_n(&thread->exit.exited, 1, __ATOMIC_RELEASE);
+	ARC_Thread *joiner = thread->exit.joiner;
+	spinlock_unlock(&thread->lock);
+
+	if (joiner != NULL) {
+		thread_unpark(joiner);
+	}
+
+	// The rest is still in use until this processor switches away
+	return reaper_defer_thread(thread);
+}
+
+int thread_join(ARC_Process *process, uint64_t tid, int *code) {
+	if (process == NULL) {
+		ARC_DEBUG(ERR, "Failed to join thread, no process given\n");
+		return -1;
+	}
+
+	ARC_Thread *self = smp_get_proc_desc()->thread;
+	ARC_Thread *thread = NULL;
+
+	// Held until we are done with it, another joiner may get there
+	// first and let go of the thread
+	spinlock_lock(&process->lock);
+	for (ARC_ThreadElement *elem = process->threads; elem != NULL; elem = elem->next) {
+		if (elem->t->tid == tid) {
+			thread = elem->t;
+			ARC_ATOMIC_INC(thread->exit.refs);
+			break;
+		}
+	}
+	spinlock_unlock(&process->lock);
+
+	if (thread == NULL) {
+		return -2;
+	}
+
+	if (thread == self) {
+		thread_release(thread);
+		return -2;
+	}
 
 	spinlock_lock(&thread->lock);
 
-	free(thread);
+	if (thread->exit.joiner != NULL) {
+		spinlock_unlock(&thread->lock);
+		thread_release(thread);
+		return -3;
+	}
+
+	while (!thread->exit.exited) {
+		thread->exit.joiner = self;
+		thread_prepare_park(self);
+		spinlock_unlock(&thread->lock);
+
+		int stopped = thread_park(self);
+
+		spinlock_lock(&thread->lock);
+
+		if (stopped != 0 && !thread->exit.exited) {
+			thread->exit.joiner = NULL;
+			spinlock_unlock(&thread->lock);
+			thread_release(thread);
+			return -4;
+		}
+	}
+
+	if (code != NULL) {
+		*code = thread->exit.code;
+	}
+
+	spinlock_unlock(&thread->lock);
+
+	process_disassociate_thread(process, thread);
+	// The joining reference and our own
+	thread_release(thread);
+	thread_release(thread);
+
+	return 0;
+}
+
+int thread_reclaim(ARC_Thread *thread) {
+	if (thread == NULL) {
+		return -1;
+	}
+
+	uint64_t start = spawn_stats_start();
+
+	// NOTE: Contexts are not cached, init_context sets them up for the
+	//       features of the thread they are created for
+	if (thread->context != NULL) {
+		uninit_context(thread->context);
+		thread->context = NULL;
+	}
+
+	thread_free_kstack(thread);
+	thread_free_ustack(thread);
+
+	int ret = thread_release(thread);
+	spawn_stats_record(ARC_SPAWN_THREAD_RECLAIM, start);
+
+	return ret;
+}
+
+int thread_release(ARC_Thread *thread) {
+	if (thread == NULL) {
+		return -1;
+	}
+
+	if (ARC_ATOMIC_DEC(thread->exit.refs) == 0) {
+		thread_free_struct(thread);
+	}
+
+	return 0;
+}
+
+static ARC_ProgramTLS *thread_tls(ARC_Thread *thread) {
+	ARC_Process *process = thread->parent;
+
+	return process != NULL && process->program != NULL ? process->program->tls : NULL;
+}
+
+size_t thread_stack_size(ARC_Thread *thread) {
+	if (thread == NULL) {
+		return 0;
+	}
+
+	return thread->ustack.size - thread_tls_size(thread_tls(thread));
+}
+
+int thread_prepare_entry_stack_32(ARC_Thread *thread, ARC_ProgramMeta *meta, char **envp, int envc, char **argv, int argc) {
+	if (thread == NULL || meta == NULL || argc < 0 || envc < 0 || (argc > 0 && argv == NULL) || (envc > 0 && envp == NULL)) {
+		return -1;
+	}
+
+	size_t stack_size = thread_stack_size(thread);
+	uint8_t *phys = (uint8_t *)thread->ustack.phys;
+	uintptr_t virt = (uintptr_t)thread->ustack.virt;
+	size_t top = stack_size;
+
+	uint32_t auxv[][2] = {
+		{ AT_PHDR, meta->aux.phdr },
+		{ AT_PHENT, meta->aux.phent },
+		{ AT_PHNUM, meta->aux.phnum },
+		{ AT_PAGESZ, PAGE_SIZE },
+		{ AT_BASE, meta->aux.base },
+		{ AT_ENTRY, meta->aux.entry },
+		{ AT_NULL, 0 },
+	};
+
+	size_t words = 1 + (argc + 1) + (envc + 1) + sizeof(auxv) / sizeof(uint32_t);
+	uint32_t *vector = (uint32_t *)alloc(words * sizeof(uint32_t));
+
+	if (vector == NULL) {
+		return -2;
+	}
+
+	// Strings go at the very top, the words pointing at them below
+	size_t w = 0;
+	vector[w++] = argc;
+
+	for (int i = 0; i < argc + envc + 2; i++) {
+		char *string = i < argc ? argv[i] : (i > argc && i <= argc + envc ? envp[i - argc - 1] : NULL);
+
+		if (string == NULL) {
+			vector[w++] = 0;
+			continue;
+		}
+
+		size_t length = strlen(string) + 1;
+
+		if (length + words * sizeof(uint32_t) + 16 > top) {
+			free(vector);
+			return -3;
+		}
+
+		top -= length;
+		memcpy(phys + top, string, length);
+		vector[w++] = virt + top;
+	}
+
+	memcpy(&vector[w], auxv, sizeof(auxv));
+
+	// argc is 16 byte aligned, as for 64-bit programs
+	top = (top - words * sizeof(uint32_t)) & ~(size_t)15;
+	memcpy(phys + top, vector, words * sizeof(uint32_t));
+	free(vector);
+
+	ARC_Process *process = thread->parent;
+	context_setup_for_thread(thread->context, meta->entry, (void *)(virt + top), process->page_tables.user, process->userspace);
+
+	if (thread->tcb != NULL) {
+		context_set_tcb(thread->context, thread->tcb);
+	}
+
+	return 0;
+}
+
+void *thread_tls_block(ARC_Thread *thread, size_t *size) {
+	ARC_ProgramTLS *tls = thread != NULL ? thread_tls(thread) : NULL;
+
+	if (tls == NULL || thread->ustack.phys == NULL || size == NULL) {
+		return NULL;
+	}
+
+	*size = ALIGN(tls->mem_size, tls->align);
+
+	// Right below the TCB, see thread_setup_tls
+	return (uint8_t *)thread->ustack.phys + thread_stack_size(thread);
+}
+
+int thread_priority(ARC_Thread *thread) {
+	if (thread == NULL) {
+		return -1;
+	}
+
+	int base = thread->priority;
+
+	if (base == -1 && thread->parent != NULL) {
+		base = thread->parent->priority;
+	}
+
+	int boost = __atomic_load_n(&thread->pi.boost, __ATOMIC_RELAXED);
+
+	return boost > base ? boost : base;
+}
+
+int thread_prepare_park(ARC_Thread *thread) {
+	if (thread == NULL) {
+		return -1;
+	}
+
+	__atomic_store_n(&thread->wait.parked, 1, __ATOMIC_RELEASE);
 
 	return 0;
 }
+
+int thread_park(ARC_Thread *thread) {
+	if (thread == NULL) {
+		return -1;
+	}
+
+	// While blocked and parked, thread_runnable keeps the scheduler from
+	// picking the thread, so this only comes back around once unparked
+	__atomic_store_n(&thread->wait.blocked, 1, __ATOMIC_SEQ_CST);
+
+	while (__atomic_load_n(&thread->wait.parked, __ATOMIC_ACQUIRE)) {
+		if (__atomic_load_n(&thread->exit.stopped, __ATOMIC_ACQUIRE)) {
+			__atomic_store_n(&thread->wait.parked, 0, __ATOMIC_RELEASE);
+			break;
+		}
+
+		sched_yield_cpu();
+	}
+
+	__atomic_store_n(&thread->wait.blocked, 0, __ATOMIC_RELEASE);
+
+	return __atomic_load_n(&thread->exit.stopped, __ATOMIC_ACQUIRE) ? -1 : 0;
+}
+
+int thread_unpark(ARC_Thread *thread) {
+	if (thread == NULL) {
+		return -1;
+	}
+
+	affinity_wake(thread);
+	__atomic_store_n(&thread->wait.parked, 0, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+bool thread_runnable(ARC_Thread *thread) {
+	if (thread == NULL || __atomic_load_n(&thread->exit.exited, __ATOMIC_ACQUIRE)
+	    || __atomic_load_n(&thread->exit.halted, __ATOMIC_ACQUIRE)) {
+		return false;
+	}
+
+	return !(__atomic_load_n(&thread->wait.blocked, __ATOMIC_ACQUIRE) && __atomic_load_n(&thread->wait.parked, __ATOMIC_ACQUIRE));
+}
+
+void thread_switched(ARC_Thread *prev, ARC_Thread *next, bool user) {
+	if (next != NULL) {
+		__atomic_store_n(&next->cpu.running, 1, __ATOMIC_RELEASE);
+		__atomic_store_n(&next->cpu.started, 1, __ATOMIC_RELEASE);
+		affinity_ran(next);
+	}
+
+	if (prev == NULL || prev == next) {
+		return;
+	}
+
+	if (user && __atomic_load_n(&prev->exit.stopped, __ATOMIC_ACQUIRE)) {
+		// Out of every wait and holding nothing
+		__atomic_store_n(&prev->exit.halted, 1, __ATOMIC_RELEASE);
+	}
+
+	__atomic_store_n(&prev->cpu.running, 0, __ATOMIC_RELEASE);
+}
+
+int thread_stop(ARC_Thread *thread) {
+	if (thread == NULL) {
+		return -1;
+	}
+
+	__atomic_store_n(&thread->exit.stopped, 1, __ATOMIC_SEQ_CST);
+
+	if (!__atomic_load_n(&thread->cpu.started, __ATOMIC_ACQUIRE)) {
+		// Never ran, so it cannot be in the middle of anything
+		__atomic_store_n(&thread->exit.halted, 1, __ATOMIC_RELEASE);
+	}
+
+	thread_unpark(thread);
+
+	return 0;
+}
+
+int thread_halt(ARC_Thread *thread) {
+	if (thread == NULL) {
+		return -1;
+	}
+
+	__atomic_store_n(&thread->exit.halted, 1, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+bool thread_gone(ARC_Thread *thread) {
+	if (thread == NULL) {
+		return true;
+	}
+
+	bool off = __atomic_load_n(&thread->exit.halted, __ATOMIC_ACQUIRE) || __atomic_load_n(&thread->exit.exited, __ATOMIC_ACQUIRE);
+
+	return off && !__atomic_load_n(&thread->cpu.running, __ATOMIC_ACQUIRE);
+}
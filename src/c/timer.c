@@ -0,0 +1,279 @@
+/**
+ * @file timer.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#include "arch/smp.h"
+#include "global.h"
+#include "lib/spinlock.h"
+#include "lib/util.h"
+#include "userspace/percpu.h"
+#include "userspace/thread.h"
+#include "userspace/timer.h"
+
+#include <stdbool.h>
+
+#define SLOT_MASK (ARC_TIMER_SLOTS - 1)
+
+struct timer_wheel {
+	ARC_Spinlock lock;
+	// Next tick to be processed
+	uint64_t current;
+	// Timers queued, while there are none the wheel skips straight to now
+	uint32_t armed;
+	ARC_Timer *slots[ARC_TIMER_LEVELS][ARC_TIMER_SLOTS];
+};
+
+// timer_tick runs in interrupt context and takes the wheel lock, so anyone
+// else holding it must keep interrupts off on their processor
+static inline uint64_t wheel_lock(struct timer_wheel *wheel) {
+	uint64_t flags = 0;
+#ifndef ARC_HOSTED
+	__asm__ volatile("pushfq; pop %0; cli" : "=r"(flags) :: "memory");
+#endif
+	spinlock_lock(&wheel->lock);
+
+	return flags;
+}
+
+static inline void wheel_unlock(struct timer_wheel *wheel, uint64_t flags) {
+	spinlock_unlock(&wheel->lock);
+#ifndef ARC_HOSTED
+	__asm__ volatile("push %0; popfq" :: "r"(flags) : "memory", "cc");
+#else
+	(void)flags;
+#endif
+}
+
+static struct timer_wheel wheels[ARC_USERSPACE_CPU_SLOTS] = { 0 };
+static uint64_t monotonic_now = 0;
+
+static inline struct timer_wheel *get_wheel(void) {
+	return &wheels[percpu_slot()];
+}
+
+int init_timers(void) {
+	uint64_t now = timer_now() / ARC_TIMER_TICK_NS;
+
+	for (int i = 0; i < ARC_USERSPACE_CPU_SLOTS; i++) {
+		init_static_spinlock(&wheels[i].lock);
+		wheels[i].current = now;
+	}
+
+	return 0;
+}
+
+static void wheel_insert(struct timer_wheel *wheel, ARC_Timer *timer) {
+	uint64_t expires = timer->expires;
+
+	if (expires < wheel->current) {
+		// Already due, fire on the next tick
+		expires = wheel->current;
+	}
+
+	uint64_t delta = expires - wheel->current;
+	int level = 0;
+
+	while (level < ARC_TIMER_LEVELS - 1 && delta >= (1ULL << (ARC_TIMER_SLOT_BITS * (level + 1)))) {
+		level++;
+	}
+
+	if (level == ARC_TIMER_LEVELS - 1 && delta >= (1ULL << (ARC_TIMER_SLOT_BITS * ARC_TIMER_LEVELS))) {
+		// Beyond the range of the wheel, park it in the furthest slot, it
+		// gets pushed further out each time it cascades
+		expires = wheel->current + (1ULL << (ARC_TIMER_SLOT_BITS * ARC_TIMER_LEVELS)) - 1;
+	}
+
+	int index = (expires >> (ARC_TIMER_SLOT_BITS * level)) & SLOT_MASK;
+	ARC_Timer **slot = &wheel->slots[level][index];
+
+	timer->pprev = slot;
+	timer->next = *slot;
+
+	if (*slot != NULL) {
+		(*slot)->pprev = &timer->next;
+	}
+
+	*slot = timer;
+	timer->wheel = wheel;
+}
+
+static void wheel_remove(ARC_Timer *timer) {
+	*timer->pprev = timer->next;
+
+	if (timer->next != NULL) {
+		timer->next->pprev = timer->pprev;
+	}
+
+	timer->next = NULL;
+	timer->pprev = NULL;
+	timer->wheel = NULL;
+}
+
+int timer_arm(ARC_Timer *timer, uint64_t deadline) {
+	if (timer == NULL || timer->callback == NULL) {
+		ARC_DEBUG(ERR, "Failed to arm timer, improper parameters\n");
+		return -1;
+	}
+
+	struct timer_wheel *wheel = get_wheel();
+
+	uint64_t flags = wheel_lock(wheel);
+	timer->expires = (deadline + ARC_TIMER_TICK_NS - 1) / ARC_TIMER_TICK_NS;
+	wheel_insert(wheel, timer);
+	wheel->armed++;
+	wheel_unlock(wheel, flags);
+
+	return 0;
+}
+
+int timer_cancel(ARC_Timer *timer) {
+	if (timer == NULL) {
+		return -1;
+	}
+
+	struct timer_wheel *wheel = __atomic_load_n(&timer->wheel, __ATOMIC_ACQUIRE);
+
+	if (wheel == NULL) {
+		goto fired;
+	}
+
+	uint64_t flags = wheel_lock(wheel);
+
+	if (timer->wheel != wheel) {
+		// Fired while the lock was being taken
+		wheel_unlock(wheel, flags);
+		goto fired;
+	}
+
+	wheel_remove(timer);
+	wheel->armed--;
+	wheel_unlock(wheel, flags);
+
+	return 0;
+
+	fired:;
+	while (__atomic_load_n(&timer->firing, __ATOMIC_ACQUIRE)) {
+		__builtin_ia32_pause();
+	}
+
+	return -1;
+}
+
+static void wheel_cascade(struct timer_wheel *wheel, int level) {
+	int index = (wheel->current >> (ARC_TIMER_SLOT_BITS * level)) & SLOT_MASK;
+	ARC_Timer *timer = wheel->slots[level][index];
+	wheel->slots[level][index] = NULL;
+
+	while (timer != NULL) {
+		ARC_Timer *next = timer->next;
+		wheel_insert(wheel, timer);
+		timer = next;
+	}
+}
+
+void timer_tick(uint64_t now) {
+	uint64_t seen = __atomic_load_n(&monotonic_now, __ATOMIC_RELAXED);
+	while (seen < now && !__atomic_compare_exchange_n(&monotonic_now, &seen, now, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+	struct timer_wheel *wheel = get_wheel();
+	uint64_t target = now / ARC_TIMER_TICK_NS;
+
+	spinlock_lock(&wheel->lock);
+
+	if (wheel->armed == 0 && wheel->current < target) {
+		// Nothing to fire or cascade on the way
+		wheel->current = target;
+	}
+
+	while (wheel->current <= target) {
+		// Pull the timers of the next span down a level each time the
+		// level below wraps around
+		for (int level = 1; level < ARC_TIMER_LEVELS; level++) {
+			if (((wheel->current >> (ARC_TIMER_SLOT_BITS * (level - 1))) & SLOT_MASK) != 0) {
+				break;
+			}
+
+			wheel_cascade(wheel, level);
+		}
+
+		int index = wheel->current & SLOT_MASK;
+		ARC_Timer *expired = wheel->slots[0][index];
+		wheel->slots[0][index] = NULL;
+		wheel->current++;
+
+		for (ARC_Timer *timer = expired; timer != NULL; timer = timer->next) {
+			wheel->armed--;
+			timer->firing = 1;
+			__atomic_store_n(&timer->wheel, NULL, __ATOMIC_RELEASE);
+		}
+
+		// The callbacks may arm timers of their own
+		spinlock_unlock(&wheel->lock);
+
+		while (expired != NULL) {
+			ARC_Timer *next = expired->next;
+			expired->next = NULL;
+			expired->pprev = NULL;
+			expired->callback(expired);
+			// The owner may free the timer from here on
+			__atomic_store_n(&expired->firing, 0, __ATOMIC_RELEASE);
+			expired = next;
+		}
+
+		spinlock_lock(&wheel->lock);
+	}
+
+	spinlock_unlock(&wheel->lock);
+}
+
+uint64_t timer_now(void) {
+	return __atomic_load_n(&monotonic_now, __ATOMIC_ACQUIRE);
+}
+
+static void sleep_expired(ARC_Timer *timer) {
+	thread_unpark((ARC_Thread *)timer->arg);
+}
+
+int timer_sleep_until(uint64_t deadline) {
+	ARC_Thread *thread = smp_get_proc_desc()->thread;
+
+	if (deadline <= timer_now()) {
+		return 0;
+	}
+
+	ARC_Timer timer = { .callback = sleep_expired, .arg = thread };
+
+	thread_prepare_park(thread);
+
+	if (timer_arm(&timer, deadline) != 0) {
+		thread_unpark(thread);
+		return -1;
+	}
+
+	thread_park(thread);
+	timer_cancel(&timer);
+
+	return 0;
+}
@@ -0,0 +1,156 @@
+/**
+ * @file usercopy.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#include "arch/smp.h"
+#include "userspace/thread.h"
+#include "userspace/usercopy.h"
+
+struct usercopy_fixup {
+	uintptr_t ip;
+	uintptr_t resume;
+};
+
+extern size_t __arc_copy_user(void *dst, const void *src, size_t size);
+extern long __arc_strncpy_user(char *dst, const char *src, size_t max);
+extern int __arc_cmpxchg_user(int *ptr, int *expected, int desired);
+extern const struct usercopy_fixup Arc_UserCopyFixups[];
+extern const struct usercopy_fixup Arc_UserCopyFixupsEnd[];
+
+bool user_access_ok(const void *ptr, size_t size) {
+	uintptr_t base = (uintptr_t)ptr;
+
+	if (size == 0) {
+		return true;
+	}
+
+	if (ptr == NULL || base + size < base) {
+		return false;
+	}
+
+	return base + size <= ARC_USER_ADDRESS_LIMIT;
+}
+
+int copy_from_user(void *dst, const void *src, size_t size) {
+	if (!user_access_ok(src, size)) {
+		return -1;
+	}
+
+	return __arc_copy_user(dst, src, size) == 0 ? 0 : -2;
+}
+
+int copy_to_user(void *dst, const void *src, size_t size) {
+	if (!user_access_ok(dst, size)) {
+		return -1;
+	}
+
+	return __arc_copy_user(dst, src, size) == 0 ? 0 : -2;
+}
+
+long strncpy_from_user(char *dst, const char *src, size_t max) {
+	if (dst == NULL || max == 0 || (uintptr_t)src >= ARC_USER_ADDRESS_LIMIT || src == NULL) {
+		return -1;
+	}
+
+	// Never read past the end of userspace
+	size_t limit = ARC_USER_ADDRESS_LIMIT - (uintptr_t)src;
+	if (limit > max) {
+		limit = max;
+	}
+
+	long len = __arc_strncpy_user(dst, src, limit);
+
+	if (len < 0) {
+		dst[0] = 0;
+		return -2;
+	}
+
+	if ((size_t)len == limit) {
+		// No terminator within reach
+		dst[limit < max ? limit : max - 1] = 0;
+		return -3;
+	}
+
+	return len;
+}
+
+int cmpxchg_user(int *ptr, int *expected, int desired) {
+	if (!user_access_ok(ptr, sizeof(*ptr)) || ((uintptr_t)ptr & (sizeof(*ptr) - 1)) != 0 || expected == NULL) {
+		return -1;
+	}
+
+	int ret = __arc_cmpxchg_user(ptr, expected, desired);
+
+	return ret < 0 ? -2 : ret;
+}
+
+int cmpxchg_user_atomic(int *ptr, int *expected, int desired) {
+	ARC_Thread *thread = smp_get_proc_desc()->thread;
+
+	if (thread == NULL) {
+		return cmpxchg_user(ptr, expected, desired);
+	}
+
+	__atomic_add_fetch(&thread->nofault, 1, __ATOMIC_RELAXED);
+	int ret = cmpxchg_user(ptr, expected, desired);
+	__atomic_sub_fetch(&thread->nofault, 1, __ATOMIC_RELAXED);
+
+	return ret;
+}
+
+int copy_from_user_atomic(void *dst, const void *src, size_t size) {
+	ARC_Thread *thread = smp_get_proc_desc()->thread;
+
+	if (thread == NULL) {
+		return copy_from_user(dst, src, size);
+	}
+
+	__atomic_add_fetch(&thread->nofault, 1, __ATOMIC_RELAXED);
+	int ret = copy_from_user(dst, src, size);
+	__atomic_sub_fetch(&thread->nofault, 1, __ATOMIC_RELAXED);
+
+	return ret;
+}
+
+int fault_in_user(int *ptr) {
+	int value = 0;
+
+	if (copy_from_user(&value, ptr, sizeof(value)) != 0) {
+		return -1;
+	}
+
+	// Writes what is already there, a change in the meantime is as good
+	return cmpxchg_user(ptr, &value, value) < 0 ? -1 : 0;
+}
+
+uintptr_t usercopy_fixup(uintptr_t ip) {
+	for (const struct usercopy_fixup *f = Arc_UserCopyFixups; f < Arc_UserCopyFixupsEnd; f++) {
+		if (f->ip == ip) {
+			return f->resume;
+		}
+	}
+
+	return 0;
+}
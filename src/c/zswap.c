@@ -0,0 +1,430 @@
+/**
+ * @file zswap.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan-OS/Kuserspace - Kernel-Userspace Junction
+ * Copyright (C) 2023-2026 awewsomegamer
+ *
+ * This file is part of Arctan-OS/Kuserspace
+ *
+ * Arctan-OS/Kuserspace is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+*/
+#include "global.h"
+#include "lib/spinlock.h"
+#include "lib/util.h"
+#include "mm/pmm.h"
+#include "userspace/zswap.h"
+
+#include <stdbool.h>
+
+#define MIN_MATCH 4
+#define MAX_OFFSET 0xFFFF
+#define ZPOOL_CLASSES (PAGE_SIZE >> ARC_ZPOOL_CLASS_SHIFT)
+
+// At the start of every pool page, objects follow it
+struct zpool_page {
+	struct zpool_page *next;
+	struct zpool_page **pprev;
+	void *free;
+	uint32_t used;
+};
+
+#define ZPOOL_HEADER_SIZE ALIGN(sizeof(struct zpool_page), ARC_ZPOOL_CLASS_SIZE)
+
+struct zpool_class {
+	ARC_Spinlock lock;
+	// Pages with at least one free object
+	struct zpool_page *partial;
+};
+
+static struct zpool_class classes[ZPOOL_CLASSES] = { 0 };
+
+static inline uint32_t load32(const uint8_t *p) {
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline size_t put_length(uint8_t *dst, size_t op, size_t max, size_t length) {
+	while (length >= 255) {
+		if (op >= max) {
+			return 0;
+		}
+
+		dst[op++] = 255;
+		length -= 255;
+	}
+
+	if (op >= max) {
+		return 0;
+	}
+
+	dst[op++] = length;
+
+	return op;
+}
+
+// Writes one sequence, match_length of 0 ends the block
+static size_t put_sequence(uint8_t *dst, size_t op, size_t max, const uint8_t *literals, size_t literal_length,
+			   size_t offset, size_t match_length) {
+	if (op >= max) {
+		return 0;
+	}
+
+	size_t token = op++;
+	size_t ml = match_length == 0 ? 0 : match_length - MIN_MATCH;
+
+	dst[token] = ((literal_length < 15 ? literal_length : 15) << 4) | (ml < 15 ? ml : 15);
+
+	if (literal_length >= 15 && (op = put_length(dst, op, max, literal_length - 15)) == 0) {
+		return 0;
+	}
+
+	if (op + literal_length > max) {
+		return 0;
+	}
+
+	memcpy(&dst[op], literals, literal_length);
+	op += literal_length;
+
+	if (match_length == 0) {
+		return op;
+	}
+
+	if (op + 2 > max) {
+		return 0;
+	}
+
+	dst[op++] = offset & 0xFF;
+	dst[op++] = offset >> 8;
+
+	if (ml >= 15 && (op = put_length(dst, op, max, ml - 15)) == 0) {
+		return 0;
+	}
+
+	return op;
+}
+
+size_t lz_compress(const uint8_t *src, size_t size, uint8_t *dst, size_t max, uint16_t *table) {
+	if (size > MAX_OFFSET) {
+		return 0;
+	}
+
+	memset(table, 0, ARC_LZ_TABLE_SIZE * sizeof(*table));
+
+	size_t ip = 0;
+	size_t anchor = 0;
+	size_t op = 0;
+
+	while (ip + MIN_MATCH <= size) {
+		uint32_t sequence = load32(&src[ip]);
+		uint32_t hash = (sequence * 2654435761U) >> (32 - 12);
+		// Positions are stored + 1, so 0 means empty
+		size_t ref = table[hash];
+		table[hash] = ip + 1;
+
+		if (ref == 0 || load32(&src[ref - 1]) != sequence) {
+			ip++;
+			continue;
+		}
+
+		ref--;
+
+		size_t length = MIN_MATCH;
+		while (ip + length < size && src[ref + length] == src[ip + length]) {
+			length++;
+		}
+
+		if ((op = put_sequence(dst, op, max, &src[anchor], ip - anchor, ip - ref, length)) == 0) {
+			return 0;
+		}
+
+		ip += length;
+		anchor = ip;
+	}
+
+	return put_sequence(dst, op, max, &src[anchor], size - anchor, 0, 0);
+}
+
+static inline int get_length(const uint8_t *src, size_t size, size_t *ip, size_t *length) {
+	uint8_t b = 255;
+
+	while (b == 255) {
+		if (*ip >= size) {
+			return -1;
+		}
+
+		b = src[(*ip)++];
+		*length += b;
+	}
+
+	return 0;
+}
+
+size_t lz_decompress(const uint8_t *src, size_t size, uint8_t *dst, size_t max) {
+	size_t ip = 0;
+	size_t op = 0;
+
+	while (ip < size) {
+		uint8_t token = src[ip++];
+		size_t literal_length = token >> 4;
+
+		if (literal_length == 15 && get_length(src, size, &ip, &literal_length) != 0) {
+			return 0;
+		}
+
+		if (ip + literal_length > size || op + literal_length > max) {
+			return 0;
+		}
+
+		memcpy(&dst[op], &src[ip], literal_length);
+		ip += literal_length;
+		op += literal_length;
+
+		if (ip == size) {
+			// Last sequence has no match
+			break;
+		}
+
+		if (ip + 2 > size) {
+			return 0;
+		}
+
+		size_t offset = src[ip] | (src[ip + 1] << 8);
+		ip += 2;
+
+		size_t match_length = token & 0xF;
+
+		if (match_length == 15 && get_length(src, size, &ip, &match_length) != 0) {
+			return 0;
+		}
+
+		match_length += MIN_MATCH;
+
+		if (offset == 0 || offset > op || op + match_length > max) {
+			return 0;
+		}
+
+		// Byte at a time, the match may overlap what it produces
+		for (size_t i = 0; i < match_length; i++, op++) {
+			dst[op] = dst[op - offset];
+		}
+	}
+
+	return op;
+}
+
+int init_zpool(void) {
+	for (size_t i = 0; i < ZPOOL_CLASSES; i++) {
+		init_static_spinlock(&classes[i].lock);
+	}
+
+	return 0;
+}
+
+static struct zpool_class *get_class(size_t size, size_t *object_size) {
+	size_t index = (size + ARC_ZPOOL_CLASS_SIZE - 1) >> ARC_ZPOOL_CLASS_SHIFT;
+
+	if (index == 0 || index > ZPOOL_CLASSES) {
+		return NULL;
+	}
+
+	*object_size = index << ARC_ZPOOL_CLASS_SHIFT;
+
+	return &classes[index - 1];
+}
+
+// Called with the class lock held
+static void zpool_unlink(struct zpool_page *page) {
+	*page->pprev = page->next;
+
+	if (page->next != NULL) {
+		page->next->pprev = page->pprev;
+	}
+
+	page->next = NULL;
+	page->pprev = NULL;
+}
+
+// Called with the class lock held
+static void zpool_link(struct zpool_class *class, struct zpool_page *page) {
+	page->next = class->partial;
+	page->pprev = &class->partial;
+
+	if (class->partial != NULL) {
+		class->partial->pprev = &page->next;
+	}
+
+	class->partial = page;
+}
+
+void *zpool_alloc(size_t size) {
+	size_t object_size = 0;
+	struct zpool_class *class = get_class(size, &object_size);
+
+	if (class == NULL) {
+		return NULL;
+	}
+
+	if (object_size > PAGE_SIZE - ZPOOL_HEADER_SIZE) {
+		// No room for a header, these get a page of their own
+		return pmm_alloc(PAGE_SIZE);
+	}
+
+	spinlock_lock(&class->lock);
+
+	struct zpool_page *page = class->partial;
+
+	if (page == NULL) {
+		// Carve a fresh page into objects of this class, what is left
+		// over at the end of the page goes unused
+		if ((page = (struct zpool_page *)pmm_alloc(PAGE_SIZE)) == NULL) {
+			spinlock_unlock(&class->lock);
+			return NULL;
+		}
+
+		page->free = NULL;
+		page->used = 0;
+
+		for (size_t i = ZPOOL_HEADER_SIZE; i + object_size <= PAGE_SIZE; i += object_size) {
+			void **object = (void **)((uint8_t *)page + i);
+			*object = page->free;
+			page->free = object;
+		}
+
+		zpool_link(class, page);
+	}
+
+	void *object = page->free;
+	page->free = *(void **)object;
+	page->used++;
+
+	if (page->free == NULL) {
+		zpool_unlink(page);
+	}
+
+	spinlock_unlock(&class->lock);
+
+	return object;
+}
+
+void zpool_free(void *ptr, size_t size) {
+	size_t object_size = 0;
+	struct zpool_class *class = get_class(size, &object_size);
+
+	if (class == NULL || ptr == NULL) {
+		return;
+	}
+
+	if (object_size > PAGE_SIZE - ZPOOL_HEADER_SIZE) {
+		pmm_free(ptr);
+		return;
+	}
+
+	struct zpool_page *page = (struct zpool_page *)((uintptr_t)ptr & ~((uintptr_t)PAGE_SIZE - 1));
+
+	spinlock_lock(&class->lock);
+
+	if (page->free == NULL) {
+		// Was full, so off the list
+		zpool_link(class, page);
+	}
+
+	*(void **)ptr = page->free;
+	page->free = ptr;
+	page->used--;
+
+	if (page->used == 0) {
+		zpool_unlink(page);
+		spinlock_unlock(&class->lock);
+		pmm_free(page);
+
+		return;
+	}
+
+	spinlock_unlock(&class->lock);
+}
+
+static bool page_is_zero(const void *page) {
+	const uint64_t *words = (const uint64_t *)page;
+
+	for (size_t i = 0; i < PAGE_SIZE / sizeof(uint64_t); i++) {
+		if (words[i] != 0) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int zswap_store(const void *page, ARC_SwapSlot *slot, ARC_ZSwapScratch *scratch) {
+	if (page == NULL || slot == NULL || scratch == NULL) {
+		return -1;
+	}
+
+	if (page_is_zero(page)) {
+		slot->data = NULL;
+		slot->size = 0;
+		return 0;
+	}
+
+	// Anything that does not save at least one pool class is kept as is
+	size_t size = lz_compress((const uint8_t *)page, PAGE_SIZE, scratch->buffer, sizeof(scratch->buffer), scratch->table);
+	const void *data = scratch->buffer;
+
+	if (size == 0) {
+		size = PAGE_SIZE;
+		data = page;
+	}
+
+	if ((slot->data = zpool_alloc(size)) == NULL) {
+		return -2;
+	}
+
+	memcpy(slot->data, data, size);
+	slot->size = size;
+
+	return 0;
+}
+
+int zswap_load(ARC_SwapSlot *slot, void *page) {
+	if (slot == NULL || page == NULL) {
+		return -1;
+	}
+
+	if (slot->size == 0) {
+		memset(page, 0, PAGE_SIZE);
+	} else if (slot->size == PAGE_SIZE) {
+		memcpy(page, slot->data, PAGE_SIZE);
+	} else if (lz_decompress(slot->data, slot->size, page, PAGE_SIZE) != PAGE_SIZE) {
+		ARC_DEBUG(ERR, "Compressed page %p is corrupt\n", slot->data);
+		return -2;
+	}
+
+	return 0;
+}
+
+void zswap_drop(ARC_SwapSlot *slot) {
+	if (slot == NULL || slot->data == NULL) {
+		return;
+	}
+
+	zpool_free(slot->data, slot->size);
+	slot->data = NULL;
+	slot->size = 0;
+}